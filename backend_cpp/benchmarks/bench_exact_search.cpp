@@ -0,0 +1,136 @@
+// 📊 Exact SIMD engine vs HNSW: build time, memory, query latency and recall@10 per corpus size
+// Usage: bench_exact_search [num_queries=200] [sizes...=1000 5000 20000 50000]
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <memory>
+#include <random>
+#include <string>
+#include <thread>
+#include <unordered_set>
+#include <vector>
+#include <spdlog/spdlog.h>
+#include "exact_search.hpp"
+#include "faiss_vector_store.hpp"
+
+using namespace code_assistance;
+
+static constexpr int kDim = 768;
+static constexpr int kTopK = 10;
+static constexpr int kClusters = 64;
+static constexpr size_t kBatch = 32;
+static constexpr size_t kDeltaFold = 2048; // Mirrors the store's kDeltaFoldVectors
+
+static std::vector<float> make_corpus(size_t n, std::mt19937& rng) {
+    std::normal_distribution<float> dist(0.0f, 1.0f);
+    std::vector<float> centers((size_t)kClusters * kDim);
+    for (auto& v : centers) v = dist(rng);
+
+    std::uniform_int_distribution<int> pick(0, kClusters - 1);
+    std::vector<float> data(n * kDim);
+    for (size_t i = 0; i < n; ++i) {
+        const float* c = centers.data() + (size_t)pick(rng) * kDim;
+        for (int d = 0; d < kDim; ++d) data[i * kDim + d] = c[d] + 0.35f * dist(rng);
+    }
+    return data;
+}
+
+static void normalize(float* v) {
+    double norm = 0;
+    for (int d = 0; d < kDim; ++d) norm += (double)v[d] * v[d];
+    float inv = norm > 0 ? (float)(1.0 / std::sqrt(norm)) : 0.0f;
+    for (int d = 0; d < kDim; ++d) v[d] *= inv;
+}
+
+static std::vector<std::unordered_set<std::string>> ground_truth(const std::vector<float>& corpus, size_t n,
+                                                                const std::vector<float>& queries, size_t nq) {
+    std::vector<float> unit(corpus.begin(), corpus.begin() + n * kDim);
+    for (size_t i = 0; i < n; ++i) normalize(unit.data() + i * kDim);
+
+    std::vector<std::unordered_set<std::string>> truth(nq);
+    std::vector<std::pair<float, size_t>> scored(n);
+    for (size_t q = 0; q < nq; ++q) {
+        std::vector<float> qv(queries.begin() + q * kDim, queries.begin() + (q + 1) * kDim);
+        normalize(qv.data());
+        for (size_t i = 0; i < n; ++i) {
+            double dot = 0;
+            const float* x = unit.data() + i * kDim;
+            for (int d = 0; d < kDim; ++d) dot += (double)x[d] * qv[d];
+            scored[i] = {(float)(2.0 - 2.0 * dot), i};
+        }
+        size_t top = std::min(n, (size_t)kTopK);
+        std::partial_sort(scored.begin(), scored.begin() + top, scored.end());
+        for (size_t k = 0; k < top; ++k) truth[q].insert("vec_" + std::to_string(scored[k].second));
+    }
+    return truth;
+}
+
+int main(int argc, char** argv) {
+    spdlog::set_level(spdlog::level::warn);
+    size_t nq = argc > 1 ? std::strtoull(argv[1], nullptr, 10) : 200;
+    std::vector<size_t> sizes;
+    for (int i = 2; i < argc; ++i) sizes.push_back(std::strtoull(argv[i], nullptr, 10));
+    if (sizes.empty()) sizes = {1000, 5000, 20000, 50000};
+    size_t max_n = *std::max_element(sizes.begin(), sizes.end());
+
+    std::mt19937 rng(42);
+    auto corpus = make_corpus(max_n, rng);
+    auto queries = make_corpus(nq, rng);
+
+    std::printf("# exact kernel: %s\n", exact::kernel_name());
+    std::printf("engine,vectors,index_mb,build_ms,query_us,batch_query_us,recall_at_10\n");
+    for (size_t n : sizes) {
+        auto truth = ground_truth(corpus, n, queries, nq);
+
+        struct Engine { const char* name; size_t exact_max; bool fp16; };
+        const Engine engines[] = {{"exact_fp32", SIZE_MAX, false}, {"exact_fp16", SIZE_MAX, true}, {"hnsw", 0, false}};
+        for (const auto& engine : engines) {
+            VectorIndexConfig cfg;
+            cfg.exact_max_vectors = engine.exact_max;
+            cfg.exact_fp16 = engine.fp16;
+            FaissVectorStore store(kDim, cfg);
+
+            std::vector<std::shared_ptr<CodeNode>> nodes(n);
+            for (size_t i = 0; i < n; ++i) {
+                nodes[i] = std::make_shared<CodeNode>();
+                nodes[i]->id = "vec_" + std::to_string(i);
+                nodes[i]->embedding.assign(corpus.begin() + i * kDim, corpus.begin() + (i + 1) * kDim);
+            }
+
+            auto start = std::chrono::high_resolution_clock::now();
+            store.upsert_nodes(nodes);
+            // HNSW builds in the background fold; below one fold's worth it stays exact as well
+            while (engine.exact_max == 0 && n >= kDeltaFold && store.delta_size() > 0) {
+                std::this_thread::sleep_for(std::chrono::milliseconds(10));
+            }
+            double build_ms = std::chrono::duration<double, std::milli>(std::chrono::high_resolution_clock::now() - start).count();
+
+            size_t hits = 0;
+            auto q_start = std::chrono::high_resolution_clock::now();
+            for (size_t q = 0; q < nq; ++q) {
+                std::vector<float> qv(queries.begin() + q * kDim, queries.begin() + (q + 1) * kDim);
+                for (const auto& res : store.search(qv, kTopK)) {
+                    if (truth[q].count(res.node->id)) hits++;
+                }
+            }
+            double query_us = std::chrono::duration<double, std::micro>(std::chrono::high_resolution_clock::now() - q_start).count() / nq;
+
+            // Multi-query path: kBatch queries per call
+            auto b_start = std::chrono::high_resolution_clock::now();
+            for (size_t q = 0; q + kBatch <= nq; q += kBatch) {
+                store.search_batch(queries.data() + q * kDim, kBatch, kTopK);
+            }
+            size_t batched = nq / kBatch * kBatch;
+            double batch_us = batched ? std::chrono::duration<double, std::micro>(std::chrono::high_resolution_clock::now() - b_start).count() / batched : 0.0;
+
+            size_t expected = 0;
+            for (const auto& t : truth) expected += t.size();
+            std::printf("%s,%zu,%.1f,%.1f,%.1f,%.1f,%.3f\n", engine.name, n, store.index_bytes() / (1024.0 * 1024.0),
+                        build_ms, query_us, batch_us, expected ? (double)hits / expected : 0.0);
+            std::fflush(stdout);
+        }
+    }
+    return 0;
+}
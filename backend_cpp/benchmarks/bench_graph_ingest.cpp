@@ -0,0 +1,71 @@
+// 📊 PointerGraph ingestion benchmark: per-node add_node() vs add_nodes_bulk()
+// Usage: bench_graph_ingest [max_nodes=5000]
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <filesystem>
+#include <random>
+#include <string>
+#include <vector>
+#include <spdlog/spdlog.h>
+#include "memory/PointerGraph.hpp"
+
+namespace fs = std::filesystem;
+using namespace code_assistance;
+
+static constexpr int kDim = 768;
+
+static std::vector<NodeSpec> make_specs(size_t n, std::mt19937& rng) {
+    std::normal_distribution<float> dist(0.0f, 1.0f);
+    std::vector<NodeSpec> specs(n);
+    for (size_t i = 0; i < n; ++i) {
+        auto& s = specs[i];
+        s.id = "bench/file_" + std::to_string(i / 20) + ".cpp::sym_" + std::to_string(i);
+        s.content = "void sym_" + std::to_string(i) + "() { /* body */ }";
+        s.embedding.resize(kDim);
+        for (auto& v : s.embedding) v = dist(rng);
+        s.metadata["file_path"] = "bench/file_" + std::to_string(i / 20) + ".cpp";
+        s.metadata["node_name"] = "sym_" + std::to_string(i);
+        s.metadata["node_type"] = "function_definition";
+    }
+    return specs;
+}
+
+static double run_per_node(const std::vector<NodeSpec>& specs, const fs::path& dir) {
+    fs::remove_all(dir);
+    PointerGraph graph(dir.string(), kDim);
+    auto start = std::chrono::high_resolution_clock::now();
+    for (const auto& s : specs) {
+        graph.add_node(s.content, s.type, "", s.embedding, s.metadata);
+    }
+    graph.save();
+    return std::chrono::duration<double, std::milli>(std::chrono::high_resolution_clock::now() - start).count();
+}
+
+static double run_bulk(const std::vector<NodeSpec>& specs, const fs::path& dir) {
+    fs::remove_all(dir);
+    PointerGraph graph(dir.string(), kDim);
+    auto start = std::chrono::high_resolution_clock::now();
+    graph.add_nodes_bulk(specs);
+    return std::chrono::duration<double, std::milli>(std::chrono::high_resolution_clock::now() - start).count();
+}
+
+int main(int argc, char** argv) {
+    spdlog::set_level(spdlog::level::warn);
+    size_t max_nodes = argc > 1 ? std::strtoull(argv[1], nullptr, 10) : 5000;
+
+    std::mt19937 rng(42);
+    fs::path root = fs::temp_directory_path() / "synapse_bench_ingest";
+
+    std::printf("nodes,per_node_ms,bulk_ms,speedup\n");
+    for (size_t n = 100; n <= max_nodes; n *= 2) {
+        auto specs = make_specs(n, rng);
+        double per_node = run_per_node(specs, root / "per_node");
+        double bulk = run_bulk(specs, root / "bulk");
+        std::printf("%zu,%.2f,%.2f,%.1fx\n", n, per_node, bulk, bulk > 0 ? per_node / bulk : 0.0);
+        std::fflush(stdout);
+    }
+
+    fs::remove_all(root);
+    return 0;
+}
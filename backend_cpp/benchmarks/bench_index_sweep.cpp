@@ -0,0 +1,252 @@
+// 📊 Vector index tuning sweep: recall@k, p50/p99 latency, build time and memory per configuration
+// Usage: bench_index_sweep [--project DIR] [--vectors N] [--queries N] [--k K]
+//                          [--modes hnsw,hnsw_fp16,hnsw_sq8,ivf_pq,flat] [--m 16,32,48]
+//                          [--ef-construction 64,128,256] [--ef-search 16,32,64,128,256] [--nprobe 4,8,16,32,64]
+//
+// --project reads the raw vectors of a saved project (its nodes.bin) and holds out --queries of them as
+// queries; without it, clustered 768-d vectors are synthesized. Every configuration is built through
+// FaissVectorStore (segments, delta and all), saved once, then reloaded per efSearch / nprobe value.
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <filesystem>
+#include <memory>
+#include <random>
+#include <sstream>
+#include <string>
+#include <thread>
+#include <unordered_set>
+#include <vector>
+#include <spdlog/spdlog.h>
+#include "exact_search.hpp"
+#include "faiss_vector_store.hpp"
+#include "node_store.hpp"
+
+namespace fs = std::filesystem;
+using namespace code_assistance;
+
+static constexpr int kSynthDim = 768;
+static constexpr int kClusters = 64;
+
+struct Options {
+    std::string project;
+    size_t vectors = 20000;
+    size_t queries = 500;
+    int k = 10;
+    std::vector<std::string> modes = {"hnsw", "hnsw_fp16", "hnsw_sq8", "ivf_pq", "flat"};
+    std::vector<int> m = {16, 32, 48};
+    std::vector<int> ef_construction = {64, 128, 256};
+    std::vector<int> ef_search = {16, 32, 64, 128, 256};
+    std::vector<int> nprobe = {4, 8, 16, 32, 64};
+};
+
+static std::vector<int> parse_ints(const std::string& csv) {
+    std::vector<int> out;
+    std::stringstream ss(csv);
+    for (std::string item; std::getline(ss, item, ',');) out.push_back(std::atoi(item.c_str()));
+    return out;
+}
+
+static std::vector<std::string> parse_strings(const std::string& csv) {
+    std::vector<std::string> out;
+    std::stringstream ss(csv);
+    for (std::string item; std::getline(ss, item, ',');) out.push_back(item);
+    return out;
+}
+
+static std::vector<float> make_corpus(size_t n, std::mt19937& rng) {
+    std::normal_distribution<float> dist(0.0f, 1.0f);
+    std::vector<float> centers((size_t)kClusters * kSynthDim);
+    for (auto& v : centers) v = dist(rng);
+
+    std::uniform_int_distribution<int> pick(0, kClusters - 1);
+    std::vector<float> data(n * kSynthDim);
+    for (size_t i = 0; i < n; ++i) {
+        const float* c = centers.data() + (size_t)pick(rng) * kSynthDim;
+        for (int d = 0; d < kSynthDim; ++d) data[i * kSynthDim + d] = c[d] + 0.35f * dist(rng);
+    }
+    return data;
+}
+
+// Raw vectors of a saved project, in row order
+static bool load_project(const std::string& dir, std::vector<float>& data, int& dim) {
+    node_store::Reader reader;
+    if (!reader.open((fs::path(dir) / "nodes.bin").string(), node_store::Kind::CODE_NODES)) return false;
+    dim = (int)reader.dimension();
+    for (size_t i = 0; i < reader.size(); ++i) {
+        auto vec = reader.embedding(reader.code_record(i).embedding_row);
+        if (vec.size() == (size_t)dim) data.insert(data.end(), vec.begin(), vec.end());
+    }
+    return !data.empty();
+}
+
+static void normalize(float* v, int dim) {
+    double norm = 0;
+    for (int d = 0; d < dim; ++d) norm += (double)v[d] * v[d];
+    float inv = norm > 0 ? (float)(1.0 / std::sqrt(norm)) : 0.0f;
+    for (int d = 0; d < dim; ++d) v[d] *= inv;
+}
+
+// Exact top-k ids per query, scored by the store's own exact engine
+static std::vector<std::unordered_set<long>> ground_truth(const std::vector<float>& corpus, size_t n,
+                                                         const std::vector<float>& queries, size_t nq, int dim, int k) {
+    exact::ExactMatrix matrix(dim, exact::Storage::FP32);
+    matrix.reserve(n);
+    std::vector<float> unit(dim);
+    for (size_t i = 0; i < n; ++i) {
+        std::copy(corpus.begin() + i * dim, corpus.begin() + (i + 1) * dim, unit.begin());
+        normalize(unit.data(), dim);
+        matrix.append((long)i, unit.data());
+    }
+    std::vector<float> unit_queries(queries);
+    for (size_t q = 0; q < nq; ++q) normalize(unit_queries.data() + q * dim, dim);
+
+    std::vector<exact::TopK> heaps(nq, exact::TopK(k));
+    matrix.scan(unit_queries.data(), nq, nullptr, heaps.data());
+
+    std::vector<std::unordered_set<long>> truth(nq);
+    for (size_t q = 0; q < nq; ++q) {
+        for (const auto& hit : heaps[q].take_sorted()) truth[q].insert(hit.second);
+    }
+    return truth;
+}
+
+static void wait_settled(const FaissVectorStore& store) {
+    while (store.compacting()) std::this_thread::sleep_for(std::chrono::milliseconds(10));
+}
+
+int main(int argc, char** argv) {
+    spdlog::set_level(spdlog::level::warn);
+    Options opt;
+    for (int i = 1; i + 1 < argc; i += 2) {
+        std::string flag = argv[i], value = argv[i + 1];
+        if (flag == "--project") opt.project = value;
+        else if (flag == "--vectors") opt.vectors = std::strtoull(value.c_str(), nullptr, 10);
+        else if (flag == "--queries") opt.queries = std::strtoull(value.c_str(), nullptr, 10);
+        else if (flag == "--k") opt.k = std::atoi(value.c_str());
+        else if (flag == "--modes") opt.modes = parse_strings(value);
+        else if (flag == "--m") opt.m = parse_ints(value);
+        else if (flag == "--ef-construction") opt.ef_construction = parse_ints(value);
+        else if (flag == "--ef-search") opt.ef_search = parse_ints(value);
+        else if (flag == "--nprobe") opt.nprobe = parse_ints(value);
+        else {
+            std::fprintf(stderr, "unknown flag %s\n", flag.c_str());
+            return 1;
+        }
+    }
+
+    // 1. Corpus + held-out queries
+    std::mt19937 rng(42);
+    std::vector<float> corpus, queries;
+    int dim = kSynthDim;
+    if (!opt.project.empty()) {
+        if (!load_project(opt.project, corpus, dim)) {
+            std::fprintf(stderr, "no vectors in %s/nodes.bin\n", opt.project.c_str());
+            return 1;
+        }
+        size_t total = corpus.size() / dim;
+        opt.queries = std::min(opt.queries, total / 10);
+        // Shuffle rows, then split off the queries so none of them is its own nearest neighbour
+        std::vector<size_t> order(total);
+        for (size_t i = 0; i < total; ++i) order[i] = i;
+        std::shuffle(order.begin(), order.end(), rng);
+        std::vector<float> shuffled(corpus.size());
+        for (size_t i = 0; i < total; ++i) {
+            std::copy(corpus.begin() + order[i] * dim, corpus.begin() + (order[i] + 1) * dim, shuffled.begin() + i * dim);
+        }
+        queries.assign(shuffled.begin(), shuffled.begin() + opt.queries * dim);
+        corpus.assign(shuffled.begin() + opt.queries * dim, shuffled.end());
+    } else {
+        corpus = make_corpus(opt.vectors, rng);
+        queries = make_corpus(opt.queries, rng);
+    }
+    const size_t n = corpus.size() / dim;
+    const size_t nq = opt.queries;
+    if (n == 0 || nq == 0) {
+        std::fprintf(stderr, "need at least one vector and one query\n");
+        return 1;
+    }
+    auto truth = ground_truth(corpus, n, queries, nq, dim, opt.k);
+
+    std::vector<std::shared_ptr<CodeNode>> nodes(n);
+    for (size_t i = 0; i < n; ++i) {
+        nodes[i] = std::make_shared<CodeNode>();
+        nodes[i]->id = std::to_string(i);
+    }
+
+    fs::path scratch = fs::temp_directory_path() / "synapse_index_sweep";
+
+    std::printf("mode,vectors,dim,m,ef_construction,ef_search,nprobe,build_ms,index_mb,recall_at_%d,p50_us,p99_us\n", opt.k);
+    for (const auto& mode_name : opt.modes) {
+        VectorIndexConfig base = VectorIndexConfig::from_json(nlohmann::json{{"mode", mode_name}});
+        base.exact_max_vectors = 0; // Measure the index layout, not the small-project exact engine
+        bool hnsw = base.mode != IndexMode::FLAT && base.mode != IndexMode::IVF_PQ;
+
+        // Graph parameters only matter for HNSW layouts; others build once
+        std::vector<int> ms = hnsw ? opt.m : std::vector<int>{0};
+        std::vector<int> efcs = hnsw ? opt.ef_construction : std::vector<int>{0};
+        std::vector<int> knobs = hnsw ? opt.ef_search : base.mode == IndexMode::IVF_PQ ? opt.nprobe : std::vector<int>{0};
+
+        for (int m : ms) {
+            for (int efc : efcs) {
+                // 2. Build once per (mode, M, efConstruction) and persist
+                VectorIndexConfig cfg = base;
+                if (hnsw) {
+                    cfg.hnsw_m = m;
+                    cfg.ef_construction = efc;
+                }
+                double build_ms = 0;
+                size_t bytes = 0;
+                {
+                    FaissVectorStore store(dim, cfg);
+                    for (size_t i = 0; i < n; ++i) {
+                        nodes[i]->embedding.assign(corpus.begin() + i * dim, corpus.begin() + (i + 1) * dim);
+                    }
+                    auto start = std::chrono::high_resolution_clock::now();
+                    store.upsert_nodes(nodes);
+                    wait_settled(store);
+                    build_ms = std::chrono::duration<double, std::milli>(std::chrono::high_resolution_clock::now() - start).count();
+                    bytes = store.index_bytes();
+                    fs::remove_all(scratch);
+                    store.save(scratch.string());
+                }
+
+                // 3. Reload per search-time knob and time every query on its own
+                for (int knob : knobs) {
+                    VectorIndexConfig run = cfg;
+                    if (hnsw) run.ef_search = knob;
+                    else if (base.mode == IndexMode::IVF_PQ) run.ivf_nprobe = knob;
+
+                    FaissVectorStore store(dim, run);
+                    store.load(scratch.string());
+                    wait_settled(store);
+
+                    std::vector<double> latencies(nq);
+                    size_t hits = 0, expected = 0;
+                    for (size_t q = 0; q < nq; ++q) {
+                        std::vector<float> qv(queries.begin() + q * dim, queries.begin() + (q + 1) * dim);
+                        auto t0 = std::chrono::high_resolution_clock::now();
+                        auto results = store.search(qv, opt.k);
+                        latencies[q] = std::chrono::duration<double, std::micro>(std::chrono::high_resolution_clock::now() - t0).count();
+                        for (const auto& res : results) {
+                            if (truth[q].count(std::stol(res.node->id))) hits++;
+                        }
+                        expected += truth[q].size();
+                    }
+                    std::sort(latencies.begin(), latencies.end());
+                    auto pct = [&](double p) { return latencies[std::min(nq - 1, (size_t)(p * nq))]; };
+
+                    std::printf("%s,%zu,%d,%d,%d,%d,%d,%.1f,%.1f,%.4f,%.1f,%.1f\n", mode_name.c_str(), n, dim,
+                                hnsw ? m : 0, hnsw ? efc : 0, hnsw ? knob : 0,
+                                base.mode == IndexMode::IVF_PQ ? knob : 0, build_ms, bytes / (1024.0 * 1024.0),
+                                expected ? (double)hits / expected : 0.0, pct(0.50), pct(0.99));
+                    std::fflush(stdout);
+                }
+            }
+        }
+    }
+    fs::remove_all(scratch);
+    return 0;
+}
@@ -0,0 +1,149 @@
+// 📊 Symbol extraction benchmark: the old explicit-stack DFS vs the tree-sitter query extractor
+// Usage: bench_symbol_extract <corpus_dir> [repeats=3]
+//
+// Every C++ file under corpus_dir (.cpp .hpp .h .cc) is loaded once, then each repeat parses all of
+// them three ways: parse only, parse + DFS (as extract_symbols did before the symbol queries), and
+// ASTBooster::extract_symbols. extract_ms is the time on top of parsing. The query extractor also
+// resolves names, docstrings and references, which the DFS never did; named_pct shows the difference.
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <filesystem>
+#include <stack>
+#include <string>
+#include <vector>
+#include <spdlog/spdlog.h>
+#include "parser_elite.hpp"
+
+namespace fs = std::filesystem;
+using namespace code_assistance;
+
+struct Run {
+    double ms = 0;
+    size_t symbols = 0;
+    size_t named = 0;
+    size_t refs = 0;
+};
+
+static double elapsed_ms(std::chrono::high_resolution_clock::time_point start) {
+    return std::chrono::duration<double, std::milli>(std::chrono::high_resolution_clock::now() - start).count();
+}
+
+static Run run_parse_only(TSParser* parser, const std::vector<FileBuffer::Ptr>& files) {
+    Run run;
+    auto start = std::chrono::high_resolution_clock::now();
+    for (const auto& file : files) {
+        TSTree* tree = ts_parser_parse_string(parser, nullptr, file->data(), (uint32_t)file->size());
+        if (tree) ts_tree_delete(tree);
+    }
+    run.ms = elapsed_ms(start);
+    return run;
+}
+
+// The extractor before the symbol queries, kept verbatim as the baseline
+static Run run_dfs(TSParser* parser, const std::vector<std::string>& paths, const std::vector<FileBuffer::Ptr>& files) {
+    Run run;
+    auto start = std::chrono::high_resolution_clock::now();
+    for (size_t f = 0; f < files.size(); ++f) {
+        std::string_view content = files[f]->view();
+        TSTree* tree = ts_parser_parse_string(parser, nullptr, content.data(), (uint32_t)content.length());
+        if (!tree) continue;
+        std::vector<CodeNode> nodes;
+        std::stack<TSNode> traversal_stack;
+        traversal_stack.push(ts_tree_root_node(tree));
+        while (!traversal_stack.empty()) {
+            TSNode node = traversal_stack.top();
+            traversal_stack.pop();
+            std::string type = ts_node_type(node);
+            bool is_symbol = (type == "function_definition" || type == "class_specifier" || type == "class_definition" ||
+                              type == "method_definition" || type == "struct_specifier");
+            if (is_symbol) {
+                CodeNode info;
+                info.file_path = paths[f];
+                info.type = type;
+                info.name = "anonymous";
+                uint32_t child_count = ts_node_child_count(node);
+                for (uint32_t i = 0; i < child_count; i++) {
+                    TSNode child = ts_node_child(node, i);
+                    std::string c_type = ts_node_type(child);
+                    if (c_type == "identifier" || c_type == "type_identifier" || c_type == "name") {
+                        uint32_t s = ts_node_start_byte(child);
+                        info.name.assign(content.substr(s, ts_node_end_byte(child) - s));
+                        break;
+                    }
+                }
+                uint32_t s = ts_node_start_byte(node);
+                info.content.assign(content.substr(s, ts_node_end_byte(node) - s));
+                info.id = paths[f] + "::" + info.name;
+                nodes.push_back(std::move(info));
+            }
+            uint32_t count = ts_node_child_count(node);
+            for (uint32_t i = 0; i < count; i++) traversal_stack.push(ts_node_child(node, i));
+        }
+        ts_tree_delete(tree);
+        run.symbols += nodes.size();
+        for (const auto& n : nodes) run.named += n.name != "anonymous";
+    }
+    run.ms = elapsed_ms(start);
+    return run;
+}
+
+static Run run_query(elite::ASTBooster& booster, const std::vector<std::string>& paths,
+                     const std::vector<FileBuffer::Ptr>& files) {
+    Run run;
+    auto start = std::chrono::high_resolution_clock::now();
+    for (size_t f = 0; f < files.size(); ++f) {
+        auto nodes = booster.extract_symbols(paths[f], files[f]);
+        run.symbols += nodes.size();
+        for (const auto& n : nodes) {
+            run.named += n.name != "anonymous";
+            run.refs += n.references.size();
+        }
+    }
+    run.ms = elapsed_ms(start);
+    return run;
+}
+
+int main(int argc, char** argv) {
+    spdlog::set_level(spdlog::level::warn);
+    if (argc < 2) {
+        std::fprintf(stderr, "usage: %s <corpus_dir> [repeats=3]\n", argv[0]);
+        return 1;
+    }
+    fs::path root = argv[1];
+    int repeats = argc > 2 ? std::atoi(argv[2]) : 3;
+
+    std::vector<std::string> paths;
+    std::vector<FileBuffer::Ptr> files;
+    size_t bytes = 0;
+    for (const auto& entry : fs::recursive_directory_iterator(root, fs::directory_options::skip_permission_denied)) {
+        if (!entry.is_regular_file()) continue;
+        std::string ext = entry.path().extension().string();
+        if (ext != ".cpp" && ext != ".hpp" && ext != ".h" && ext != ".cc") continue;
+        auto buf = FileBuffer::load(entry.path().string());
+        if (!buf) continue;
+        bytes += buf->size();
+        paths.push_back(fs::relative(entry.path(), root).string());
+        files.push_back(std::move(buf));
+    }
+    std::printf("# corpus: %zu files, %.1f MB\n", files.size(), bytes / (1024.0 * 1024.0));
+
+    TSParser* parser = ts_parser_new();
+    ts_parser_set_language(parser, tree_sitter_cpp());
+    elite::ASTBooster booster;
+
+    std::printf("extractor,repeat,total_ms,extract_ms,mb_per_s,symbols,named_pct,refs\n");
+    for (int r = 0; r < repeats; ++r) {
+        Run parse = run_parse_only(parser, files);
+        Run dfs = run_dfs(parser, paths, files);
+        Run query = run_query(booster, paths, files);
+        for (const auto& [name, run] : {std::pair<const char*, Run>{"dfs", dfs}, {"query", query}}) {
+            std::printf("%s,%d,%.1f,%.1f,%.1f,%zu,%.1f,%zu\n", name, r, run.ms, std::max(0.0, run.ms - parse.ms),
+                        bytes / (1024.0 * 1024.0) / (run.ms / 1000.0), run.symbols,
+                        run.symbols ? 100.0 * run.named / run.symbols : 0.0, run.refs);
+        }
+    }
+    ts_parser_delete(parser);
+    return 0;
+}
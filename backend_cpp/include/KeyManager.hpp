@@ -1,4 +1,5 @@
 #pragma once
+#include <algorithm>
 #include <vector>
 #include <string>
 #include <shared_mutex>
@@ -29,6 +30,7 @@ private:
     std::atomic<size_t> current_embedding_index{0}; 
     
     std::string serper_key;
+    int embedding_rpm = 30; // Per key; batchEmbedContents quota of the tier the keys are on
 
 public:
     KeyManager() {
@@ -73,6 +75,7 @@ public:
             }
             
             serper_key = j.value("serper", "");
+            embedding_rpm = std::max(1, j.value("embedding_rpm", 30));
             current_key_index = 0;
             current_model_index = 0;
             
@@ -101,6 +104,17 @@ public:
     }
 
     std::string get_current_key() const { return get_current_pair().key; }
+
+    // Snapshot of the pool, for callers that spread load over every key at once
+    std::vector<std::string> get_all_keys() const {
+        std::shared_lock lock(pool_mutex);
+        std::vector<std::string> keys;
+        keys.reserve(key_pool.size());
+        for (const auto& k : key_pool) keys.push_back(k.key);
+        return keys;
+    }
+
+    int get_embedding_rpm() const { std::shared_lock lock(pool_mutex); return embedding_rpm; }
     std::string get_current_model() const { return get_current_pair().model; }
     std::string get_serper_key() const { std::shared_lock lock(pool_mutex); return serper_key; }
 
@@ -70,6 +70,23 @@ public:
         return accumulated_flags;
     }
     
+    // 🧭 Incremental lookup for tree walkers: descend one segment per directory level instead of
+    // re-walking every prefix from the root. descend(...).flags == check(parent / segment).
+    struct Cursor {
+        const Node* node = nullptr; // nullptr once the path fell off the trie
+        uint8_t flags = PathFlag::PF_NONE;
+    };
+
+    Cursor root_cursor() const { return {root.get(), PathFlag::PF_NONE}; }
+
+    Cursor descend(const Cursor& at, const std::string& segment) const {
+        if (!at.node) return {nullptr, at.flags};
+        auto it = at.node->children.find(segment);
+        if (it == at.node->children.end()) return {nullptr, at.flags};
+        const Node* next = it->second.get();
+        return {next, next->flags != PathFlag::PF_NONE ? next->flags : at.flags};
+    }
+    
     void clear() {
         root = std::make_unique<Node>();
     }
@@ -32,6 +32,8 @@ struct TelemetryData {
     
     // Application Latency
     double vector_latency_ms = 0.0;
+    double batch_search_latency_ms = 0.0; // Last multi-query search, whole batch
+    int batch_search_size = 0;
     double embedding_latency_ms = 0.0;
     double llm_generation_ms = 0.0; 
     
@@ -42,18 +44,32 @@ struct TelemetryData {
 
     double last_sync_duration_ms = 0.0; 
     double cache_size_mb = 0.0; 
+
+    // Warm-up
+    double startup_ms = 0.0;        // Process start -> server listening
+    double index_warmup_max_ms = 0.0; // Slowest project index opened on first access, across all projects
 };
 
 class SystemMonitor {
 public:
     // Global Atomic Metrics
     inline static std::atomic<double> global_vector_latency_ms{0.0};
+    inline static std::atomic<double> global_batch_search_latency_ms{0.0};
+    inline static std::atomic<int> global_batch_search_size{0};
     inline static std::atomic<double> global_embedding_latency_ms{0.0};
     inline static std::atomic<double> global_llm_generation_ms{0.0}; 
     inline static std::atomic<int> global_output_tokens{0};          
     inline static std::atomic<int> global_graph_nodes_scanned{0};
     inline static std::atomic<double> global_sync_latency_ms{0.0};
     inline static std::atomic<double> global_cache_size_mb{0.0};
+    inline static std::atomic<double> global_startup_ms{0.0};
+    inline static std::atomic<double> global_index_warmup_max_ms{0.0};
+
+    // Keeps the slowest warm-up: projects open one after another, and the last one says little
+    static void record_index_warmup(double ms) {
+        double seen = global_index_warmup_max_ms.load();
+        while (ms > seen && !global_index_warmup_max_ms.compare_exchange_weak(seen, ms)) {}
+    }
 
     SystemMonitor() : stop_thread_(false) {
 #ifdef _WIN32
@@ -156,12 +172,16 @@ private:
 
             // 3. Common Telemetry
             snapshot.vector_latency_ms = global_vector_latency_ms.load();
+            snapshot.batch_search_latency_ms = global_batch_search_latency_ms.load();
+            snapshot.batch_search_size = global_batch_search_size.load();
             snapshot.embedding_latency_ms = global_embedding_latency_ms.load();
             snapshot.llm_generation_ms = global_llm_generation_ms.load();
             snapshot.output_token_count = global_output_tokens.load();
             snapshot.graph_nodes_scanned = global_graph_nodes_scanned.load();
             snapshot.last_sync_duration_ms = global_sync_latency_ms.load();
             snapshot.cache_size_mb = global_cache_size_mb.load();
+            snapshot.startup_ms = global_startup_ms.load();
+            snapshot.index_warmup_max_ms = global_index_warmup_max_ms.load();
 
             if (snapshot.llm_generation_ms > 0) {
                 snapshot.tokens_per_second = (snapshot.output_token_count / snapshot.llm_generation_ms) * 1000.0;
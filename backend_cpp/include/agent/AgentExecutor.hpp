@@ -10,6 +10,7 @@
 #include "agent/AgentTypes.hpp"
 #include "embedding_service.hpp"
 #include "retrieval_engine.hpp"
+#include "sync_service.hpp"
 #include "agent/SubAgent.hpp"
 #include "tools/ToolRegistry.hpp"
 #include "agent/ContextManager.hpp"
@@ -37,7 +38,7 @@ public:
     
     // Graph Management
     std::shared_ptr<PointerGraph> get_or_create_graph(const std::string& project_id);
-    void ingest_sync_results(const std::string& project_id, const std::vector<std::shared_ptr<CodeNode>>& nodes);
+    void ingest_sync_results(const std::string& project_id, const SyncResult& sync);
 
     // Helpers
     void determineContextStrategy(const std::string& query, ContextSnapshot& ctx, const std::string& project_id);
@@ -92,18 +92,9 @@ private:
 
 class CacheManager {
 public:
+    // Embeddings are cached on disk by EmbeddingCache, keyed by model + text
     CacheManager() 
-        : embedding_cache_(1000, std::chrono::seconds(3600)),
-          result_cache_(500, std::chrono::seconds(300)) {}
-
-    // Cache embeddings
-    std::optional<std::vector<float>> get_embedding(const std::string& text) {
-        return embedding_cache_.get(text);
-    }
-
-    void set_embedding(const std::string& text, const std::vector<float>& embedding) {
-        embedding_cache_.set(text, embedding);
-    }
+        : result_cache_(500, std::chrono::seconds(300)) {}
 
     // Cache retrieval results
     std::optional<std::string> get_result(const std::string& query) {
@@ -115,12 +106,10 @@ public:
     }
 
     void clear_all() {
-        embedding_cache_.clear();
         result_cache_.clear();
     }
 
 private:
-    LRUCache<std::string, std::vector<float>> embedding_cache_;
     LRUCache<std::string, std::string> result_cache_;
 };
 
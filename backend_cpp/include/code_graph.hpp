@@ -1,14 +1,34 @@
 #pragma once
 
+#include <cstdint>
 #include <string>
 #include <vector>
 #include <unordered_set>
 #include <unordered_map>
 #include <memory>
+#include <string_view>
 #include <nlohmann/json.hpp>
+#include "utils/FileBuffer.hpp"
 
 namespace code_assistance {
 
+// 🔗 A name a symbol uses, as the parser saw it (unqualified). The link phase resolves it against
+// the project-wide symbol table into an edge of the ReferenceGraph.
+enum class RefKind : uint8_t { CALL = 0, INHERIT = 1, TYPE = 2, IMPORT = 3 };
+
+struct SymbolRef {
+    std::string name;
+    RefKind kind = RefKind::CALL;
+
+    bool operator==(const SymbolRef& o) const { return kind == o.kind && name == o.name; }
+    bool operator<(const SymbolRef& o) const { return name != o.name ? name < o.name : kind < o.kind; }
+};
+
+const char* ref_kind_name(RefKind kind);
+// String metadata form ("call:foo,inherit:Base,type:Config"), how references ride along in NodeSpec / PointerNode
+std::string format_references(const std::vector<SymbolRef>& refs);
+std::vector<SymbolRef> parse_references(std::string_view text);
+
 struct CodeNode {
     std::string id;
     std::string name;
@@ -16,22 +36,43 @@ struct CodeNode {
     std::string docstring;
     std::string file_path;
     std::string type;
-    std::unordered_set<std::string> dependencies;
+    std::unordered_set<std::string> dependencies; // Imported files (bracket parser)
+    std::vector<SymbolRef> references;            // Calls, base classes, type uses (AST parser), sorted
     std::vector<float> embedding;
     std::unordered_map<std::string, double> weights;
     std::string ai_summary;
     double ai_quality_score = 0.5;
 
+    // 🧵 Parsed nodes do not copy their code: they keep a (buffer, offset, length) slice of the
+    // file's shared buffer and leave `content` empty. Read the code through text(); materialize()
+    // copies it into `content` and lets go of the buffer, for nodes that must outlive the sync.
+    FileBuffer::Ptr source;
+    size_t source_offset = 0;
+    size_t source_length = 0;
+
+    std::string_view text() const {
+        return source ? source->slice(source_offset, source_length) : std::string_view(content);
+    }
+    void materialize() {
+        if (!source) return;
+        content.assign(text());
+        source.reset();
+    }
+
     nlohmann::json to_json() const;
     static CodeNode from_json(const nlohmann::json& j);
 };
 
 class CodeParser {
 public:
-    // Simple regex-based parser
-    static std::vector<CodeNode> extract_nodes_from_file(const std::string& file_path, const std::string& content);
+    // Simple regex-based parser; the nodes are slices of `source`
+    static std::vector<CodeNode> extract_nodes_from_file(const std::string& file_path, const FileBuffer::Ptr& source);
 };
 
+// 🏷️ Ids are "path::name", the upsert key of the graph and the index. Same-named symbols of one file
+// (overloads, every class's __init__) get "#2", "#3"... in source order, so none overwrites another.
+void make_node_ids_unique(std::vector<CodeNode>& nodes);
+
 class CodeGraph {
 public:
     void add_node(std::shared_ptr<CodeNode> node);
@@ -0,0 +1,89 @@
+#pragma once
+#include <atomic>
+#include <cstdint>
+#include <filesystem>
+#include <fstream>
+#include <optional>
+#include <shared_mutex>
+#include <string>
+#include <unordered_map>
+#include <vector>
+#include "utils/MappedFile.hpp"
+
+namespace code_assistance {
+
+namespace fs = std::filesystem;
+
+// 💾 Persistent, content-addressed embedding cache: hash(model, exact embedding text) -> fp16 vector.
+//
+// One append-only file of fixed-size records, mmap-ed on open (host byte order):
+//   Header                      64 bytes: magic, version, dimension, model hash
+//   records[]                   key (XXH3-128) + dimension x fp16, padded to 8 bytes
+// Rows appended after open live in memory too, until the next open maps them. A torn trailing
+// record (crash mid-append) is cut off on open. A different model empties the file: vectors of
+// two models never mix. Past max_bytes the oldest half is dropped (insertion order ~ age).
+class EmbeddingCache {
+public:
+    struct Stats {
+        uint64_t hits = 0;
+        uint64_t misses = 0;
+        size_t entries = 0;
+        size_t bytes = 0;
+    };
+
+    explicit EmbeddingCache(fs::path file, size_t max_bytes = size_t(1) << 30);
+
+    EmbeddingCache(const EmbeddingCache&) = delete;
+    EmbeddingCache& operator=(const EmbeddingCache&) = delete;
+
+    // Switches to `model`; a model other than the one on disk invalidates every entry
+    void bind_model(const std::string& model);
+
+    std::optional<std::vector<float>> get(const std::string& text);
+    // Vectors of a different dimension than the cache holds (or empty ones) are ignored
+    void put(const std::string& text, const std::vector<float>& vec);
+    void put_many(const std::vector<std::string>& texts, const std::vector<std::vector<float>>& vecs);
+
+    void clear();
+    Stats stats() const;
+
+private:
+    struct Key {
+        uint64_t lo = 0;
+        uint64_t hi = 0;
+        bool operator==(const Key& o) const { return lo == o.lo && hi == o.hi; }
+    };
+    struct KeyHash {
+        size_t operator()(const Key& k) const { return (size_t)(k.lo ^ (k.hi * 0x9e3779b97f4a7c15ull)); }
+    };
+
+    Key key_of(const std::string& text) const;
+    size_t record_size() const;
+    const char* record_at(uint32_t row) const;
+
+    // All of these expect the exclusive lock
+    void open_locked();
+    void reset_locked(uint32_t dimension);
+    bool append_locked(const Key& key, const std::vector<float>& vec); // Memory only until flush_locked()
+    void flush_locked();
+    void compact_locked();
+
+    fs::path file_;
+    size_t max_bytes_;
+    std::string model_;
+    uint64_t model_hash_ = 0;
+    uint32_t dimension_ = 0; // 0 = nothing stored yet
+
+    mutable std::shared_mutex mutex_;
+    MappedFile map_;
+    size_t mapped_rows_ = 0;
+    std::vector<char> tail_; // Records appended since open, same layout as on disk
+    size_t written_ = 0;     // Bytes of tail_ already in the file
+    std::unordered_map<Key, uint32_t, KeyHash> index_;
+    std::ofstream out_;
+
+    std::atomic<uint64_t> hits_{0};
+    std::atomic<uint64_t> misses_{0};
+};
+
+} // namespace code_assistance
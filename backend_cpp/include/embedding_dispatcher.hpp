@@ -0,0 +1,106 @@
+#pragma once
+#include <chrono>
+#include <condition_variable>
+#include <cstddef>
+#include <deque>
+#include <functional>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace code_assistance {
+
+struct DispatchOptions {
+    size_t max_batch = 100;            // batchEmbedContents accepts at most 100 texts
+    double requests_per_minute = 30.0; // Per key (keys.json "embedding_rpm")
+    double burst = 2.0;                // Requests a key may bank while idle
+    size_t per_key_inflight = 2;       // AIMD window ceiling = keys * this
+    int max_attempts = 8;              // Per sub-batch, for 429 / 5xx / transport errors
+};
+
+// One batchEmbedContents round trip, as the transport saw it
+struct EmbedReply {
+    int status = 0;          // HTTP status, 0 = transport error / timeout
+    int retry_after_ms = 0;  // Server's hint on 429, 0 = none given
+    std::vector<std::vector<float>> vectors; // In request order; may be shorter than the request
+    std::string error;
+};
+
+// 🚦 Concurrent batch embedding over the whole key pool.
+// Texts are cut into sub-batches of max_batch and sent by a fixed set of workers. Every key has a
+// token bucket (its own quota) and the number of requests in flight follows AIMD: +1 per window of
+// successes, halved on a 429 (once per round trip, not once per failed request). A failed sub-batch
+// is re-queued alone; a 400 is split in halves until the text the API rejects is isolated.
+// Thread-safe: concurrent embed() calls share the keys, the buckets and the window.
+class EmbeddingDispatcher {
+public:
+    using Transport = std::function<EmbedReply(const std::vector<std::string>& texts, const std::string& key)>;
+
+    EmbeddingDispatcher(std::vector<std::string> keys, Transport transport, DispatchOptions options = {});
+    ~EmbeddingDispatcher();
+
+    EmbeddingDispatcher(const EmbeddingDispatcher&) = delete;
+    EmbeddingDispatcher& operator=(const EmbeddingDispatcher&) = delete;
+
+    // One vector per text, in order. Blocks until every sub-batch succeeded or gave up:
+    // texts that never got a vector come back empty.
+    std::vector<std::vector<float>> embed(const std::vector<std::string>& texts);
+
+    // Sub-batches are queued behind the window or the buckets: more work now only waits
+    bool saturated() const;
+    double window() const;
+    size_t max_window() const { return max_window_; }
+    size_t key_count() const { return keys_.size(); }
+
+private:
+    using Clock = std::chrono::steady_clock;
+
+    struct Job {
+        const std::vector<std::string>* texts;
+        std::vector<std::vector<float>>* out;
+        size_t pending; // Texts not yet resolved (embedded or given up)
+    };
+
+    struct Task {
+        Job* job;
+        size_t begin;
+        size_t end;
+        int attempts = 0;
+        Clock::time_point not_before{};
+    };
+
+    struct KeyState {
+        std::string key;
+        double tokens = 0.0;
+        Clock::time_point refilled{};
+        Clock::time_point cooldown_until{};
+        size_t in_flight = 0;
+        int strikes = 0;       // Consecutive 429s: drives the cooldown when the server gives no hint
+        bool disabled = false; // 401 / 403
+    };
+
+    void worker_loop();
+    // Index of the key to send on now, or -1 (wake_at then says when one may become ready)
+    int pick_key(Clock::time_point now, Clock::time_point& wake_at);
+    void settle(Task& task, size_t key_index, EmbedReply& reply, uint64_t sent_epoch);
+    void resolve(Job* job, size_t count);
+    void fail_all_queued(const char* reason);
+
+    std::vector<KeyState> keys_;
+    Transport transport_;
+    DispatchOptions options_;
+    size_t max_window_;
+
+    mutable std::mutex mutex_;
+    std::condition_variable work_cv_; // Workers: a task, a window slot or a token appeared
+    std::condition_variable done_cv_; // Callers: some job finished
+    std::deque<Task> queue_;
+    double window_;
+    size_t in_flight_ = 0;
+    uint64_t decrease_epoch_ = 0; // Bumped on every multiplicative decrease
+    bool stop_ = false;
+    std::vector<std::thread> workers_;
+};
+
+} // namespace code_assistance
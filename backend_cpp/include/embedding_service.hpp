@@ -1,12 +1,16 @@
 #pragma once
 #include <string>
+#include <string_view>
 #include <vector>
 #include <optional>
 #include <memory>
+#include <mutex>
 
 // 🚀 CRITICAL FIX: Include full definitions, not just forward declarations
 #include "KeyManager.hpp" 
 #include "cache_manager.hpp"
+#include "embedding_cache.hpp"
+#include "embedding_dispatcher.hpp"
 
 namespace code_assistance {
 
@@ -30,11 +34,12 @@ struct GenerationResult {
 };
 
 // Declaration only
-std::string utf8_safe_substr(const std::string& str, size_t length);
+std::string utf8_safe_substr(std::string_view str, size_t length);
 
 // 🚀 NEW: Context Management API declarations
-void preload_file_context(const std::string& file_path, const std::string& full_content);
+void preload_file_context(const std::string& file_path, std::string_view full_content);
 void invalidate_file_context(const std::string& file_path);
+bool has_file_context(const std::string& file_path);
 void clear_completion_cache();
 
 class EmbeddingService {
@@ -42,7 +47,15 @@ public:
     explicit EmbeddingService(std::shared_ptr<KeyManager> key_manager);
     
     std::vector<float> generate_embedding(const std::string& text);
+    // Any number of texts: sub-batches go out concurrently across the key pool (EmbeddingDispatcher).
+    // One vector per text, in order; a text that could not be embedded gets an empty one.
     std::vector<std::vector<float>> generate_embeddings_batch(const std::vector<std::string>& texts);
+    // Batch work is already queued behind the rate limits: extra requests would only wait
+    bool embeddings_saturated();
+    // Most batch requests the dispatcher keeps in flight
+    size_t embedding_concurrency();
+    // Persistent cache in front of both embedding calls (hits never reach the API)
+    EmbeddingCache::Stats embedding_cache_stats() const { return embedding_cache_->stats(); }
     std::string generate_text(const std::string& prompt);
     
     // 🚀 OPTIMIZED AUTOCOMPLETE
@@ -59,6 +72,7 @@ public:
 private:
     std::shared_ptr<KeyManager> key_manager_;
     std::shared_ptr<CacheManager> cache_manager_;
+    std::shared_ptr<EmbeddingCache> embedding_cache_;
     const std::string base_url_ = "https://generativelanguage.googleapis.com/v1beta/";
     const std::string python_bridge_url_ = "http://127.0.0.1:5000/bridge/generate";
     
@@ -66,6 +80,14 @@ private:
     GenerationResult call_gemini_api(const std::string& prompt);
 
     std::string get_endpoint_url(const std::string& action);
+
+    // One batchEmbedContents call on an explicit key (the dispatcher picks it)
+    EmbedReply post_batch_embed(const std::vector<std::string>& texts, const std::string& key);
+    EmbeddingDispatcher& dispatcher();
+    // Bound to the embedding model in use right now (a rotation invalidates it)
+    EmbeddingCache& embedding_cache();
+    std::once_flag dispatcher_once_;
+    std::unique_ptr<EmbeddingDispatcher> dispatcher_;
 };
 
 class HyDEGenerator {
@@ -0,0 +1,91 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <cstdlib>
+#include <new>
+#include <utility>
+#include <vector>
+
+namespace faiss { struct IDSelector; }
+
+namespace code_assistance {
+
+// 🎯 Exact inner-product engine for the FaissVectorStore delta. Small projects never leave it:
+// a contiguous aligned matrix scanned with a runtime-dispatched SIMD kernel costs no graph
+// build and no link memory, and below ~20k vectors it answers about as fast as HNSW.
+namespace exact {
+
+// Kernel picked by CPU dispatch at startup: "avx512", "avx2" or "scalar"
+const char* kernel_name();
+
+enum class Storage { FP32, FP16 };
+
+template <typename T, size_t Align = 64>
+struct AlignedAllocator {
+    using value_type = T;
+    template <typename U> struct rebind { using other = AlignedAllocator<U, Align>; };
+
+    AlignedAllocator() = default;
+    template <typename U> AlignedAllocator(const AlignedAllocator<U, Align>&) {}
+
+    T* allocate(size_t n) { return static_cast<T*>(::operator new(n * sizeof(T), std::align_val_t(Align))); }
+    void deallocate(T* p, size_t) { ::operator delete(p, std::align_val_t(Align)); }
+
+    template <typename U> bool operator==(const AlignedAllocator<U, Align>&) const { return true; }
+    template <typename U> bool operator!=(const AlignedAllocator<U, Align>&) const { return false; }
+};
+
+// Bounded max-heap: keeps the k smallest distances seen so far
+class TopK {
+public:
+    explicit TopK(size_t k = 0) : k_(k) { heap_.reserve(k); }
+
+    void push(float dist, long id);
+    void merge(const TopK& other);
+    // Ascending by distance; leaves the heap empty
+    std::vector<std::pair<float, long>> take_sorted();
+
+private:
+    size_t k_;
+    std::vector<std::pair<float, long>> heap_;
+};
+
+// Id-tagged unit vectors in one 64-byte aligned block. Rows are zero-padded to a multiple
+// of 16 lanes so every kernel runs full-width without a tail loop. Ids must be appended ascending.
+class ExactMatrix {
+public:
+    ExactMatrix(size_t dimension, Storage storage);
+
+    void reserve(size_t rows);
+    void append(long id, const float* vec);
+    // Copies an already-encoded row (no fp16 round trip)
+    void append_row(const ExactMatrix& other, size_t row);
+
+    size_t size() const { return ids_.size(); }
+    size_t dimension() const { return dim_; }
+    Storage storage() const { return storage_; }
+    const std::vector<long>& ids() const { return ids_; }
+    size_t bytes() const;
+
+    void decode_row(size_t row, float* out) const;
+    // false if the id is not in this matrix
+    bool decode(long id, float* out) const;
+
+    // Scores rows [row_begin, row_end) against n unit queries (row-major n x dimension) and pushes
+    // the L2 distance of unit vectors, 2 - 2 * <q, x>, into heaps[q]. Rows sel rejects are skipped.
+    // Queries go through the kernel four at a time, so each row is loaded once per block of four.
+    void scan(const float* queries, size_t n, const faiss::IDSelector* sel, TopK* heaps,
+              size_t row_begin = 0, size_t row_end = SIZE_MAX) const;
+
+private:
+    size_t dim_;
+    size_t stride_; // dim_ rounded up to 16 lanes
+    Storage storage_;
+    std::vector<long> ids_;
+    std::vector<float, AlignedAllocator<float>> f32_;
+    std::vector<uint16_t, AlignedAllocator<uint16_t>> f16_;
+};
+
+} // namespace exact
+} // namespace code_assistance
@@ -4,43 +4,226 @@
 #include <string>
 #include <vector>
 #include <memory> // Required for std::unique_ptr
+#include <atomic>
+#include <thread>
+#include <unordered_set>
 #include <faiss/utils/distances.h>
-#include <shared_mutex> 
+#include <mutex>
+#include <nlohmann/json.hpp>
 
 // Forward declare FAISS Index
-namespace faiss { struct Index; }
+namespace faiss {
+    struct Index;
+    struct SearchParameters;
+    struct IDSelector;
+    template <typename IndexT> struct IndexIDMap2Template;
+    using IndexIDMap2 = IndexIDMap2Template<Index>;
+}
 
 namespace code_assistance {
 
+namespace node_store { class Reader; }
+namespace exact { class ExactMatrix; }
+class ReferenceGraph;
+
+// 🗜️ Vector index layouts. Memory per 768-d vector (excluding graph links):
+//   FLAT / HNSW_FLAT 3 KB fp32 | HNSW_FP16 1.5 KB | HNSW_SQ8 768 B | IVF_PQ pq_m bytes
+enum class IndexMode { FLAT, HNSW_FLAT, HNSW_SQ8, HNSW_FP16, IVF_PQ };
+
+std::string index_mode_name(IndexMode mode);
+
+// 🗺️ What load() does with a memory-mapped segment file before searches touch it
+enum class IndexPrefetch {
+    NONE,       // Pages fault in on first use
+    WILLNEED,   // madvise(WILLNEED): the kernel reads the file in the background, load() returns at once
+    POPULATE    // Read every page before load() returns: slower open, no cold first queries
+};
+
+// Per-project index factory settings, read from the "vector_index" object of config.json
+struct VectorIndexConfig {
+    IndexMode mode = IndexMode::HNSW_FLAT;
+    int hnsw_m = 32;
+    int ef_construction = 128;
+    int ef_search = 64;
+    int ivf_nlist = 1024;               // Upper bound; small corpora train fewer lists
+    int ivf_nprobe = 16;
+    int pq_m = 96;                      // Sub-quantizers, must divide the dimension
+    int pq_nbits = 8;
+    bool keep_node_embeddings = true;   // false = free CodeNode::embedding once the vector is indexed
+    // 🎯 Up to this many vectors the store keeps no index at all: every vector stays in the exact
+    // SIMD-scanned delta. Past it, the delta folds into `mode` segments (0 = always build segments).
+    size_t exact_max_vectors = 20000;
+    bool exact_fp16 = false;            // Exact rows stored as fp16: half the memory, ~1e-3 score error
+    // 🗺️ Map segment files instead of deserializing them into the heap (FAISS >= 1.10, POSIX only).
+    // Vectors and graph links then stay in the page cache and opening a project costs little.
+    // Mapped segments are read-only: folds, merges and rebuilds write fresh heap segments that replace them.
+    bool mmap_segments = true;
+    IndexPrefetch prefetch = IndexPrefetch::WILLNEED;
+
+    static VectorIndexConfig from_json(const nlohmann::json& j);
+};
+
+// 🎯 Predicate pushed down into the index walk. Non-matching vectors are skipped while the
+// graph is traversed, so a filtered query still fills k slots instead of post-filtering a mixed top-k.
+struct VectorFilter {
+    std::unordered_set<std::string> code_types;             // CodeNode::type allow-list
+    std::string path_prefix;                                // CodeNode::file_path prefix
+    std::vector<const std::unordered_set<long>*> any_of;    // FAISS id must be in at least one set
+    std::vector<const std::unordered_set<long>*> all_of;    // FAISS id must be in every set
+
+    bool empty() const {
+        return code_types.empty() && path_prefix.empty() && any_of.empty() && all_of.empty();
+    }
+};
+
+// ⏱️ Per-call search knobs, handed to FAISS as per-query SearchParameters. Zero fields fall back
+// to the store's VectorIndexConfig, so a default SearchParams searches exactly like before.
+// Adaptive mode starts at ef and keeps doubling ef (and nprobe) until the top-k stops changing,
+// a round would overrun time_budget_us, or ef reaches its cap. A budget alone turns it on.
+struct SearchParams {
+    int ef = 0;                     // HNSW efSearch (0 = ef_search from config)
+    int64_t time_budget_us = 0;     // Adaptive widening stops before it would overrun this (0 = no budget)
+    int nprobe = 0;                 // IVF lists probed (0 = ivf_nprobe from config)
+    bool adaptive = false;          // Widen until stable even without a budget
+
+    bool is_adaptive() const { return adaptive || time_budget_us > 0; }
+
+    // Reads {"ef", "time_budget_us", "nprobe", "adaptive"}; missing keys stay 0 / false
+    static SearchParams from_json(const nlohmann::json& j);
+};
+
 struct FaissSearchResult {
     std::shared_ptr<CodeNode> node;
     float faiss_score;
+    long faiss_id = -1;
 };
 
+// 📖 Reads never block on ingestion. Every search pins an immutable, versioned Snapshot
+// (immutable index segments + small exact delta chunks + a paged id -> node table). A writer copies
+// the current version, appends its batch as a new delta chunk and publishes the result with
+// one atomic store. Search fans out over every segment and the delta, then merges the top-k.
+// 🪜 LSM-style upkeep runs in the background: a full delta is folded into a new small segment,
+// and runs of similar-sized segments are merged into one larger index build.
 class FaissVectorStore {
 public:
-    explicit FaissVectorStore(int dimension);
+    explicit FaissVectorStore(int dimension, VectorIndexConfig config = {});
     ~FaissVectorStore(); // Destructor must be defined in .cpp
 
+    // Legacy entry point, same semantics as upsert_nodes()
     void add_nodes(const std::vector<std::shared_ptr<CodeNode>>& nodes);
+
+    // Inserts or replaces nodes keyed by CodeNode::id.
+    // Returns the stable 64-bit FAISS id of every input node (-1 if it had no embedding).
+    std::vector<long> upsert_nodes(const std::vector<std::shared_ptr<CodeNode>>& nodes);
+
+    // Tombstones the vectors owned by these CodeNode ids. Returns how many were live.
+    size_t remove_nodes(const std::vector<std::string>& node_ids);
+
     std::vector<FaissSearchResult> search(const std::vector<float>& query_vector, int k);
-    
+    std::vector<FaissSearchResult> search(const std::vector<float>& query_vector, int k, const SearchParams& params);
+
+    // Filtered search: returns k hits whenever at least k live vectors match the filter
+    std::vector<FaissSearchResult> search(const std::vector<float>& query_vector, int k, const VectorFilter& filter,
+                                          const SearchParams& params = {});
+
+    // Multi-query search over n row-major query vectors (n x dimension floats).
+    // results[i] answers queries[i]; the filter and params apply to every query.
+    std::vector<std::vector<FaissSearchResult>> search_batch(const float* queries, size_t n, int k,
+                                                             const VectorFilter& filter = {},
+                                                             const SearchParams& params = {});
+
+    // Persists faiss.index + nodes.bin (binary node store). load() also migrates metadata.json.
     void save(const std::string& path) const;
     void load(const std::string& path);
 
-    const std::vector<std::shared_ptr<CodeNode>>& get_all_nodes() const;
+    // Live nodes of the current snapshot, in insertion order. The copy stays valid while writers move on.
+    std::vector<std::shared_ptr<CodeNode>> get_all_nodes() const;
+    size_t size() const;
+    // Vectors still in the exact delta, i.e. not yet folded into an index segment
+    size_t delta_size() const;
+    // Immutable index segments searched alongside the delta
+    size_t segment_count() const;
+    // A background fold / merge / compaction is running (benchmarks wait for it to settle)
+    bool compacting() const;
     std::shared_ptr<CodeNode> get_node_by_name(const std::string& name) const;
 
+    // FAISS id currently owned by a CodeNode id (-1 if it has no live vector)
+    long faiss_id_of(const std::string& node_id) const;
+    // Live node owning a FAISS id in the current snapshot (nullptr if none). Lock-free.
+    std::shared_ptr<CodeNode> get_node(long faiss_id) const;
+
+    // 🔗 Calls / inheritance / type uses / imports between the live nodes, published with the snapshot.
+    // Lock-free and never links: until link_references() catches up it is the last graph linked
+    // (nodes added since are not vertices, removed ones resolve to nullptr). nullptr before the first link.
+    std::shared_ptr<const ReferenceGraph> reference_graph() const;
+    // Relinks the graph if the node set changed since the published one and publishes the result.
+    // Ingestion calls it once a sync's nodes are in; load() reads refs.bin or links, save() writes refs.bin.
+    void link_references();
+
+    size_t tombstone_count() const;
+
+    // Serialized size of all segments (plus the raw delta): a close proxy for resident memory
+    size_t index_bytes() const;
+    // Layout of the largest segment
+    IndexMode index_mode() const;
+
 private:
+    class NodeTable;
+    struct Snapshot;
+
     int dimension_;
-    // CHANGED: From faiss::Index* to std::unique_ptr
-    std::unique_ptr<faiss::Index> index_; 
-    
-    std::vector<std::shared_ptr<CodeNode>> nodes_list_;
-    std::unordered_map<long, std::shared_ptr<CodeNode>> id_to_node_map_;
+    VectorIndexConfig config_;
+
+    // The published read view. Only ever replaced (under write_mutex_), never mutated.
+    std::atomic<std::shared_ptr<const Snapshot>> snapshot_;
+
+    // ✍️ Writer-side state, guarded by write_mutex_
+    mutable std::mutex write_mutex_;
+    long next_id_ = 0;
+    uint64_t version_ = 0;
     std::unordered_map<std::string, long> name_to_id_map_;
+    // 🪦 HNSW cannot delete in place; dead ids still inside segments/delta are masked at search time
+    std::unordered_set<long> tombstones_;
+
+    // 🧹 Background fold / merge / compaction. One worker runs jobs until none is due:
+    // fold the delta into a segment, merge a run of segments, or rebuild everything from live vectors.
+    std::thread compaction_thread_;
+    std::atomic<bool> compacting_{false};
+    long index_epoch_ = 0; // Bumped whenever load() swaps the index under a running compaction
+    bool rebuild_pending_ = false; // Loaded index layout differs from config_
+
+    // 📦 nodes.bin stays mapped after load/save: loaded CodeNodes carry no embedding copy,
+    // their raw vectors are read straight from the mapping when the next save needs them.
+    mutable std::unique_ptr<node_store::Reader> mapped_;
+    mutable std::unordered_map<long, int64_t> mapped_row_; // FAISS id -> embedding row
+    mutable std::string mapped_path_;
+    mutable std::mutex persist_mutex_;
+
+    // 🔗 One link at a time; the link itself runs without write_mutex_
+    std::mutex link_mutex_;
 
-    mutable std::shared_mutex rw_mutex_; 
+    // Builds an empty index for config_. IVF-PQ is trained on the given sample, or
+    // starts as an exact flat staging index while fewer than kIvfPqMinTrain vectors exist.
+    std::unique_ptr<faiss::IndexIDMap2> make_index(const float* train = nullptr, size_t n_train = 0) const;
+    // Trains (if needed) and fills a new segment from normalized vectors. nullptr when ids is empty.
+    std::unique_ptr<faiss::IndexIDMap2> build_segment(const std::vector<long>& ids, const std::vector<float>& vecs) const;
+    std::unique_ptr<faiss::SearchParameters> make_search_params(const faiss::Index* inner, int k, int ef, int nprobe,
+                                                                faiss::IDSelector* sel) const;
+    std::shared_ptr<exact::ExactMatrix> make_chunk() const;
+    void coalesce_delta_locked(Snapshot& next);
+    std::shared_ptr<const Snapshot> current() const;
+    void publish_locked(std::shared_ptr<Snapshot> next);
+    bool exact_phase(const Snapshot& snap) const;
+    bool needs_rebuild_locked(const Snapshot& snap) const;
+    void reconcile_layout_locked(const Snapshot& snap);
+    void reconstruct(const Snapshot& snap, long id, float* out) const;
+    void vector_of_locked(const Snapshot& snap, long id, float* out) const;
+    void exact_filtered_search(const Snapshot& snap, const float* query, int k, const VectorFilter& filter,
+                               std::vector<FaissSearchResult>& results) const;
+    void drop_node_locked(Snapshot& next, const std::string& node_id);
+    static std::shared_ptr<const ReferenceGraph> link_snapshot(const Snapshot& snap);
+    void maybe_schedule_compaction(const Snapshot& snap);
+    void compact();
 };
 
-} // namespace code_assistance
\ No newline at end of file
+} // namespace code_assistance
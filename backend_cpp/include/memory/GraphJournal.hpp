@@ -0,0 +1,73 @@
+#pragma once
+#include <string>
+#include <vector>
+#include <mutex>
+#include <cstdio>
+#include <cstdint>
+#include <functional>
+#include <filesystem>
+#include "GraphTypes.hpp"
+
+namespace code_assistance {
+
+enum class JournalOp : uint8_t {
+    UPSERT_NODE = 1,
+    UPDATE_METADATA = 2,
+    REMOVE_NODE = 3,
+    CLEAR = 4
+};
+
+// One decoded WAL entry. UPSERT_NODE carries the full node + its raw embedding.
+struct JournalRecord {
+    JournalOp op;
+    NodeSpec spec;        // UPSERT_NODE (spec.id is the node id for every op)
+    std::string key;      // UPDATE_METADATA
+    std::string value;    // UPDATE_METADATA
+};
+
+// 📜 Append-only binary write-ahead log for PointerGraph mutations.
+// Layout: "SFWAL001" header, then [u32 payload_len][u32 crc32][payload] records.
+// A torn or corrupt tail (crash mid-append) ends replay and is truncated away.
+class GraphJournal {
+public:
+    explicit GraphJournal(const std::string& storage_path);
+    ~GraphJournal();
+
+    // Each record reaches the OS before append returns (fflush, no fsync), so a crashed process
+    // loses nothing. buffered: bulk ingest keeps records in memory until flush() or 1 MB.
+    void append_upsert(const PointerNode& node, const std::vector<float>& embedding, bool buffered = false);
+    void append_update_metadata(const std::string& node_id, const std::string& key, const std::string& value);
+    void append_remove(const std::string& node_id);
+    void append_clear();
+
+    // Pushes buffered records to disk (fflush + fsync). Cost is proportional to what was appended.
+    void flush();
+
+    // Records appended since the last rotate(); drives snapshot scheduling
+    size_t records_since_snapshot() const;
+
+    // --- SNAPSHOT PROTOCOL ---
+    // 1. rotate(): live log becomes graph.wal.1, a fresh graph.wal starts
+    // 2. caller writes the snapshot
+    // 3. discard_rotated(): snapshot is durable, graph.wal.1 is dropped
+    void rotate();
+    void discard_rotated();
+
+    // Replays graph.wal.1 (interrupted snapshot) then graph.wal. Returns records applied.
+    size_t replay(const std::function<void(const JournalRecord&)>& apply);
+
+private:
+    std::filesystem::path wal_path_;
+    std::filesystem::path rotated_path_;
+    std::FILE* file_ = nullptr;
+    std::string buffer_;
+    size_t records_since_snapshot_ = 0;
+    mutable std::mutex mutex_;
+
+    void open_locked();
+    void append_record_locked(const std::string& payload, bool buffered = false);
+    void flush_locked(bool durable);
+    size_t replay_file(const std::filesystem::path& path, const std::function<void(const JournalRecord&)>& apply);
+};
+
+}
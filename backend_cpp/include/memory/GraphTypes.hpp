@@ -86,4 +86,31 @@ struct PointerNode {
     }
 };
 
+// Lightweight reference returned by indexed lookups (no content / metadata copies)
+struct NodeHandle {
+    std::string id;
+    NodeType type = NodeType::UNKNOWN;
+    long long timestamp = 0;
+};
+
+// Predicate for PointerGraph::semantic_search, pushed down into the vector index
+struct SearchFilter {
+    std::vector<NodeType> types;                                // Any of these (empty = all types)
+    std::string path_prefix;                                    // "file_path" metadata prefix
+    std::unordered_map<std::string, std::string> metadata;      // Every key must match exactly
+
+    bool empty() const { return types.empty() && path_prefix.empty() && metadata.empty(); }
+};
+
+// Input record for PointerGraph::add_nodes_bulk
+struct NodeSpec {
+    std::string id;             // Stable id to upsert under; empty = generate a new UUID
+    std::string content;
+    NodeType type = NodeType::CONTEXT_CODE;
+    std::string parent_id;
+    std::vector<float> embedding;
+    std::unordered_map<std::string, std::string> metadata;
+    long long timestamp = 0;    // 0 = stamp with the current time (WAL replay passes the original)
+};
+
 }
\ No newline at end of file
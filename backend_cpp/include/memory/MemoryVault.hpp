@@ -31,7 +31,7 @@ public:
         auto node = create_memory_node(situation, solution, embedding, 1.0); // 1.0 = Positive
         store_->add_nodes({node});
         save();
-        spdlog::info("🧠 Experience Vault: Learned SUCCESS pattern. Total: {}", store_->get_all_nodes().size());
+        spdlog::info("🧠 Experience Vault: Learned SUCCESS pattern. Total: {}", store_->size());
     }
 
     // ⛔ STORE: Save a failed attempt (Anti-Pattern)
@@ -40,16 +40,16 @@ public:
         auto node = create_memory_node(situation, failed_attempt, embedding, -1.0); // -1.0 = Negative
         store_->add_nodes({node});
         save();
-        spdlog::info("🧠 Experience Vault: Recorded FAILURE pattern. Total: {}", store_->get_all_nodes().size());
+        spdlog::info("🧠 Experience Vault: Recorded FAILURE pattern. Total: {}", store_->size());
     }
 
     // 🧠 RECALL: Find relevant past experiences
-    MemoryRecallResult recall(const std::vector<float>& query_vec) {
+    MemoryRecallResult recall(const std::vector<float>& query_vec, const SearchParams& params = {}) {
         MemoryRecallResult result;
-        if (!store_ || store_->get_all_nodes().empty()) return result;
+        if (!store_ || store_->size() == 0) return result;
 
         // Search for top k most relevant memories
-        auto results = store_->search(query_vec, 10); // Search deeper (10) to find unique ones
+        auto results = store_->search(query_vec, 10, params); // Search deeper (10) to find unique ones
         if (results.empty()) return result;
 
         std::unordered_set<std::string> seen_content; // 🚀 Deduplication Set
@@ -93,7 +93,7 @@ public:
     }
 
     std::string get_stats() {
-        return "Total Memories: " + std::to_string(store_->get_all_nodes().size());
+        return "Total Memories: " + std::to_string(store_->size());
     }
 
 private:
@@ -121,7 +121,7 @@ private:
         if (fs::exists(path_ + "/faiss.index")) {
             try { 
                 store_->load(path_); 
-                spdlog::info("🧠 Memory Vault Loaded: {} items", store_->get_all_nodes().size());
+                spdlog::info("🧠 Memory Vault Loaded: {} items", store_->size());
             } catch(...) { 
                 spdlog::warn("⚠️ Memory Vault corrupted. Resetting."); 
             }
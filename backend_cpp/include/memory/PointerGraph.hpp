@@ -2,9 +2,16 @@
 #include <string>
 #include <vector>
 #include <unordered_map>
+#include <unordered_set>
 #include <memory>
 #include <shared_mutex>
+#include <span>
+#include <set>
+#include <optional>
+#include <thread>
+#include <atomic>
 #include "GraphTypes.hpp"
+#include "GraphJournal.hpp"
 #include "faiss_vector_store.hpp" // Reuse your existing robust HNSW wrapper
 
 namespace code_assistance {
@@ -12,7 +19,7 @@ namespace code_assistance {
 class PointerGraph {
 public:
     // Initialize with storage path and vector dimension (default Gemini=768)
-    PointerGraph(const std::string& storage_path, int dimension = 768);
+    PointerGraph(const std::string& storage_path, int dimension = 768, VectorIndexConfig index_config = {});
     ~PointerGraph();
 
     // --- WRITE OPERATIONS ---
@@ -25,13 +32,41 @@ public:
                          const std::vector<float>& embedding = {},
                          const std::unordered_map<std::string, std::string>& metadata = {});
 
+    // Inserts or replaces a node under a caller-chosen stable id (e.g. CodeNode::id from sync).
+    // Children links of an existing node are preserved; its vector is re-indexed in place.
+    std::string upsert_node(const std::string& node_id,
+                            const std::string& content,
+                            NodeType type,
+                            const std::vector<float>& embedding = {},
+                            const std::unordered_map<std::string, std::string>& metadata = {});
+
+    // Batched ingestion: one lock, one FAISS add, one journal flush. Returns the id of every spec in order.
+    std::vector<std::string> add_nodes_bulk(std::span<const NodeSpec> specs);
+
+    // Drops nodes and tombstones their vectors. Returns how many existed.
+    size_t remove_nodes(const std::vector<std::string>& node_ids);
+
+    // Drops every node whose "file_path" metadata matches (stale symbols of a re-synced file)
+    size_t remove_file_nodes(const std::string& file_path);
+
+    // 🔗 Relinks the vector store's reference graph after a batch of code changes (no-op if none)
+    void link_references();
+
     // Updates metadata (e.g., marking a tool call as "failed" after execution)
     void update_metadata(const std::string& node_id, const std::string& key, const std::string& value);
 
     // --- READ OPERATIONS ---
 
     // Semantic Search: "Find me similar code/thoughts"
-    std::vector<PointerNode> semantic_search(const std::vector<float>& query_vec, int k = 5);
+    // The filter runs inside the index walk, so e.g. a code-only query still returns k code nodes.
+    // params trades recall for latency per call (see SearchParams).
+    std::vector<PointerNode> semantic_search(const std::vector<float>& query_vec, int k = 5, const SearchFilter& filter = {},
+                                             const SearchParams& params = {});
+
+    // Batched semantic search: one index call for all queries, results[i] answers query_vecs[i]
+    std::vector<std::vector<PointerNode>> semantic_search_batch(const std::vector<std::vector<float>>& query_vecs,
+                                                                int k = 5, const SearchFilter& filter = {},
+                                                                const SearchParams& params = {});
 
     // Graph Traversal: "What happened after node X?"
     std::vector<PointerNode> get_children(const std::string& node_id);
@@ -39,17 +74,33 @@ public:
     // Graph Trace: "Reconstruct the chain that led to node X" (Backwards walk)
     std::vector<PointerNode> get_trace(const std::string& end_node_id);
 
-    // Metadata Filter: "Find all failed tool calls"
+    // Metadata Filter: "Find all failed tool calls" (deep copies, oldest first)
     std::vector<PointerNode> query_by_metadata(const std::string& key, const std::string& value);
 
+    // Indexed lookups: handles only, oldest first
+    std::vector<NodeHandle> find_by_metadata(const std::string& key, const std::string& value) const;
+
+    // Newest node tagged key=value (e.g. the session cursor). O(log n).
+    std::optional<NodeHandle> latest_by_metadata(const std::string& key, const std::string& value) const;
+
     // Returns concatenated code snippets relevant to the query
     std::string get_relevant_context(const std::string& query, int max_chars = 4000);
 
+    bool contains(const std::string& node_id) const;
+
+    // File paths that currently own at least one node
+    std::vector<std::string> indexed_files() const;
+
     void clear();
 
     // --- PERSISTENCE ---
+    // Mutations are journaled as they happen; save() only makes the journal durable
+    // and kicks off a background snapshot once enough records have piled up.
     void save();
+    // Snapshot (graph.bin + faiss.index/nodes.bin) followed by WAL replay
     void load();
+    // Writes a compacted snapshot and truncates the WAL. Readers are never blocked.
+    void snapshot();
 
     size_t get_node_count() const { 
         std::shared_lock lock(data_mutex_);
@@ -59,17 +110,46 @@ public:
 private:
     std::string storage_path_;
     int dimension_;
+    VectorIndexConfig index_config_;
     
     // Dual Index System
-    std::unique_ptr<FaissVectorStore> vector_store_; // HNSW Index
+    std::shared_ptr<FaissVectorStore> vector_store_; // HNSW Index (shared: link_references holds it past the lock)
     std::unordered_map<std::string, PointerNode> nodes_; // Graph Adjacency
     std::unordered_map<long, std::string> faiss_to_uuid_; // Bridge Vector ID -> UUID
+    std::unordered_map<NodeType, std::unordered_set<long>> vectors_by_type_; // NodeType -> live FAISS ids (filter pushdown)
+
+    // 🗂️ Inverted metadata index: key -> value -> postings ordered by (timestamp, id)
+    using Postings = std::set<std::pair<long long, std::string>>;
+    std::unordered_map<std::string, std::unordered_map<std::string, Postings>> meta_index_;
 
     mutable std::shared_mutex data_mutex_;
 
-    std::string generate_uuid();
+    // 📜 Write-ahead log + snapshot compaction
+    std::unique_ptr<GraphJournal> journal_;
+    bool replaying_ = false;                 // Suppresses journaling while load() replays the WAL
+    std::thread snapshot_thread_;
+    std::atomic<bool> snapshotting_{false};
+    std::mutex snapshot_mutex_;              // One snapshot writer at a time
 
-    void save_internal(); 
+    std::string generate_uuid();
+    std::vector<std::string> generate_uuid_block(size_t count);
+
+    std::shared_ptr<CodeNode> make_vector_node(const PointerNode& node, const std::vector<float>& embedding) const;
+    const Postings* postings_locked(const std::string& key, const std::string& value) const;
+    bool build_vector_filter_locked(const SearchFilter& filter, VectorFilter& vf, std::unordered_set<long>& meta_ids) const;
+    void index_meta_locked(const PointerNode& node, const std::string& key, const std::string& value);
+    void unindex_meta_locked(const PointerNode& node, const std::string& key, const std::string& value);
+    void index_node_locked(const PointerNode& node);
+    void track_vector_locked(const PointerNode& node);
+    void untrack_vector_locked(const PointerNode& node);
+    void unindex_node_locked(const PointerNode& node);
+    size_t remove_nodes_locked(const std::vector<std::string>& node_ids);
+    std::vector<std::string> upsert_locked(std::span<const NodeSpec> specs, bool bulk = false);
+    void update_metadata_locked(const std::string& node_id, const std::string& key, const std::string& value);
+    void clear_locked();
+
+    void maybe_schedule_snapshot();
+    void write_graph_store(const std::vector<PointerNode>& nodes) const;
 };
 
 }
\ No newline at end of file
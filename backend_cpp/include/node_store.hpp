@@ -0,0 +1,171 @@
+#pragma once
+
+#include "code_graph.hpp"
+#include "memory/GraphTypes.hpp"
+#include "utils/MappedFile.hpp"
+#include <cstdint>
+#include <span>
+#include <string>
+#include <string_view>
+#include <vector>
+
+namespace code_assistance {
+
+// 📦 Versioned binary node file, mmap-loaded (replaces metadata.json / graph.json).
+//
+// Layout (offsets from file start, host byte order, every section 8-byte aligned):
+//   Header
+//   records[record_count]     fixed-size CodeNodeRecord or PointerNodeRecord
+//   refs[ref_count]           StrRef table (dependencies, children, metadata key/value pairs)
+//   weights[weight_count]     WeightEntry table (CodeNode::weights)
+//   longs[long_count]         int64 table (FaissVectorStore tombstones)
+//   files[file_count]         FileEntry table, sorted by path (v2, CODE_NODES: records grouped by file_path)
+//   file_records[...]         uint64 record indices, one contiguous run per FileEntry (v2)
+//   symbol_refs[...]          SymbolRefEntry table (v3, CODE_NODES: CodeNode::references)
+//   record_refs[record_count] ListRef per code record into symbol_refs (v3)
+//   floats[rows * dimension]  raw embedding block, 64-byte aligned
+//   strings                   one UTF-8 blob, addressed by StrRef
+namespace node_store {
+
+constexpr char kMagic[8] = {'S', 'F', 'N', 'O', 'D', 'E', 'S', '\0'};
+constexpr uint32_t kVersion = 3; // v1 (no file index) and v2 (no references) files are still read
+
+enum class Kind : uint32_t { CODE_NODES = 1, POINTER_NODES = 2 };
+
+struct StrRef { uint64_t offset; uint64_t length; };
+struct ListRef { uint64_t first; uint64_t count; };
+
+struct Header {
+    char magic[8];
+    uint32_t version;
+    uint32_t kind;
+    uint64_t record_count;
+    uint64_t records_offset;
+    uint64_t refs_offset, ref_count;
+    uint64_t weights_offset, weight_count;
+    uint64_t longs_offset, long_count;
+    uint64_t floats_offset, float_rows;
+    uint32_t dimension;
+    uint32_t reserved;
+    uint64_t strings_offset, strings_size;
+    int64_t next_id;          // FaissVectorStore id allocator
+    // v2 and later
+    uint64_t files_offset, file_count;
+    uint64_t file_records_offset, file_record_count;
+    // v3 and later
+    uint64_t symbol_refs_offset, symbol_ref_count;
+    uint64_t record_refs_offset, record_ref_count;
+};
+
+struct CodeNodeRecord {
+    StrRef id, name, content, docstring, file_path, type, ai_summary;
+    ListRef dependencies;     // -> refs
+    ListRef weights;          // -> weights
+    double ai_quality_score;
+    int64_t faiss_id;
+    int64_t embedding_row;    // -1 = no vector
+};
+
+struct PointerNodeRecord {
+    StrRef id, parent_id, content;
+    ListRef children;         // -> refs
+    ListRef metadata;         // -> refs, (key, value) pairs
+    int64_t timestamp;
+    int64_t faiss_id;
+    uint32_t type;
+    uint32_t reserved;
+};
+
+struct WeightEntry { StrRef key; double value; };
+struct FileEntry { StrRef file_path; ListRef records; }; // records -> file_records
+struct SymbolRefEntry { StrRef name; uint32_t kind; uint32_t reserved; }; // kind = RefKind
+
+// Accumulates nodes in memory, then writes the whole file (tmp + rename)
+class Writer {
+public:
+    Writer(Kind kind, uint32_t dimension = 0);
+
+    // Returns the embedding row (-1 if the span is empty)
+    int64_t add_code_node(const CodeNode& node, int64_t faiss_id, std::span<const float> embedding);
+    void add_pointer_node(const PointerNode& node);
+
+    void set_next_id(int64_t next_id) { next_id_ = next_id; }
+    void set_longs(std::vector<int64_t> longs) { longs_ = std::move(longs); }
+
+    // Writes <path>.tmp; commit() renames it over <path>
+    bool write_tmp(const std::string& path) const;
+    static bool commit(const std::string& path);
+    bool write(const std::string& path) const { return write_tmp(path) && commit(path); }
+
+private:
+    Kind kind_;
+    uint32_t dimension_;
+    int64_t next_id_ = 0;
+    std::vector<CodeNodeRecord> code_records_;
+    std::vector<PointerNodeRecord> pointer_records_;
+    std::vector<StrRef> refs_;
+    std::vector<WeightEntry> weights_;
+    std::vector<int64_t> longs_;
+    std::vector<SymbolRefEntry> symbol_refs_;
+    std::vector<ListRef> record_refs_; // Parallel to code_records_
+    std::vector<float> floats_;
+    std::string strings_;
+
+    StrRef add_string(std::string_view s);
+};
+
+// Zero-copy view over a mapped node file. Every string_view / span points into the
+// mapping and stays valid for the Reader's lifetime.
+class Reader {
+public:
+    bool open(const std::string& path, Kind expected);
+    bool is_open() const { return header_ != nullptr; }
+
+    size_t size() const { return header_ ? header_->record_count : 0; }
+    int64_t next_id() const { return header_ ? header_->next_id : 0; }
+    uint32_t dimension() const { return header_ ? header_->dimension : 0; }
+    std::span<const int64_t> longs() const { return longs_; }
+
+    const CodeNodeRecord& code_record(size_t i) const { return code_records_[i]; }
+    const PointerNodeRecord& pointer_record(size_t i) const { return pointer_records_[i]; }
+
+    std::string_view str(const StrRef& ref) const;
+    std::span<const StrRef> refs(const ListRef& list) const;
+    std::span<const WeightEntry> weights(const ListRef& list) const;
+    std::span<const float> embedding(int64_t row) const;
+
+    // 🗂️ Code nodes by file (v2 files; a v1 file has no index and returns empty spans)
+    bool has_file_index() const { return has_file_index_; }
+    std::span<const FileEntry> files() const { return files_; }
+    std::span<const uint64_t> file_records(const FileEntry& file) const;
+    std::span<const uint64_t> records_of(std::string_view file_path) const; // Binary search
+
+    // 🔗 A code record's CodeNode::references (empty before v3)
+    std::span<const SymbolRefEntry> references(size_t i) const;
+
+    // Materializers: strings are copied once, embeddings only on request
+    CodeNode to_code_node(size_t i, bool with_embedding) const;
+    PointerNode to_pointer_node(size_t i) const;
+
+private:
+    MappedFile file_;
+    const Header* header_ = nullptr;
+    std::span<const CodeNodeRecord> code_records_;
+    std::span<const PointerNodeRecord> pointer_records_;
+    std::span<const StrRef> refs_;
+    std::span<const WeightEntry> weights_;
+    std::span<const int64_t> longs_;
+    std::span<const FileEntry> files_;
+    std::span<const uint64_t> file_records_;
+    std::span<const SymbolRefEntry> symbol_refs_;
+    std::span<const ListRef> record_refs_;
+    bool has_file_index_ = false;
+    const float* floats_ = nullptr;
+    std::string_view strings_;
+};
+
+// Admin export: renders a mapped PointerNode file as the graph.json array
+std::string export_pointer_nodes_json(const std::string& path);
+
+} // namespace node_store
+} // namespace code_assistance
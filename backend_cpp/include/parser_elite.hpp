@@ -23,11 +23,21 @@ public:
     // 🛡️ The Eyes of the Journal: Returns true if code is syntactically perfect
     bool validate_syntax(const std::string& content, const std::string& extension);
 
-    // 🛰️ The Map Maker: Breaks file into logical nodes
-    std::vector<CodeNode> extract_symbols(const std::string& path, const std::string& content);
+    // 🛰️ The Map Maker: Breaks file into logical nodes (slices of `source`, nothing copied).
+    // One pass of the language's symbol query fills in each node's name, docstring and the names it
+    // references (calls, base classes, types) as `references`.
+    std::vector<CodeNode> extract_symbols(const std::string& path, const FileBuffer::Ptr& source);
+
+    // 🌲 Incremental mode (single-file syncs): each file's syntax tree and symbols are kept in a
+    // process-wide LRU. The next version of the file is diffed against the cached source, the tree
+    // is edited and reparsed incrementally, and only symbols in changed ranges are extracted again.
+    void set_incremental(bool on) { incremental_ = on; }
+    static void forget_tree(const std::string& path);
 
 private:
     TSParser* parser_;
+    TSQueryCursor* cursor_;
+    bool incremental_ = false;
     const TSLanguage* get_lang(const std::string& ext);
 };
 
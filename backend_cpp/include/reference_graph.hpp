@@ -0,0 +1,55 @@
+#pragma once
+#include <cstdint>
+#include <memory>
+#include <span>
+#include <string>
+#include <utility>
+#include <vector>
+#include "code_graph.hpp"
+
+namespace code_assistance {
+
+// 🔗 Project-wide reference graph: who calls, inherits from, uses as a type or imports whom.
+//
+// Vertices are the live nodes of a FaissVectorStore in ascending FAISS id order (vertex v owns
+// faiss_id(v)); edges are CSR: the targets of v are targets_[offsets_[v] .. offsets_[v + 1]),
+// with one RefKind byte per edge. Immutable once linked, so any number of readers may walk it.
+//
+// On disk (refs.bin, next to faiss.index and nodes.bin, host byte order):
+//   Header                        magic, version, vertex / edge counts, the store's next_id
+//   faiss_ids[vertex_count]       int64
+//   offsets[vertex_count + 1]     uint64
+//   targets[edge_count]           uint32
+//   kinds[edge_count]             uint8
+class ReferenceGraph {
+public:
+    // Resolves every node's references (and imports) against a symbol table of all of them.
+    // `nodes` must be in ascending FAISS id order and stay alive for the call.
+    static std::shared_ptr<ReferenceGraph> link(const std::vector<std::pair<long, const CodeNode*>>& nodes);
+
+    // `stamp` identifies the node set the graph was linked from (the store's next_id)
+    bool save(const std::string& file, int64_t stamp) const;
+    static std::shared_ptr<ReferenceGraph> load(const std::string& file, int64_t& stamp);
+
+    size_t size() const { return faiss_ids_.size(); }
+    size_t edge_count() const { return targets_.size(); }
+
+    long faiss_id(uint32_t v) const { return faiss_ids_[v]; }
+    // -1 if the id has no vertex (binary search: vertices are sorted by id)
+    int64_t vertex_of(long faiss_id) const;
+
+    std::span<const uint32_t> targets(uint32_t v) const {
+        return {targets_.data() + offsets_[v], (size_t)(offsets_[v + 1] - offsets_[v])};
+    }
+    std::span<const RefKind> kinds(uint32_t v) const {
+        return {kinds_.data() + offsets_[v], (size_t)(offsets_[v + 1] - offsets_[v])};
+    }
+
+private:
+    std::vector<long> faiss_ids_;
+    std::vector<uint64_t> offsets_{0};
+    std::vector<uint32_t> targets_;
+    std::vector<RefKind> kinds_;
+};
+
+} // namespace code_assistance
@@ -39,6 +39,7 @@ public:
         }
 
         std::vector<std::shared_ptr<CodeNode>> skill_nodes;
+        std::vector<std::string> texts;
         int count = 0;
 
         for (const auto& entry : fs::recursive_directory_iterator(root_path_)) {
@@ -53,25 +54,25 @@ public:
                 node->type = "BUSINESS_RULE";
                 node->file_path = entry.path().string();
                 
-                // Generate Embedding for the Skill
-                // In production, cache this to avoid re-embedding on every restart
-                node->embedding = ai_->generate_embedding(content.substr(0, 1000)); 
-                
+                texts.push_back(content.substr(0, 1000));
                 skill_nodes.push_back(node);
                 count++;
             }
         }
 
         if (!skill_nodes.empty()) {
+            // One batch for every skill; unchanged ones come from the embedding cache after the first start
+            auto embs = ai_->generate_embeddings_batch(texts);
+            for (size_t i = 0; i < embs.size() && i < skill_nodes.size(); ++i) skill_nodes[i]->embedding = std::move(embs[i]);
             vector_store_->add_nodes(skill_nodes);
             spdlog::info("🧠 Skill Library: Loaded {} business capability modules.", count);
         }
     }
 
     // Retrieve relevant business rules based on user query
-    std::string retrieve_skills(const std::string& query, const std::vector<float>& query_vec) {
+    std::string retrieve_skills(const std::string& query, const std::vector<float>& query_vec, const SearchParams& params = {}) {
         // 1. Search Vector Store
-        auto results = vector_store_->search(query_vec, 3); // Top 3
+        auto results = vector_store_->search(query_vec, 3, params); // Top 3
         std::stringstream ss;
         bool header_added = false;
         
@@ -0,0 +1,57 @@
+#pragma once
+#include <cstdint>
+#include <filesystem>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
+
+namespace code_assistance {
+
+namespace fs = std::filesystem;
+
+// 🌳 Content-addressed sync manifest (data/<project>/manifest.json).
+// Every indexed file keeps an XXH3-64 content hash plus the size / mtime it was hashed at, and every
+// directory keeps its mtime, its filtered listing and a Merkle hash over its children.
+// Stat data only decides whether a file must be re-hashed; the content hash decides whether it is re-parsed.
+struct ManifestFile {
+    uint64_t hash = 0;   // XXH3-64 of the content (0 = unknown: migrated from a size-mtime manifest)
+    uint64_t size = 0;
+    int64_t mtime = 0;   // last_write_time ticks when hashed
+};
+
+struct ManifestDir {
+    int64_t mtime = 0;               // The OS bumps this whenever an entry is added, removed or renamed
+    uint64_t merkle = 0;             // Over (name, hash) of every indexed file and subdirectory below
+    std::vector<std::string> files;  // Indexed files directly inside, sorted
+    std::vector<std::string> dirs;   // Scanned subdirectories, sorted
+};
+
+class SyncManifest {
+public:
+    static uint64_t hash_content(std::string_view data);
+
+    // Reads both this format and the legacy {"path": "size-mtime"} map
+    bool load(const fs::path& file);
+    bool save(const fs::path& file) const;
+
+    // Bottom-up pass over dirs; returns the root ("") hash
+    uint64_t compute_merkle();
+    uint64_t root() const;
+
+    // Stat data is only trusted if it predates the previous scan by more than the filesystem's
+    // timestamp granularity: a write in the same tick as that scan would otherwise go unnoticed
+    bool settled(int64_t mtime) const;
+
+    bool empty() const { return files.empty(); }
+
+    std::unordered_map<std::string, ManifestFile> files;  // Generic relative path -> entry
+    std::unordered_map<std::string, ManifestDir> dirs;    // Generic relative dir ("" = root) -> entry
+    uint64_t filter_hash = 0;  // Filters the cached listings were taken with
+    int64_t scanned_at = 0;    // file_time ticks when the scan that wrote this manifest started
+
+private:
+    uint64_t merkle_of(const std::string& dir);
+};
+
+} // namespace code_assistance
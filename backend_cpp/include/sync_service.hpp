@@ -1,12 +1,15 @@
 #pragma once
 #include <filesystem>
+#include <functional>
 #include <vector>
 #include <string>
 #include <unordered_map>
 #include <unordered_set>
 #include <memory>
+#include "PrefixTrie.hpp"
 #include "code_graph.hpp"
 #include "embedding_service.hpp"
+#include "sync_manifest.hpp"
 
 namespace code_assistance {
 
@@ -18,13 +21,51 @@ struct FilterConfig {
     std::vector<std::string> whitelist; 
 };
 
+// Normalizes extensions (no dot, lower case) exactly like a full sync does
+FilterConfig make_filter_config(
+    const std::vector<std::string>& allowed_extensions,
+    const std::vector<std::string>& ignored_paths,
+    const std::vector<std::string>& included_paths
+);
+
+// The rules the sync walker applies, for a single generic relative path: every directory on the way down
+// must survive the trie (an ignored directory hides everything below it), files also need an allowed extension
+bool is_path_indexed(const PrefixTrie& trie, const FilterConfig& cfg, const std::string& rel_path, bool is_dir);
+
+// Where a project's graph (graph.bin, faiss.index, nodes.bin) is persisted: data/graphs/<id>,
+// path separators and ':' in the id replaced by '_'
+std::string project_graph_dir(const std::string& project_id);
+
 struct SyncResult {
+    // Freshly parsed nodes are slices of their file's buffer (CodeNode::text()); ingestion copies
+    // the code it keeps, and the buffers go away with the last node that references them
     std::vector<std::shared_ptr<CodeNode>> nodes;
     int updated_count = 0;
     int deleted_count = 0;
     std::vector<std::string> logs;
+
+    // Drives incremental ingestion: only these files touch the vector index
+    std::unordered_set<std::string> changed_files;
+    std::vector<std::string> removed_files;
+    bool full_rebuild = false; // No manifest -> every file counts as changed
+    // Changed files left without vectors or rejected by the sink: they keep their old nodes, and the
+    // manifest records them with no hash so the next sync parses and embeds them again
+    std::vector<std::string> failed_files;
+
+    uint64_t manifest_root = 0; // Merkle root of the indexed tree; equal roots = nothing changed
+    int rehashed_count = 0;     // Files whose stat data moved and were read + hashed
+
+    // The changed files already reached the sink batch by batch (embedded, ready to upsert);
+    // ingesting this final result only has removals, stale files and never-seen nodes left to do
+    bool streamed = false;
+    // One streamed batch of a sync still running (the final result follows)
+    bool partial = false;
 };
 
+// Receives partial results while a sync is still running: whole changed files (a file's nodes are
+// never split across two calls), already embedded. Called from one pipeline thread, one call at a time.
+using SyncSink = std::function<void(const SyncResult& partial)>;
+
 class SyncService {
 public:
     explicit SyncService(std::shared_ptr<EmbeddingService> embedding_service);
@@ -36,7 +77,22 @@ public:
         const std::string& storage_path, 
         const std::vector<std::string>& allowed_extensions,
         const std::vector<std::string>& ignored_paths,
-        const std::vector<std::string>& included_paths
+        const std::vector<std::string>& included_paths,
+        const SyncSink& sink = {}
+    );
+
+    // ⚡ Incremental sync of just these paths (watch mode, /sync/file). A directory stands for everything
+    // below it, on disk and in the manifest. Only files whose content hash moved are parsed and embedded;
+    // vanished ones land in removed_files. Falls back to perform_sync (streaming into sink) when there is no manifest yet.
+    SyncResult sync_paths(
+        const std::string& project_id,
+        const std::string& source_dir,
+        const std::string& storage_path,
+        const std::vector<std::string>& allowed_extensions,
+        const std::vector<std::string>& ignored_paths,
+        const std::vector<std::string>& included_paths,
+        const std::vector<std::string>& rel_paths,
+        const SyncSink& sink = {}
     );
 
     // Atomic file sync
@@ -49,26 +105,19 @@ public:
 
     // Logic Gatekeepers (Only one declaration of each!)
     bool should_index(const fs::path& rel_path, const FilterConfig& cfg);
-    
-    void recursive_scan(
-        const fs::path& current_dir,
-        const fs::path& root_dir,
-        const fs::path& storage_dir,
-        const FilterConfig& cfg,
-        std::vector<fs::path>& results
-    );
+
+    // Previously indexed nodes by file_path: an unchanged file splices in its list as is
+    using NodesByFile = std::unordered_map<std::string, std::vector<std::shared_ptr<CodeNode>>>;
 
 private:
     std::shared_ptr<EmbeddingService> embedding_service_;
 
     // Internal Helpers
-    std::string calculate_file_hash(const std::filesystem::path& file_path);
-    std::unordered_map<std::string, std::string> load_manifest(const std::string& project_id);
-    void save_manifest(const std::string& project_id, const std::unordered_map<std::string, std::string>& manifest);
-    void generate_embeddings_batch(std::vector<std::shared_ptr<CodeNode>>& nodes, int batch_size = 50);
+    fs::path manifest_path(const std::string& project_id) const;
+    void generate_embeddings_batch(std::vector<std::shared_ptr<CodeNode>>& nodes);
     void generate_tree_file(const fs::path& base_dir, const std::vector<fs::path>& files, const fs::path& output_file);
-    std::unordered_map<std::string, std::shared_ptr<CodeNode>> load_existing_nodes(const std::string& storage_path);
-    void update_file_context(const std::string& file_path, const std::string& content);
+    NodesByFile load_existing_nodes(const std::string& project_id, const std::string& storage_path);
+    void update_file_context(const std::string& file_path, std::string_view content);
 };
 
 } // namespace code_assistance
\ No newline at end of file
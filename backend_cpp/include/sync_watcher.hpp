@@ -0,0 +1,80 @@
+#pragma once
+#include <atomic>
+#include <chrono>
+#include <filesystem>
+#include <functional>
+#include <string>
+#include <thread>
+#include <unordered_map>
+#include <unordered_set>
+#include <vector>
+#include "PrefixTrie.hpp"
+#include "sync_service.hpp"
+
+namespace code_assistance {
+
+namespace fs = std::filesystem;
+
+struct WatchOptions {
+    // A batch is flushed once the tree has been quiet this long...
+    std::chrono::milliseconds debounce{150};
+    // ...or this long after its first event, whichever comes first, so a busy tree still indexes
+    std::chrono::milliseconds max_delay{750};
+};
+
+// 👁️ Continuous incremental indexing for one project (Linux inotify).
+// One watch per indexed directory (ignored subtrees are never watched, storage_dir is skipped);
+// events are coalesced into a set of generic relative paths and handed to the handler on the
+// watcher's own thread, so batches of one project never overlap. A kernel queue overflow is
+// reported as `overflow = true`: events were lost and only a full sync is safe.
+// fanotify would avoid per-directory watches but needs CAP_SYS_ADMIN, which the server does not have.
+class ProjectWatcher {
+public:
+    using Handler = std::function<void(const std::vector<std::string>& rel_paths, bool overflow)>;
+
+    ProjectWatcher(std::string project_id, const fs::path& root_dir, const fs::path& storage_dir,
+                   FilterConfig cfg, Handler handler, WatchOptions options = {});
+    ~ProjectWatcher();
+
+    ProjectWatcher(const ProjectWatcher&) = delete;
+    ProjectWatcher& operator=(const ProjectWatcher&) = delete;
+
+    // False (and a log line) when the platform has no inotify or the root cannot be watched
+    bool start();
+    void stop();
+
+    bool running() const { return running_.load(); }
+    size_t watch_count() const { return watch_count_.load(); }
+
+private:
+    void run();
+    void drain_events();
+    // Watches rel_dir and every indexed directory below it
+    void add_watch_tree(const std::string& rel_dir);
+    void remove_watch_tree(const std::string& rel_dir);
+    void mark(const std::string& rel_path);
+
+    std::string project_id_;
+    fs::path root_dir_;
+    fs::path storage_dir_;
+    FilterConfig cfg_;
+    PrefixTrie trie_;
+    Handler handler_;
+    WatchOptions options_;
+
+    int inotify_fd_ = -1;
+    int wake_fd_ = -1; // eventfd: stop() wakes the poll loop through it
+    std::thread thread_;
+    std::atomic<bool> running_{false};
+    std::atomic<size_t> watch_count_{0};
+
+    // NO LOCK HERE - only touched by the watcher thread (and start() before it exists)
+    std::unordered_map<int, std::string> wd_to_dir_;
+    std::unordered_map<std::string, int> dir_to_wd_;
+    std::unordered_set<std::string> pending_;
+    bool overflow_ = false;
+    std::chrono::steady_clock::time_point first_event_;
+    std::chrono::steady_clock::time_point last_event_;
+};
+
+} // namespace code_assistance
@@ -0,0 +1,84 @@
+#pragma once
+#include <cstddef>
+#include <filesystem>
+#include <fstream>
+#include <iterator>
+#include <memory>
+#include <string>
+#include <string_view>
+
+#ifndef _WIN32
+#include <cerrno>
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+namespace code_assistance {
+
+// 📄 One file's bytes, loaded once and shared read-only by everything that looks at them during a
+// sync: the content hash, the parsers, the symbol nodes (as slices), the aggregate context writer
+// and the ghost-text preloader. Immutable after load, so any number of threads may read it.
+//
+// Always a heap copy, never a mapping: syncs run while the user is editing, and editors and
+// formatters that truncate and rewrite a file in place would SIGBUS a reader of a mapped one.
+class FileBuffer {
+public:
+    using Ptr = std::shared_ptr<const FileBuffer>;
+
+    static Ptr from_string(std::string bytes) {
+        auto buf = std::make_shared<FileBuffer>();
+        buf->owned_ = std::move(bytes);
+        buf->view_ = buf->owned_;
+        return buf;
+    }
+
+    // nullptr if the file cannot be opened
+    static Ptr load(const std::string& path) {
+#ifdef _WIN32
+        std::ifstream in(path, std::ios::binary);
+        if (!in) return nullptr;
+        return from_string(std::string(std::istreambuf_iterator<char>(in), std::istreambuf_iterator<char>()));
+#else
+        int fd = ::open(path.c_str(), O_RDONLY | O_CLOEXEC);
+        if (fd < 0) return nullptr;
+        Ptr buf = load(fd);
+        ::close(fd);
+        return buf;
+#endif
+    }
+
+#ifndef _WIN32
+    // From a descriptor the caller opened (and still closes)
+    static Ptr load(int fd) {
+        struct stat st;
+        if (::fstat(fd, &st) != 0) return nullptr;
+        auto buf = std::make_shared<FileBuffer>();
+        // Straight into the string; a file that grows or shrinks meanwhile just yields what read() saw
+        std::string& bytes = buf->owned_;
+        bytes.resize(st.st_size > 0 ? (size_t)st.st_size : 0);
+        size_t filled = 0;
+        while (true) {
+            if (filled == bytes.size()) bytes.resize(filled + 64 * 1024);
+            ssize_t n = ::read(fd, bytes.data() + filled, bytes.size() - filled);
+            if (n < 0 && errno == EINTR) continue;
+            if (n <= 0) break;
+            filled += (size_t)n;
+        }
+        bytes.resize(filled);
+        buf->view_ = bytes;
+        return buf;
+    }
+#endif
+
+    std::string_view view() const { return view_; }
+    std::string_view slice(size_t offset, size_t length) const { return view_.substr(offset, length); }
+    const char* data() const { return view_.data(); }
+    size_t size() const { return view_.size(); }
+
+private:
+    std::string owned_;
+    std::string_view view_;
+};
+
+} // namespace code_assistance
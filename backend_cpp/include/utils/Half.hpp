@@ -0,0 +1,58 @@
+#pragma once
+#include <cstdint>
+#include <cstring>
+
+namespace code_assistance {
+
+// 🔢 IEEE 754 binary16 <-> fp32, round to nearest even (exact-search fp16 rows, embedding cache)
+inline uint16_t float_to_half(float value) {
+    uint32_t x;
+    std::memcpy(&x, &value, sizeof(x));
+    uint32_t sign = (x >> 16) & 0x8000u;
+    uint32_t mag = x & 0x7fffffffu;
+
+    if (mag >= 0x7f800000u) return (uint16_t)(sign | (mag > 0x7f800000u ? 0x7e00u : 0x7c00u)); // NaN / Inf
+    if (mag >= 0x477ff000u) return (uint16_t)(sign | 0x7c00u);                                  // Overflow
+    if (mag < 0x38800000u) {
+        // Subnormal half (or zero): shift the implicit-one mantissa into place
+        if (mag < 0x33000000u) return (uint16_t)sign;
+        uint32_t exp = mag >> 23;
+        uint32_t mant = (mag & 0x7fffffu) | 0x800000u;
+        uint32_t shift = 126 - exp; // 14..24
+        uint32_t half = mant >> shift;
+        uint32_t rem = mant & ((1u << shift) - 1);
+        uint32_t mid = 1u << (shift - 1);
+        if (rem > mid || (rem == mid && (half & 1))) half++;
+        return (uint16_t)(sign | half);
+    }
+    uint32_t half = ((mag - 0x38000000u) >> 13);
+    uint32_t rem = mag & 0x1fffu;
+    if (rem > 0x1000u || (rem == 0x1000u && (half & 1))) half++;
+    return (uint16_t)(sign | half);
+}
+
+inline float half_to_float(uint16_t h) {
+    uint32_t sign = (uint32_t)(h & 0x8000u) << 16;
+    uint32_t exp = (h >> 10) & 0x1fu;
+    uint32_t mant = h & 0x3ffu;
+    uint32_t bits;
+    if (exp == 0) {
+        if (mant == 0) {
+            bits = sign;
+        } else {
+            // Renormalize the subnormal
+            exp = 113;
+            while (!(mant & 0x400u)) { mant <<= 1; exp--; }
+            bits = sign | (exp << 23) | ((mant & 0x3ffu) << 13);
+        }
+    } else if (exp == 31) {
+        bits = sign | 0x7f800000u | (mant << 13);
+    } else {
+        bits = sign | ((exp + 112) << 23) | (mant << 13);
+    }
+    float out;
+    std::memcpy(&out, &bits, sizeof(out));
+    return out;
+}
+
+} // namespace code_assistance
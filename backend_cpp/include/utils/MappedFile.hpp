@@ -0,0 +1,117 @@
+#pragma once
+#include <string>
+#include <cstddef>
+#include <string_view>
+
+#ifdef _WIN32
+#ifndef NOMINMAX
+#define NOMINMAX
+#endif
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+namespace code_assistance {
+
+// 🗺️ Read-only memory map of a whole file. Pages are faulted in lazily by the OS,
+// so "loading" a large file costs nothing until its bytes are actually touched.
+class MappedFile {
+public:
+    MappedFile() = default;
+    explicit MappedFile(const std::string& path) { open(path); }
+    ~MappedFile() { close(); }
+
+    MappedFile(const MappedFile&) = delete;
+    MappedFile& operator=(const MappedFile&) = delete;
+
+    bool open(const std::string& path) {
+        close();
+#ifdef _WIN32
+        file_ = CreateFileA(path.c_str(), GENERIC_READ, FILE_SHARE_READ | FILE_SHARE_DELETE,
+                            nullptr, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, nullptr);
+        if (file_ == INVALID_HANDLE_VALUE) return false;
+        LARGE_INTEGER sz;
+        if (!GetFileSizeEx(file_, &sz)) { close(); return false; }
+        size_ = (size_t)sz.QuadPart;
+        if (size_ == 0) return true;
+        mapping_ = CreateFileMappingA(file_, nullptr, PAGE_READONLY, 0, 0, nullptr);
+        if (!mapping_) { close(); return false; }
+        data_ = (const char*)MapViewOfFile(mapping_, FILE_MAP_READ, 0, 0, 0);
+        if (!data_) { close(); return false; }
+#else
+        int fd = ::open(path.c_str(), O_RDONLY);
+        if (fd < 0) return false;
+        bool ok = open(fd);
+        ::close(fd); // The mapping keeps the inode alive
+        return ok;
+#endif
+        return true;
+    }
+
+#ifndef _WIN32
+    // Maps a descriptor the caller already opened (e.g. with openat); the caller still closes it
+    bool open(int fd) {
+        close();
+        struct stat st;
+        if (fstat(fd, &st) != 0) return false;
+        size_ = (size_t)st.st_size;
+        if (size_ > 0) {
+            void* p = mmap(nullptr, size_, PROT_READ, MAP_SHARED, fd, 0);
+            if (p == MAP_FAILED) { size_ = 0; return false; }
+            data_ = (const char*)p;
+        }
+        return true;
+    }
+#endif
+
+    void close() {
+#ifdef _WIN32
+        if (data_) UnmapViewOfFile(data_);
+        if (mapping_) CloseHandle(mapping_);
+        if (file_ != INVALID_HANDLE_VALUE) CloseHandle(file_);
+        mapping_ = nullptr;
+        file_ = INVALID_HANDLE_VALUE;
+#else
+        if (data_) munmap((void*)data_, size_);
+#endif
+        data_ = nullptr;
+        size_ = 0;
+    }
+
+    // Asks the OS to read the whole file into the page cache ahead of use. populate = also
+    // wait for it by touching every page, so later faults are minor instead of disk reads.
+    void prefetch(bool populate = false) const {
+        if (!data_) return;
+#ifdef _WIN32
+#if defined(_WIN32_WINNT) && _WIN32_WINNT >= 0x0602
+        WIN32_MEMORY_RANGE_ENTRY range{(PVOID)data_, size_};
+        PrefetchVirtualMemory(GetCurrentProcess(), 1, &range, 0);
+#endif
+#else
+        madvise((void*)data_, size_, MADV_WILLNEED);
+#endif
+        if (populate) {
+            volatile char sink = 0;
+            for (size_t off = 0; off < size_; off += 4096) sink = sink + data_[off];
+        }
+    }
+
+    const char* data() const { return data_; }
+    size_t size() const { return size_; }
+    bool is_open() const { return data_ != nullptr; }
+    std::string_view view() const { return {data_, size_}; }
+
+private:
+    const char* data_ = nullptr;
+    size_t size_ = 0;
+#ifdef _WIN32
+    HANDLE file_ = INVALID_HANDLE_VALUE;
+    HANDLE mapping_ = nullptr;
+#endif
+};
+
+}
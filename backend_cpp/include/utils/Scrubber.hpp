@@ -1,8 +1,9 @@
 #pragma once
 #include <string>
+#include <string_view>
 
 namespace code_assistance {
-inline std::string scrub_json_string(const std::string& str) {
+inline std::string scrub_json_string(std::string_view str) {
     std::string out;
     out.reserve(str.size());
     for (unsigned char c : str) {
@@ -0,0 +1,180 @@
+#pragma once
+#include <chrono>
+#include <climits>
+#include <cstdint>
+#include <filesystem>
+#include <string>
+#include <vector>
+#include "FileBuffer.hpp"
+
+#ifdef __linux__
+#include <cstddef>
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#include <dirent.h>
+#endif
+
+namespace code_assistance {
+
+// 📂 Directory listing, stat and read relative to one project root, for the parallel sync walker.
+// Linux: one root descriptor, openat() / fstatat() against it and raw getdents64 with
+// d_type, so listing a directory costs no per-entry stat. Elsewhere: std::filesystem, whose
+// directory entries already carry the data on Windows. Every call is safe from many threads.
+// Timestamps are file_time_type ticks, the same values fs::last_write_time() returns.
+class TreeReader {
+public:
+    enum class Kind : uint8_t { FILE, DIR, OTHER };
+
+    struct Entry {
+        std::string name;
+        Kind kind = Kind::OTHER;
+        uint64_t ino = 0; // 0 where the platform does not say
+    };
+
+    TreeReader() = default;
+    ~TreeReader() { close(); }
+
+    TreeReader(const TreeReader&) = delete;
+    TreeReader& operator=(const TreeReader&) = delete;
+
+    bool open(const std::filesystem::path& root) {
+        close();
+        root_ = root;
+#ifdef __linux__
+        root_fd_ = ::open(root.c_str(), O_RDONLY | O_DIRECTORY | O_CLOEXEC);
+        return root_fd_ >= 0;
+#else
+        std::error_code ec;
+        return std::filesystem::is_directory(root, ec);
+#endif
+    }
+
+    void close() {
+#ifdef __linux__
+        if (root_fd_ >= 0) ::close(root_fd_);
+        root_fd_ = -1;
+#endif
+    }
+
+    // Returns rel_dir's ("" = root) mtime and lists it, unless that mtime equals skip_if_mtime
+    // (the caller's cached listing is still valid). False if it vanished or is unreadable.
+    bool list(const std::string& rel_dir, int64_t& mtime, std::vector<Entry>& out,
+              int64_t skip_if_mtime = INT64_MIN) const {
+        out.clear();
+#ifdef __linux__
+        // A fresh descriptor per call: dup() would share one read offset between threads
+        int fd = ::openat(root_fd_, rel_dir.empty() ? "." : rel_dir.c_str(), O_RDONLY | O_DIRECTORY | O_CLOEXEC);
+        if (fd < 0) return false;
+        struct stat st;
+        if (::fstat(fd, &st) != 0) { ::close(fd); return false; }
+        mtime = to_ticks(st.st_mtim);
+        if (mtime == skip_if_mtime) { ::close(fd); return true; }
+
+        alignas(8) char buf[32 * 1024];
+        while (true) {
+            long n = ::syscall(SYS_getdents64, fd, buf, sizeof(buf));
+            if (n <= 0) break;
+            for (long off = 0; off < n;) {
+                auto* d = reinterpret_cast<Dirent64*>(buf + off);
+                off += d->d_reclen;
+                const char* name = d->d_name;
+                if (name[0] == '.' && (name[1] == '\0' || (name[1] == '.' && name[2] == '\0'))) continue;
+
+                Entry e;
+                e.name = name;
+                e.ino = d->d_ino;
+                e.kind = d->d_type == DT_REG ? Kind::FILE : d->d_type == DT_DIR ? Kind::DIR : Kind::OTHER;
+                // Symlinks are followed like std::filesystem does; some filesystems never fill d_type
+                if (d->d_type == DT_LNK || d->d_type == DT_UNKNOWN) {
+                    struct stat target;
+                    if (::fstatat(fd, name, &target, 0) == 0) {
+                        e.kind = S_ISREG(target.st_mode) ? Kind::FILE : S_ISDIR(target.st_mode) ? Kind::DIR : Kind::OTHER;
+                        e.ino = target.st_ino;
+                    }
+                }
+                out.push_back(std::move(e));
+            }
+        }
+        ::close(fd);
+        return true;
+#else
+        std::error_code ec;
+        auto dir = rel_dir.empty() ? root_ : root_ / std::filesystem::path(rel_dir);
+        mtime = std::filesystem::last_write_time(dir, ec).time_since_epoch().count();
+        if (ec) return false;
+        if (mtime == skip_if_mtime) return true;
+        for (auto it = std::filesystem::directory_iterator(dir, ec); !ec && it != std::filesystem::directory_iterator(); it.increment(ec)) {
+            Entry e;
+            e.name = it->path().filename().string();
+            e.kind = it->is_regular_file(ec) ? Kind::FILE : it->is_directory(ec) ? Kind::DIR : Kind::OTHER;
+            out.push_back(std::move(e));
+        }
+        return true;
+#endif
+    }
+
+    bool stat_file(const std::string& rel_path, uint64_t& size, int64_t& mtime) const {
+#ifdef __linux__
+        struct stat st;
+        if (::fstatat(root_fd_, rel_path.c_str(), &st, 0) != 0 || !S_ISREG(st.st_mode)) return false;
+        size = (uint64_t)st.st_size;
+        mtime = to_ticks(st.st_mtim);
+        return true;
+#else
+        std::error_code ec;
+        auto path = root_ / std::filesystem::path(rel_path);
+        size = std::filesystem::file_size(path, ec);
+        if (ec) return false;
+        mtime = std::filesystem::last_write_time(path, ec).time_since_epoch().count();
+        return !ec;
+#endif
+    }
+
+    // The file's bytes as a shared buffer, nullptr if it cannot be opened
+    FileBuffer::Ptr read_file(const std::string& rel_path) const {
+#ifdef __linux__
+        int fd = ::openat(root_fd_, rel_path.c_str(), O_RDONLY | O_CLOEXEC);
+        if (fd < 0) return nullptr;
+        FileBuffer::Ptr buf = FileBuffer::load(fd);
+        ::close(fd);
+        return buf;
+#else
+        return FileBuffer::load((root_ / std::filesystem::path(rel_path)).string());
+#endif
+    }
+
+    // Identity used to skip the storage directory without a stat per entry (0 = unknown)
+    static uint64_t inode_of(const std::filesystem::path& path) {
+#ifdef __linux__
+        struct stat st;
+        return ::stat(path.c_str(), &st) == 0 ? (uint64_t)st.st_ino : 0;
+#else
+        (void)path;
+        return 0;
+#endif
+    }
+
+private:
+    std::filesystem::path root_;
+#ifdef __linux__
+    int root_fd_ = -1;
+
+    struct Dirent64 {
+        uint64_t d_ino;
+        int64_t d_off;
+        unsigned short d_reclen;
+        unsigned char d_type;
+        char d_name[];
+    };
+
+    static int64_t to_ticks(const struct timespec& ts) {
+        auto sys = std::chrono::system_clock::time_point(std::chrono::duration_cast<std::chrono::system_clock::duration>(
+            std::chrono::seconds(ts.tv_sec) + std::chrono::nanoseconds(ts.tv_nsec)));
+        return std::chrono::file_clock::from_sys(sys).time_since_epoch().count();
+    }
+#endif
+};
+
+} // namespace code_assistance
@@ -20,6 +20,9 @@ namespace code_assistance {
 
 namespace fs = std::filesystem;
 
+// 🎯 A planning turn spends seconds in the model anyway: widen the index walk until recall settles
+static const SearchParams kPlanningSearch{.ef = 128, .time_budget_us = 50000, .adaptive = true};
+
 // --- CONSTRUCTOR ---
 AgentExecutor::AgentExecutor(
     std::shared_ptr<RetrievalEngine> engine,
@@ -230,53 +233,94 @@ std::shared_ptr<SkillLibrary> AgentExecutor::get_skill_library(const std::string
 std::shared_ptr<PointerGraph> AgentExecutor::get_or_create_graph(const std::string& project_id) {
     std::lock_guard<std::mutex> lock(graph_mutex_);
     if (graphs_.find(project_id) == graphs_.end()) {
-        std::string safe_id = project_id;
-        std::replace(safe_id.begin(), safe_id.end(), ':', '_');
-        std::replace(safe_id.begin(), safe_id.end(), '/', '_');
-        std::replace(safe_id.begin(), safe_id.end(), '\\', '_');
-        std::string path = "data/graphs/" + safe_id;
+        std::string path = project_graph_dir(project_id);
         if (!fs::exists(path)) fs::create_directories(path);
-        spdlog::info("📂 Loading Graph for Project: {} at {}", project_id, path);
-        graphs_[project_id] = std::make_shared<PointerGraph>(path);
+
+        // 🗜️ Per-project index layout: config.json -> "vector_index": {"mode": "hnsw_sq8", ...}
+        VectorIndexConfig index_config;
+        fs::path config_path = fs::path("data") / project_id / "config.json";
+        if (fs::exists(config_path)) {
+            try {
+                std::ifstream f(config_path);
+                index_config = VectorIndexConfig::from_json(nlohmann::json::parse(f).value("vector_index", nlohmann::json::object()));
+            } catch (const std::exception& e) {
+                spdlog::warn("⚠️ Ignoring vector_index config for {}: {}", project_id, e.what());
+            }
+        }
+
+        spdlog::info("📂 Loading Graph for Project: {} at {} (index: {})", project_id, path, index_mode_name(index_config.mode));
+        auto t_start = std::chrono::steady_clock::now();
+        graphs_[project_id] = std::make_shared<PointerGraph>(path, 768, index_config);
+        SystemMonitor::record_index_warmup(
+            std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - t_start).count());
     }
     return graphs_[project_id];
 }
 
-void AgentExecutor::ingest_sync_results(const std::string& project_id, const std::vector<std::shared_ptr<CodeNode>>& nodes) {
+void AgentExecutor::ingest_sync_results(const std::string& project_id, const SyncResult& sync) {
     auto graph = get_or_create_graph(project_id);
 
-    size_t before_count = graph->get_node_count(); // You might need to add this getter to PointerGraph
-    spdlog::info("🧠 [GRAPH INGESTION] Starting injection of {} nodes...", nodes.size());
+    spdlog::info("🧠 [GRAPH INGESTION] Starting injection of {} nodes ({} changed files)...", 
+                 sync.nodes.size(), sync.changed_files.size());
 
-    if (nodes.size() > 50) {
-        spdlog::warn("🧹 Large sync detected. Purging old graph nodes for stability.");
-        graph->clear(); // Ensure this method exists in your PointerGraph class
+    // 1. Retire the old symbols of every file that changed or vanished
+    // (streamed changed files were already swapped in batch by batch: retiring them again would drop the new nodes)
+    std::unordered_set<std::string> stale_files;
+    if (!sync.streamed) {
+        for (const auto& path : sync.changed_files) stale_files.insert(scrub_json_string(path));
+    }
+    for (const auto& path : sync.removed_files) stale_files.insert(scrub_json_string(path));
+
+    if (sync.full_rebuild) {
+        // No manifest to diff against: whatever the graph knows that this scan didn't see is gone
+        std::unordered_set<std::string> seen;
+        for (const auto& node : sync.nodes) seen.insert(scrub_json_string(node->file_path));
+        for (const auto& path : graph->indexed_files()) {
+            if (!seen.count(path)) stale_files.insert(path);
+        }
     }
 
-    for (const auto& node : nodes) {
-        std::unordered_map<std::string, std::string> meta;
-        meta["file_path"] = scrub_json_string(node->file_path);
-        meta["node_name"] = scrub_json_string(node->name);
-        meta["node_type"] = scrub_json_string(node->type);
+    size_t retired = 0;
+    for (const auto& path : stale_files) retired += graph->remove_file_nodes(path);
+
+    // 2. Upsert changed symbols (and any the graph has never seen). Unchanged ones keep their vectors.
+    std::vector<NodeSpec> specs;
+    for (const auto& node : sync.nodes) {
+        std::string node_id = scrub_json_string(node->id);
+        bool changed = sync.changed_files.count(node->file_path) > 0;
+        if (changed ? sync.streamed : graph->contains(node_id)) continue;
+
+        NodeSpec spec;
+        spec.id = std::move(node_id);
+        spec.type = NodeType::CONTEXT_CODE;
+        spec.content = scrub_json_string(node->text()); // The copy that outlives the file buffer
+        spec.embedding = node->embedding;
+        spec.metadata["file_path"] = scrub_json_string(node->file_path);
+        spec.metadata["node_name"] = scrub_json_string(node->name);
+        spec.metadata["node_type"] = scrub_json_string(node->type);
         std::string deps = "";
         for(const auto& d : node->dependencies) deps += d + ",";
-        meta["dependencies"] = deps;
-        std::string safe_content = scrub_json_string(node->content);
-        graph->add_node(safe_content, NodeType::CONTEXT_CODE, "", node->embedding, meta);
+        spec.metadata["dependencies"] = deps;
+        if (!node->references.empty()) spec.metadata["references"] = scrub_json_string(format_references(node->references));
+        specs.push_back(std::move(spec));
     }
-    graph->save();
-    spdlog::info("✅ [GRAPH INGESTION] Success. Total Memory Nodes: {}", graph->get_node_count());
+
+    // One lock, one FAISS add, one save
+    size_t upserted = specs.size();
+    if (!specs.empty()) graph->add_nodes_bulk(specs);
+    else graph->save();
+    // Cross-file references are linked once per sync, off the query path
+    if (!sync.partial) graph->link_references();
+
+    spdlog::info("✅ [GRAPH INGESTION] Success. Upserted: {} | Retired: {} | Total Memory Nodes: {}", 
+                 upserted, retired, graph->get_node_count());
 }
 
 std::string AgentExecutor::restore_session_cursor(std::shared_ptr<PointerGraph> graph, const std::string& session_id) {
-    auto nodes = graph->query_by_metadata("session_id", session_id);
-    if (nodes.empty()) return "";
-    PointerNode latest = nodes[0];
-    for(const auto& n : nodes) {
-        if (n.timestamp > latest.timestamp) latest = n;
-    }
-    spdlog::info("🔄 Restored Session '{}' cursor to node: {}", session_id, latest.id);
-    return latest.id;
+    auto latest = graph->latest_by_metadata("session_id", session_id);
+    if (!latest) return "";
+    spdlog::info("🔄 Restored Session '{}' cursor to node: {}", session_id, latest->id);
+    return latest->id;
 }
 
 std::string AgentExecutor::run_autonomous_loop(const ::code_assistance::UserQuery& req, ::grpc::ServerWriter<::code_assistance::AgentResponse>* writer) {
@@ -294,7 +338,7 @@ std::string AgentExecutor::run_autonomous_loop(const ::code_assistance::UserQuer
     std::vector<float> prompt_vec = ai_service_->generate_embedding(req.prompt());
 
     // 3. PERFORM SIGMA-2 RETRIEVAL (Now that we have prompt_vec)
-    auto top_nodes = graph->semantic_search(prompt_vec, 5);
+    auto top_nodes = graph->semantic_search(prompt_vec, 5, {}, kPlanningSearch);
     std::string relational_context = "### RELATED CODE RELATIONSHIPS (Sigma-2)\n";
     std::string massive_context = ""; // Declare this here so we can add to it
 
@@ -344,7 +388,7 @@ std::string AgentExecutor::run_autonomous_loop(const ::code_assistance::UserQuer
 
     // Retrieve Skills
     auto skill_lib = get_skill_library(req.project_id());
-    std::string business_context = skill_lib->retrieve_skills(req.prompt(), prompt_vec);
+    std::string business_context = skill_lib->retrieve_skills(req.prompt(), prompt_vec, kPlanningSearch);
 
     // 🚀 RETRIEVE & FORMAT HISTORY (DEDUPLICATED)
     if (!parent_node_id.empty()) {
@@ -406,7 +450,7 @@ std::string AgentExecutor::run_autonomous_loop(const ::code_assistance::UserQuer
     std::string memories = "";
     std::string warnings = ""; 
     if (!prompt_vec.empty()) {
-        MemoryRecallResult long_term = memory_vault_->recall(prompt_vec);
+        MemoryRecallResult long_term = memory_vault_->recall(prompt_vec, kPlanningSearch);
         if(long_term.has_memories) {
             if(!long_term.positive_hints.empty()) memories += "\n### 🧠 SUCCESSFUL STRATEGIES\n" + long_term.positive_hints;
             if(!long_term.negative_warnings.empty()) warnings += "\n### ⛔ KNOWN PITFALLS\n" + long_term.negative_warnings;
@@ -641,7 +685,7 @@ std::string AgentExecutor::run_autonomous_loop(const ::code_assistance::UserQuer
             params["_batch_mode"] = true; 
 
             if (tool_name == "propose_plan") {
-                MemoryRecallResult past_experiences = memory_vault_->recall(prompt_vec);
+                MemoryRecallResult past_experiences = memory_vault_->recall(prompt_vec, kPlanningSearch);
 
                 if (past_experiences.has_memories) {
                     // Force the AI to reconsider the plan based on past failures
@@ -13,7 +13,7 @@ namespace code_assistance {
 namespace fs = std::filesystem; 
 using json = nlohmann::json;
 
-std::string scrub_utf8(const std::string& str) {
+std::string scrub_utf8(std::string_view str) {
     std::string out;
     out.reserve(str.size());
     for (size_t i = 0; i < str.length(); ++i) {
@@ -35,12 +35,61 @@ std::string scrub_utf8(const std::string& str) {
     return out;
 }
 
+const char* ref_kind_name(RefKind kind) {
+    switch (kind) {
+        case RefKind::CALL: return "call";
+        case RefKind::INHERIT: return "inherit";
+        case RefKind::TYPE: return "type";
+        case RefKind::IMPORT: return "import";
+    }
+    return "call";
+}
+
+std::string format_references(const std::vector<SymbolRef>& refs) {
+    std::string out;
+    for (const auto& ref : refs) {
+        if (!out.empty()) out += ',';
+        out += ref_kind_name(ref.kind);
+        out += ':';
+        out += ref.name;
+    }
+    return out;
+}
+
+std::vector<SymbolRef> parse_references(std::string_view text) {
+    std::vector<SymbolRef> refs;
+    while (!text.empty()) {
+        size_t comma = text.find(',');
+        std::string_view item = text.substr(0, comma);
+        text = comma == std::string_view::npos ? std::string_view() : text.substr(comma + 1);
+
+        size_t colon = item.find(':');
+        if (colon == std::string_view::npos || colon + 1 == item.size()) continue;
+        std::string_view kind = item.substr(0, colon);
+        SymbolRef ref;
+        ref.name.assign(item.substr(colon + 1));
+        if (kind == "inherit") ref.kind = RefKind::INHERIT;
+        else if (kind == "type") ref.kind = RefKind::TYPE;
+        else if (kind == "import") ref.kind = RefKind::IMPORT;
+        refs.push_back(std::move(ref));
+    }
+    return refs;
+}
+
+void make_node_ids_unique(std::vector<CodeNode>& nodes) {
+    std::unordered_map<std::string, size_t> seen;
+    for (auto& node : nodes) {
+        size_t count = ++seen[node.id];
+        if (count > 1) node.id += "#" + std::to_string(count); // The first keeps its plain id
+    }
+}
+
 json CodeNode::to_json() const {
     try {
         json j;
         j["id"] = scrub_utf8(id);
         j["name"] = scrub_utf8(name);
-        j["content"] = scrub_utf8(content);
+        j["content"] = scrub_utf8(text());
         j["docstring"] = scrub_utf8(docstring);
         j["file_path"] = scrub_utf8(file_path);
         j["type"] = scrub_utf8(type);  // ✅ Scrub this too, just in case
@@ -51,6 +100,7 @@ json CodeNode::to_json() const {
             deps_array.push_back(scrub_utf8(dep));
         }
         j["dependencies"] = deps_array;
+        j["references"] = scrub_utf8(format_references(references));
         
         j["embedding"] = embedding;  // Numeric data - safe
         j["weights"] = weights;      // Numeric data - safe
@@ -74,6 +124,7 @@ CodeNode CodeNode::from_json(const json& j) {
     node.file_path = safe_get("file_path");
     node.type = safe_get("type");
     if (j.contains("dependencies")) node.dependencies = j["dependencies"].get<std::unordered_set<std::string>>();
+    node.references = parse_references(j.value("references", ""));
     if (j.contains("embedding")) node.embedding = j["embedding"].get<std::vector<float>>();
     if (j.contains("weights")) node.weights = j["weights"].get<std::unordered_map<std::string, double>>();
     node.ai_summary = safe_get("ai_summary");
@@ -82,14 +133,14 @@ CodeNode CodeNode::from_json(const json& j) {
 }
 
 // --- ROBUST HYBRID PARSER ---
+// Walks the buffer line by line without copying it: blocks and the file node are byte ranges of `source`
 class BracketParser {
 public:
-    static std::vector<CodeNode> parse(const std::string& file_path, const std::string& content) {
+    static std::vector<CodeNode> parse(const std::string& file_path, const FileBuffer::Ptr& source) {
         std::vector<CodeNode> nodes;
-        std::istringstream stream(content);
-        std::string line;
-        
-        std::string buffer;
+        std::string_view content = source->view();
+
+        size_t block_start = 0;
         int brace_level = 0;
         bool in_function = false;
         std::string current_signature;
@@ -97,35 +148,39 @@ public:
         
         std::regex func_start_re(R"((?:class|struct|interface|function|const|let|var|void|int|auto)\s+([a-zA-Z0-9_:]+))");
 
-        while (std::getline(stream, line)) {
-            if (!line.empty() && line.back() == '\r') line.pop_back();
+        for (size_t line_start = 0; line_start < content.size();) {
+            size_t newline = content.find('\n', line_start);
+            size_t line_end = newline == std::string_view::npos ? content.size() : newline + 1;
+            std::string_view line = content.substr(line_start, (newline == std::string_view::npos ? content.size() : newline) - line_start);
+            if (!line.empty() && line.back() == '\r') line.remove_suffix(1);
 
-            std::string clean_line = line; 
+            std::string_view clean_line = line;
             // Simple trim
-            clean_line.erase(0, clean_line.find_first_not_of(" \t"));
+            size_t first = clean_line.find_first_not_of(" \t");
+            clean_line.remove_prefix(first == std::string_view::npos ? clean_line.size() : first);
             
             // 1. MANUAL IMPORT SCANNING (Reliable)
             if (clean_line.rfind("import ", 0) == 0) { // Starts with "import "
                 size_t from_pos = clean_line.find("from");
-                if (from_pos != std::string::npos) {
+                if (from_pos != std::string_view::npos) {
                     // Extract substring after 'from'
-                    std::string after_from = clean_line.substr(from_pos + 4);
+                    std::string_view after_from = clean_line.substr(from_pos + 4);
                     
                     // Find quotes
                     size_t first_quote = after_from.find_first_of("'\"");
                     size_t last_quote = after_from.find_last_of("'\"");
                     
-                    if (first_quote != std::string::npos && last_quote != std::string::npos && last_quote > first_quote) {
-                        std::string path = after_from.substr(first_quote + 1, last_quote - first_quote - 1);
+                    if (first_quote != std::string_view::npos && last_quote != std::string_view::npos && last_quote > first_quote) {
+                        std::string_view path = after_from.substr(first_quote + 1, last_quote - first_quote - 1);
                         
                         // Clean Path Logic
                         size_t last_slash = path.find_last_of('/');
-                        if (last_slash != std::string::npos) path = path.substr(last_slash + 1);
+                        if (last_slash != std::string_view::npos) path = path.substr(last_slash + 1);
 
                         // size_t dot = path.find_last_of('.');
                         // if (dot != std::string::npos && dot > 0) path = path.substr(0, dot);
                         
-                        file_imports.insert(path);
+                        file_imports.emplace(path);
                         // DEBUG LOG
                         if(file_path.find("app.ts") != std::string::npos) {
                              spdlog::info("🔗 Import Detected in {}: {}", file_path, path);
@@ -144,49 +199,52 @@ public:
 
             // 3. Function Extraction
             if (!in_function) {
-                std::smatch match;
-                if (open_braces > 0 && std::regex_search(clean_line, match, func_start_re)) {
+                std::cmatch match;
+                if (open_braces > 0 && std::regex_search(clean_line.data(), clean_line.data() + clean_line.size(), match, func_start_re)) {
                     in_function = true;
                     brace_level = 0;
                     current_signature = match[1].str();
-                    buffer = line + "\n";
+                    block_start = line_start;
                     brace_level += (open_braces - close_braces);
                 }
             } else {
-                buffer += line + "\n";
                 brace_level += (open_braces - close_braces);
                 if (brace_level <= 0) {
                     CodeNode node;
                     node.name = current_signature;
                     node.file_path = file_path;
                     node.id = file_path + "::" + current_signature;
-                    node.content = buffer;
+                    node.source = source;
+                    node.source_offset = block_start;
+                    node.source_length = line_end - block_start;
                     node.type = "code_block";
                     node.weights = {{"structural", 0.7}};
                     node.dependencies = file_imports; 
-                    nodes.push_back(node);
+                    nodes.push_back(std::move(node));
                     in_function = false;
-                    buffer = "";
                 }
             }
+            line_start = line_end;
         }
 
         CodeNode file_node;
         file_node.name = fs::path(file_path).filename().string();
         file_node.file_path = file_path;
         file_node.id = file_path;
-        file_node.content = content;
+        file_node.source = source;
+        file_node.source_length = content.size();
         file_node.type = "file";
         file_node.weights = {{"structural", 0.5}, {"specificity", 0.3}};
         file_node.dependencies = file_imports;
-        nodes.push_back(file_node);
+        nodes.push_back(std::move(file_node));
 
+        make_node_ids_unique(nodes);
         return nodes;
     }
 };
 
-std::vector<CodeNode> CodeParser::extract_nodes_from_file(const std::string& file_path, const std::string& content) {
-    return BracketParser::parse(file_path, content);
+std::vector<CodeNode> CodeParser::extract_nodes_from_file(const std::string& file_path, const FileBuffer::Ptr& source) {
+    return BracketParser::parse(file_path, source);
 }
 
 void CodeGraph::add_node(std::shared_ptr<CodeNode> node) {
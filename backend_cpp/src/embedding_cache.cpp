@@ -0,0 +1,231 @@
+#include "embedding_cache.hpp"
+#include "utils/Half.hpp"
+#include <xxhash.h>
+#include <cstring>
+#include <mutex>
+#include <spdlog/spdlog.h>
+
+namespace code_assistance {
+
+static constexpr char kCacheMagic[8] = {'S', 'F', 'E', 'M', 'B', 'C', '\0', '\0'};
+static constexpr uint32_t kCacheVersion = 1;
+static constexpr size_t kKeyBytes = 16;
+
+struct CacheHeader {
+    char magic[8];
+    uint32_t version;
+    uint32_t dimension;
+    uint64_t model_hash;
+    uint64_t reserved[5];
+};
+static_assert(sizeof(CacheHeader) == 64, "cache header must stay 64 bytes");
+
+EmbeddingCache::EmbeddingCache(fs::path file, size_t max_bytes)
+    : file_(std::move(file)), max_bytes_(max_bytes) {}
+
+EmbeddingCache::Key EmbeddingCache::key_of(const std::string& text) const {
+    // The model hash seeds the text hash: same text under another model is another key
+    XXH128_hash_t h = XXH3_128bits_withSeed(text.data(), text.size(), model_hash_);
+    return {h.low64, h.high64};
+}
+
+size_t EmbeddingCache::record_size() const {
+    return kKeyBytes + (((size_t)dimension_ * sizeof(uint16_t) + 7) & ~size_t(7));
+}
+
+const char* EmbeddingCache::record_at(uint32_t row) const {
+    if (row < mapped_rows_) return map_.data() + sizeof(CacheHeader) + (size_t)row * record_size();
+    return tail_.data() + (size_t)(row - mapped_rows_) * record_size();
+}
+
+void EmbeddingCache::bind_model(const std::string& model) {
+    {
+        std::shared_lock lock(mutex_);
+        if (model == model_ && (map_.is_open() || out_.is_open())) return;
+    }
+    std::unique_lock lock(mutex_);
+    if (model == model_ && (map_.is_open() || out_.is_open())) return;
+    bool switching = !model_.empty();
+    model_ = model;
+    model_hash_ = XXH3_64bits(model.data(), model.size());
+    open_locked();
+    if (switching) spdlog::warn("💾 Embedding model is now '{}': cached vectors invalidated", model);
+}
+
+void EmbeddingCache::open_locked() {
+    map_.close();
+    out_.close();
+    index_.clear();
+    tail_.clear();
+    written_ = 0;
+    mapped_rows_ = 0;
+    dimension_ = 0;
+
+    std::error_code ec;
+    fs::create_directories(file_.parent_path(), ec);
+
+    CacheHeader header{};
+    bool valid = map_.open(file_.string()) && map_.size() >= sizeof(CacheHeader);
+    if (valid) {
+        std::memcpy(&header, map_.data(), sizeof(header));
+        valid = std::memcmp(header.magic, kCacheMagic, sizeof(kCacheMagic)) == 0 &&
+                header.version == kCacheVersion && header.model_hash == model_hash_;
+    }
+    if (!valid) {
+        if (map_.size() > 0) spdlog::info("💾 Embedding cache {} belongs to another model or format - starting over", file_.string());
+        reset_locked(0);
+        return;
+    }
+
+    dimension_ = header.dimension;
+    size_t rows = dimension_ ? (map_.size() - sizeof(CacheHeader)) / record_size() : 0;
+    size_t whole = sizeof(CacheHeader) + rows * record_size();
+    if (whole != map_.size()) {
+        // Torn append from a crash: drop the partial record before appending after it
+        map_.close();
+        fs::resize_file(file_, whole, ec);
+        map_.open(file_.string());
+    }
+
+    mapped_rows_ = rows;
+    index_.reserve(rows);
+    for (size_t row = 0; row < rows; ++row) {
+        Key key;
+        const char* rec = record_at((uint32_t)row);
+        std::memcpy(&key.lo, rec, 8);
+        std::memcpy(&key.hi, rec + 8, 8);
+        index_[key] = (uint32_t)row; // A later duplicate wins
+    }
+
+    out_.open(file_, std::ios::binary | std::ios::app);
+    if (rows > 0) {
+        spdlog::info("💾 Embedding cache: {} vectors ({}-d fp16, {:.1f} MB) from {}", index_.size(), dimension_,
+                     (double)whole / (1024.0 * 1024.0), file_.string());
+    }
+}
+
+void EmbeddingCache::reset_locked(uint32_t dimension) {
+    map_.close();
+    out_.close();
+    index_.clear();
+    tail_.clear();
+    written_ = 0;
+    mapped_rows_ = 0;
+    dimension_ = dimension;
+
+    CacheHeader header{};
+    std::memcpy(header.magic, kCacheMagic, sizeof(kCacheMagic));
+    header.version = kCacheVersion;
+    header.dimension = dimension;
+    header.model_hash = model_hash_;
+    {
+        std::ofstream f(file_, std::ios::binary | std::ios::trunc);
+        f.write(reinterpret_cast<const char*>(&header), sizeof(header));
+    }
+    out_.open(file_, std::ios::binary | std::ios::app);
+}
+
+std::optional<std::vector<float>> EmbeddingCache::get(const std::string& text) {
+    std::shared_lock lock(mutex_);
+    auto it = dimension_ ? index_.find(key_of(text)) : index_.end();
+    if (it == index_.end()) {
+        misses_++;
+        return std::nullopt;
+    }
+    hits_++;
+
+    const char* halves = record_at(it->second) + kKeyBytes;
+    std::vector<float> vec(dimension_);
+    for (uint32_t i = 0; i < dimension_; ++i) {
+        uint16_t h;
+        std::memcpy(&h, halves + i * sizeof(uint16_t), sizeof(h));
+        vec[i] = half_to_float(h);
+    }
+    return vec;
+}
+
+bool EmbeddingCache::append_locked(const Key& key, const std::vector<float>& vec) {
+    if (vec.empty() || !out_.is_open()) return false;
+    if (dimension_ == 0) reset_locked((uint32_t)vec.size()); // First vector fixes the dimension
+    if (vec.size() != dimension_) return false;
+    if (index_.count(key)) return true;
+
+    size_t rs = record_size();
+    size_t at = tail_.size();
+    tail_.resize(at + rs, 0);
+    char* rec = tail_.data() + at;
+    std::memcpy(rec, &key.lo, 8);
+    std::memcpy(rec + 8, &key.hi, 8);
+    for (uint32_t i = 0; i < dimension_; ++i) {
+        uint16_t h = float_to_half(vec[i]);
+        std::memcpy(rec + kKeyBytes + i * sizeof(uint16_t), &h, sizeof(h));
+    }
+    index_[key] = (uint32_t)(mapped_rows_ + at / rs);
+
+    if (sizeof(CacheHeader) + (mapped_rows_ + tail_.size() / rs) * rs > max_bytes_) compact_locked();
+    return true;
+}
+
+void EmbeddingCache::flush_locked() {
+    if (written_ == tail_.size() || !out_.is_open()) return;
+    // Whole records in one write: a crash can only tear the last one, which open cuts off
+    out_.write(tail_.data() + written_, (std::streamsize)(tail_.size() - written_));
+    out_.flush();
+    written_ = tail_.size();
+}
+
+void EmbeddingCache::compact_locked() {
+    size_t rs = record_size();
+    size_t rows = mapped_rows_ + tail_.size() / rs;
+    size_t keep_from = rows / 2; // Oldest half out
+
+    fs::path tmp = file_;
+    tmp += ".tmp";
+    {
+        CacheHeader header{};
+        std::memcpy(header.magic, kCacheMagic, sizeof(kCacheMagic));
+        header.version = kCacheVersion;
+        header.dimension = dimension_;
+        header.model_hash = model_hash_;
+        std::ofstream f(tmp, std::ios::binary | std::ios::trunc);
+        f.write(reinterpret_cast<const char*>(&header), sizeof(header));
+        for (size_t row = keep_from; row < rows; ++row) f.write(record_at((uint32_t)row), (std::streamsize)rs);
+    }
+    map_.close();
+    out_.close();
+    std::error_code ec;
+    fs::rename(tmp, file_, ec);
+    if (ec) spdlog::error("💾 Embedding cache compaction failed: {}", ec.message());
+    spdlog::info("💾 Embedding cache over {:.0f} MB: dropped the {} oldest vectors",
+                 (double)max_bytes_ / (1024.0 * 1024.0), keep_from);
+    open_locked();
+}
+
+void EmbeddingCache::put(const std::string& text, const std::vector<float>& vec) {
+    std::unique_lock lock(mutex_);
+    append_locked(key_of(text), vec);
+    flush_locked();
+}
+
+void EmbeddingCache::put_many(const std::vector<std::string>& texts, const std::vector<std::vector<float>>& vecs) {
+    std::unique_lock lock(mutex_);
+    for (size_t i = 0; i < texts.size() && i < vecs.size(); ++i) append_locked(key_of(texts[i]), vecs[i]);
+    flush_locked(); // One write for the whole batch
+}
+
+void EmbeddingCache::clear() {
+    std::unique_lock lock(mutex_);
+    reset_locked(0);
+}
+
+EmbeddingCache::Stats EmbeddingCache::stats() const {
+    std::shared_lock lock(mutex_);
+    Stats s;
+    s.hits = hits_.load();
+    s.misses = misses_.load();
+    s.entries = index_.size();
+    s.bytes = sizeof(CacheHeader) + (dimension_ ? (mapped_rows_ + tail_.size() / record_size()) * record_size() : 0);
+    return s;
+}
+
+} // namespace code_assistance
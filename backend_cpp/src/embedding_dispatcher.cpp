@@ -0,0 +1,259 @@
+#include "embedding_dispatcher.hpp"
+#include <algorithm>
+#include <spdlog/spdlog.h>
+
+namespace code_assistance {
+
+EmbeddingDispatcher::EmbeddingDispatcher(std::vector<std::string> keys, Transport transport, DispatchOptions options)
+    : transport_(std::move(transport)), options_(options) {
+    if (options_.max_batch == 0) options_.max_batch = 1;
+    if (options_.per_key_inflight == 0) options_.per_key_inflight = 1;
+    if (options_.burst < 1.0) options_.burst = 1.0;
+
+    auto now = Clock::now();
+    for (auto& key : keys) {
+        if (key.empty()) continue;
+        KeyState state;
+        state.key = std::move(key);
+        state.tokens = 1.0; // Every key may start right away
+        state.refilled = now;
+        keys_.push_back(std::move(state));
+    }
+
+    // Start at one request per key; AIMD finds out how much more the quota takes
+    max_window_ = keys_.size() * options_.per_key_inflight;
+    window_ = (double)std::max<size_t>(1, keys_.size());
+    for (size_t i = 0; i < max_window_; ++i) workers_.emplace_back(&EmbeddingDispatcher::worker_loop, this);
+
+    spdlog::info("🚦 Embedding dispatcher: {} keys, {:.0f} req/min each, up to {} requests in flight",
+                 keys_.size(), options_.requests_per_minute, max_window_);
+}
+
+EmbeddingDispatcher::~EmbeddingDispatcher() {
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        stop_ = true;
+        fail_all_queued("dispatcher shutting down");
+    }
+    work_cv_.notify_all();
+    for (auto& t : workers_) {
+        if (t.joinable()) t.join();
+    }
+}
+
+std::vector<std::vector<float>> EmbeddingDispatcher::embed(const std::vector<std::string>& texts) {
+    std::vector<std::vector<float>> out(texts.size());
+    if (texts.empty()) return out;
+
+    std::unique_lock<std::mutex> lock(mutex_);
+    if (keys_.empty() || stop_) {
+        spdlog::error("❌ No embedding keys available - {} texts left without vectors", texts.size());
+        return out;
+    }
+
+    Job job{&texts, &out, texts.size()};
+    for (size_t i = 0; i < texts.size(); i += options_.max_batch) {
+        queue_.push_back({&job, i, std::min(texts.size(), i + options_.max_batch)});
+    }
+    work_cv_.notify_all();
+    done_cv_.wait(lock, [&] { return job.pending == 0; });
+    return out;
+}
+
+bool EmbeddingDispatcher::saturated() const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    return !queue_.empty();
+}
+
+double EmbeddingDispatcher::window() const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    return window_;
+}
+
+void EmbeddingDispatcher::worker_loop() {
+    std::unique_lock<std::mutex> lock(mutex_);
+    while (!stop_) {
+        if (queue_.empty() || in_flight_ >= (size_t)window_) {
+            work_cv_.wait(lock);
+            continue;
+        }
+
+        auto now = Clock::now();
+        auto ready = std::find_if(queue_.begin(), queue_.end(), [&](const Task& t) { return t.not_before <= now; });
+        if (ready == queue_.end()) {
+            // Everything queued is backing off after a server error
+            auto wake_at = std::min_element(queue_.begin(), queue_.end(), [](const Task& a, const Task& b) {
+                return a.not_before < b.not_before;
+            })->not_before;
+            work_cv_.wait_until(lock, wake_at);
+            continue;
+        }
+
+        Clock::time_point wake_at = Clock::time_point::max();
+        int k = pick_key(now, wake_at);
+        if (k < 0) {
+            if (std::all_of(keys_.begin(), keys_.end(), [](const KeyState& s) { return s.disabled; })) {
+                fail_all_queued("every embedding key was rejected");
+            } else if (wake_at != Clock::time_point::max()) {
+                work_cv_.wait_until(lock, wake_at); // Cooldown or token refill
+            } else {
+                work_cv_.wait(lock); // Every key is at its in-flight cap: a reply frees one
+            }
+            continue;
+        }
+
+        Task task = *ready;
+        queue_.erase(ready);
+        KeyState& key = keys_[k];
+        key.tokens -= 1.0;
+        key.in_flight++;
+        in_flight_++;
+        uint64_t sent_epoch = decrease_epoch_;
+        std::string key_str = key.key;
+        std::vector<std::string> texts(task.job->texts->begin() + task.begin, task.job->texts->begin() + task.end);
+        lock.unlock();
+
+        EmbedReply reply;
+        try {
+            reply = transport_(texts, key_str);
+        } catch (const std::exception& e) {
+            reply.status = 0;
+            reply.error = e.what();
+        } catch (...) {
+            reply.status = 0;
+            reply.error = "unknown transport error";
+        }
+
+        lock.lock();
+        keys_[k].in_flight--;
+        in_flight_--;
+        settle(task, (size_t)k, reply, sent_epoch);
+        if (stop_) fail_all_queued("dispatcher shutting down"); // A retry queued after shutdown started
+        work_cv_.notify_all();
+    }
+}
+
+int EmbeddingDispatcher::pick_key(Clock::time_point now, Clock::time_point& wake_at) {
+    const double per_second = options_.requests_per_minute / 60.0;
+    int best = -1;
+    for (size_t i = 0; i < keys_.size(); ++i) {
+        KeyState& s = keys_[i];
+        if (s.disabled) continue;
+
+        double elapsed = std::chrono::duration<double>(now - s.refilled).count();
+        s.tokens = std::min(options_.burst, s.tokens + elapsed * per_second);
+        s.refilled = now;
+
+        if (now < s.cooldown_until) {
+            wake_at = std::min(wake_at, s.cooldown_until);
+            continue;
+        }
+        if (s.in_flight >= options_.per_key_inflight) continue;
+        if (s.tokens < 1.0) {
+            if (per_second > 0) {
+                auto refill = std::chrono::duration<double>((1.0 - s.tokens) / per_second);
+                wake_at = std::min(wake_at, now + std::chrono::duration_cast<Clock::duration>(refill));
+            }
+            continue;
+        }
+        // Fullest bucket first: spreads the load instead of draining one key at a time
+        if (best < 0 || s.tokens > keys_[best].tokens) best = (int)i;
+    }
+    return best;
+}
+
+void EmbeddingDispatcher::settle(Task& task, size_t key_index, EmbedReply& reply, uint64_t sent_epoch) {
+    KeyState& key = keys_[key_index];
+    size_t size = task.end - task.begin;
+    auto now = Clock::now();
+
+    auto retry = [&](Clock::time_point not_before, bool front) {
+        if (++task.attempts >= options_.max_attempts) {
+            spdlog::error("❌ Embedding sub-batch of {} texts gave up after {} attempts: {} {}",
+                          task.end - task.begin, task.attempts, reply.status, reply.error);
+            resolve(task.job, task.end - task.begin);
+            return;
+        }
+        task.not_before = not_before;
+        if (front) queue_.push_front(task);
+        else queue_.push_back(task);
+    };
+
+    if (reply.status == 200) {
+        size_t n = std::min(reply.vectors.size(), size);
+        auto& out = *task.job->out;
+        for (size_t i = 0; i < n; ++i) out[task.begin + i] = std::move(reply.vectors[i]);
+        key.strikes = 0;
+        window_ = std::min((double)max_window_, window_ + 1.0 / window_); // Additive: +1 per window of successes
+        if (n > 0) resolve(task.job, n);
+        if (n < size) {
+            // Only the texts that came back without a vector go again
+            task.begin += n;
+            retry(now, true);
+        }
+        return;
+    }
+
+    if (reply.status == 429) {
+        key.strikes++;
+        key.tokens = 0.0;
+        int cool_ms = reply.retry_after_ms > 0 ? reply.retry_after_ms : std::min(60000, 1000 << std::min(key.strikes - 1, 6));
+        key.cooldown_until = now + std::chrono::milliseconds(cool_ms);
+
+        // Multiplicative: one halving per round trip, however many of its requests hit the limit
+        if (sent_epoch == decrease_epoch_) {
+            double before = window_;
+            window_ = std::max(1.0, window_ / 2.0);
+            decrease_epoch_++;
+            spdlog::warn("⏳ Embedding key #{} rate limited (429): window {:.1f} -> {:.1f}, key cooling {}ms",
+                         key_index, before, window_, cool_ms);
+        }
+        retry(now, true);
+        return;
+    }
+
+    if (reply.status == 401 || reply.status == 403) {
+        if (!key.disabled) spdlog::error("🔑 Embedding key #{} rejected ({}) - dropped from the pool", key_index, reply.status);
+        key.disabled = true;
+        queue_.push_front(task); // Not the batch's fault
+        return;
+    }
+
+    if (reply.status == 400 && size > 1) {
+        // Something in here is unacceptable: halve until that text is alone, embed the rest
+        size_t mid = task.begin + size / 2;
+        Task second = task;
+        second.begin = mid;
+        task.end = mid;
+        queue_.push_front(second);
+        queue_.push_front(task);
+        return;
+    }
+
+    if (reply.status >= 400 && reply.status < 500) {
+        spdlog::error("❌ Batch Embedding Failed: {} | {}", reply.status, reply.error);
+        resolve(task.job, size);
+        return;
+    }
+
+    // 5xx or transport error: exponential backoff for this sub-batch only
+    retry(now + std::chrono::milliseconds(500LL << std::min(task.attempts, 6)), false);
+}
+
+void EmbeddingDispatcher::resolve(Job* job, size_t count) {
+    job->pending -= std::min(job->pending, count);
+    if (job->pending == 0) done_cv_.notify_all();
+}
+
+void EmbeddingDispatcher::fail_all_queued(const char* reason) {
+    if (queue_.empty()) return;
+    size_t texts = 0;
+    for (auto& task : queue_) {
+        texts += task.end - task.begin;
+        resolve(task.job, task.end - task.begin);
+    }
+    queue_.clear();
+    spdlog::error("❌ Dropped {} queued embedding texts: {}", texts, reason);
+}
+
+} // namespace code_assistance
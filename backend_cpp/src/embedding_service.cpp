@@ -5,6 +5,7 @@
 #include <cpr/cpr.h>
 #include <nlohmann/json.hpp>
 #include <spdlog/spdlog.h>
+#include <algorithm>
 #include <thread>
 #include <chrono>
 #include <cmath>
@@ -88,10 +89,10 @@ private:
     std::chrono::seconds ttl_{300}; 
     
 public:
-    void preload(const std::string& file_path, const std::string& full_content) {
+    void preload(const std::string& file_path, std::string_view full_content) {
+        std::string compact_context(full_content.substr(0, (std::min)((size_t)1200, full_content.length())));
         std::unique_lock lock(mutex_);
-        std::string compact_context = full_content.substr(0, (std::min)((size_t)1200, full_content.length()));
-        contexts_[file_path] = {compact_context, std::chrono::steady_clock::now()};
+        contexts_[file_path] = {std::move(compact_context), std::chrono::steady_clock::now()};
     }
     
     std::string get(const std::string& file_path) const {
@@ -107,19 +108,23 @@ public:
         std::unique_lock lock(mutex_);
         contexts_.erase(file_path);
     }
+
+    bool contains(const std::string& file_path) const {
+        std::shared_lock lock(mutex_);
+        return contexts_.count(file_path) > 0;
+    }
 };
 
 static CompletionCache g_completion_cache;
 static ContextPreloader g_context_preloader;
 
 // Utility Implementation
-std::string utf8_safe_substr(const std::string& str, size_t length) {
-    if (str.length() <= length) return str;
-    return str.substr(0, length);
+std::string utf8_safe_substr(std::string_view str, size_t length) {
+    return std::string(str.substr(0, length));
 }
 
 // 🚀 PUBLIC API IMPLEMENTATION
-void preload_file_context(const std::string& file_path, const std::string& full_content) {
+void preload_file_context(const std::string& file_path, std::string_view full_content) {
     g_context_preloader.preload(file_path, full_content);
 }
 
@@ -127,6 +132,10 @@ void invalidate_file_context(const std::string& file_path) {
     g_context_preloader.invalidate(file_path);
 }
 
+bool has_file_context(const std::string& file_path) {
+    return g_context_preloader.contains(file_path);
+}
+
 void clear_completion_cache() {
     g_completion_cache.clear();
 }
@@ -134,7 +143,14 @@ void clear_completion_cache() {
 // --- EmbeddingService Implementation ---
 
 EmbeddingService::EmbeddingService(std::shared_ptr<KeyManager> key_manager)
-    : key_manager_(key_manager), cache_manager_(std::make_shared<CacheManager>()) {}
+    : key_manager_(key_manager),
+      cache_manager_(std::make_shared<CacheManager>()),
+      embedding_cache_(std::make_shared<EmbeddingCache>(fs::path("data") / "embedding_cache.bin")) {}
+
+EmbeddingCache& EmbeddingService::embedding_cache() {
+    embedding_cache_->bind_model(key_manager_->get_current_embedding_model());
+    return *embedding_cache_;
+}
 
 std::string EmbeddingService::get_endpoint_url(const std::string& action) {
     std::string key = key_manager_->get_current_key();
@@ -221,6 +237,9 @@ GenerationResult EmbeddingService::call_python_bridge(const std::string& prompt)
 }
 
 std::vector<float> EmbeddingService::generate_embedding(const std::string& text) {
+    auto& cache = embedding_cache();
+    if (auto hit = cache.get(text)) return std::move(*hit);
+
     int max_retries = 3;
     int backoff_ms = 2000;
 
@@ -241,7 +260,9 @@ std::vector<float> EmbeddingService::generate_embedding(const std::string& text)
         if (r.status_code == 200) {
             try {
                 auto j = json::parse(r.text);
-                return j["embedding"]["values"].get<std::vector<float>>();
+                auto vec = j["embedding"]["values"].get<std::vector<float>>();
+                cache.put(text, vec);
+                return vec;
             } catch(...) { break; }
         } 
         
@@ -258,9 +279,69 @@ std::vector<float> EmbeddingService::generate_embedding(const std::string& text)
     return {};
 }
 
+EmbeddingDispatcher& EmbeddingService::dispatcher() {
+    std::call_once(dispatcher_once_, [this]() {
+        DispatchOptions options;
+        options.requests_per_minute = key_manager_->get_embedding_rpm();
+        dispatcher_ = std::make_unique<EmbeddingDispatcher>(
+            key_manager_->get_all_keys(),
+            [this](const std::vector<std::string>& texts, const std::string& key) { return post_batch_embed(texts, key); },
+            options);
+    });
+    return *dispatcher_;
+}
+
+bool EmbeddingService::embeddings_saturated() {
+    return dispatcher().saturated();
+}
+
+size_t EmbeddingService::embedding_concurrency() {
+    return std::max<size_t>(1, dispatcher().max_window());
+}
+
 std::vector<std::vector<float>> EmbeddingService::generate_embeddings_batch(const std::vector<std::string>& texts) {
     if (texts.empty()) return {};
-    
+
+    // 💾 Only texts never embedded under this model go out
+    auto& cache = embedding_cache();
+    std::vector<std::vector<float>> results(texts.size());
+    std::vector<size_t> miss_index;
+    std::vector<std::string> misses;
+    for (size_t i = 0; i < texts.size(); ++i) {
+        if (auto hit = cache.get(texts[i])) results[i] = std::move(*hit);
+        else {
+            miss_index.push_back(i);
+            misses.push_back(texts[i]);
+        }
+    }
+    if (misses.empty()) return results;
+    if (misses.size() < texts.size()) {
+        spdlog::debug("💾 Embedding cache: {}/{} texts cached", texts.size() - misses.size(), texts.size());
+    }
+
+    auto fresh = dispatcher().embed(misses);
+    cache.put_many(misses, fresh);
+    for (size_t j = 0; j < fresh.size() && j < miss_index.size(); ++j) results[miss_index[j]] = std::move(fresh[j]);
+    return results;
+}
+
+// Gemini sends its hint as RetryInfo ("retryDelay": "13s") in the body; proxies use Retry-After
+static int parse_retry_after_ms(const cpr::Response& r) {
+    auto it = r.header.find("Retry-After");
+    if (it != r.header.end()) {
+        try { return (int)(std::stod(it->second) * 1000.0); } catch (...) {}
+    }
+    try {
+        auto j = json::parse(r.text);
+        for (const auto& detail : j["error"].value("details", json::array())) {
+            std::string delay = detail.value("retryDelay", "");
+            if (!delay.empty()) return (int)(std::stod(delay) * 1000.0);
+        }
+    } catch (...) {}
+    return 0;
+}
+
+EmbedReply EmbeddingService::post_batch_embed(const std::vector<std::string>& texts, const std::string& key) {
     json requests = json::array();
     for (const auto& text : texts) {
         requests.push_back({
@@ -269,27 +350,33 @@ std::vector<std::vector<float>> EmbeddingService::generate_embeddings_batch(cons
         });
     }
 
+    std::string url = base_url_ + "models/" + key_manager_->get_current_embedding_model() + ":batchEmbedContents?key=" + key;
     auto r = cpr::Post(
-        cpr::Url{get_endpoint_url("batchEmbedContents")},
+        cpr::Url{url},
         cpr::Body(json{{"requests", requests}}.dump()),
         cpr::Header{{"Content-Type", "application/json"}},
-        cpr::VerifySsl{false}
+        cpr::VerifySsl{false},
+        cpr::Timeout{60000} // A hung request would hold a dispatcher slot forever
     );
 
-    std::vector<std::vector<float>> results;
+    EmbedReply reply;
+    reply.status = (int)r.status_code;
     if (r.status_code == 200) {
         try {
             auto j = json::parse(r.text);
             if (j.contains("embeddings")) {
                 for (const auto& item : j["embeddings"]) {
-                    results.push_back(item.value("values", std::vector<float>{}));
+                    reply.vectors.push_back(item.value("values", std::vector<float>{}));
                 }
             }
-        } catch(...) {}
+        } catch (const std::exception& e) {
+            reply.error = e.what();
+        }
     } else {
-        spdlog::error("❌ Batch Embedding Failed: {} | {}", r.status_code, r.text);
+        reply.error = r.error.message.empty() ? r.text : r.error.message;
+        if (r.status_code == 429) reply.retry_after_ms = parse_retry_after_ms(r);
     }
-    return results;
+    return reply;
 }
 
 std::string EmbeddingService::generate_text(const std::string& prompt) {
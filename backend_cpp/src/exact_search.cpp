@@ -0,0 +1,350 @@
+#include "exact_search.hpp"
+#include "utils/Half.hpp"
+#include <faiss/impl/IDSelector.h>
+#include <algorithm>
+#include <cstring>
+
+#if defined(__x86_64__) || defined(_M_X64) || defined(__i386__) || defined(_M_IX86)
+#define SYNAPSE_X86 1
+#include <immintrin.h>
+#endif
+
+#if defined(_MSC_VER) && !defined(__clang__)
+#include <intrin.h>
+#define SYNAPSE_TARGET(features) // MSVC emits AVX intrinsics without per-function flags
+#else
+#define SYNAPSE_TARGET(features) __attribute__((target(features)))
+#endif
+
+namespace code_assistance {
+namespace exact {
+
+static constexpr size_t kLanes = 16;     // Row padding: one AVX-512 register, two AVX2 registers
+static constexpr size_t kQueryBlock = 4; // Queries sharing one row load
+static constexpr size_t kRowBlock = 64;  // 64 x 768-d fp32 rows = 192 KB, stays in L2 across query blocks
+
+// ============================================================================
+// KERNELS
+// ============================================================================
+// dot4: one row against kQueryBlock queries spaced qstride floats apart. len is a multiple of kLanes.
+
+struct Kernels {
+    const char* name;
+    float (*dot_f32)(const float* q, const float* x, size_t len);
+    void (*dot4_f32)(const float* q, size_t qstride, const float* x, size_t len, float* out);
+    float (*dot_f16)(const float* q, const uint16_t* x, size_t len);
+    void (*dot4_f16)(const float* q, size_t qstride, const uint16_t* x, size_t len, float* out);
+};
+
+static float dot_f32_scalar(const float* q, const float* x, size_t len) {
+    float acc[4] = {0, 0, 0, 0};
+    for (size_t i = 0; i < len; i += 4) {
+        for (size_t j = 0; j < 4; ++j) acc[j] += q[i + j] * x[i + j];
+    }
+    return (acc[0] + acc[1]) + (acc[2] + acc[3]);
+}
+
+static void dot4_f32_scalar(const float* q, size_t qstride, const float* x, size_t len, float* out) {
+    for (size_t j = 0; j < kQueryBlock; ++j) out[j] = dot_f32_scalar(q + j * qstride, x, len);
+}
+
+static float dot_f16_scalar(const float* q, const uint16_t* x, size_t len) {
+    float acc = 0;
+    for (size_t i = 0; i < len; ++i) acc += q[i] * half_to_float(x[i]);
+    return acc;
+}
+
+static void dot4_f16_scalar(const float* q, size_t qstride, const uint16_t* x, size_t len, float* out) {
+    for (size_t j = 0; j < kQueryBlock; ++j) out[j] = 0;
+    for (size_t i = 0; i < len; ++i) {
+        float v = half_to_float(x[i]);
+        for (size_t j = 0; j < kQueryBlock; ++j) out[j] += q[j * qstride + i] * v;
+    }
+}
+
+#ifdef SYNAPSE_X86
+
+SYNAPSE_TARGET("avx2,fma")
+static float hsum_avx2(__m256 v) {
+    __m128 lo = _mm_add_ps(_mm256_castps256_ps128(v), _mm256_extractf128_ps(v, 1));
+    lo = _mm_add_ps(lo, _mm_movehl_ps(lo, lo));
+    lo = _mm_add_ss(lo, _mm_movehdup_ps(lo));
+    return _mm_cvtss_f32(lo);
+}
+
+SYNAPSE_TARGET("avx2,fma")
+static float dot_f32_avx2(const float* q, const float* x, size_t len) {
+    __m256 a0 = _mm256_setzero_ps(), a1 = _mm256_setzero_ps();
+    for (size_t i = 0; i < len; i += 16) {
+        a0 = _mm256_fmadd_ps(_mm256_load_ps(q + i), _mm256_load_ps(x + i), a0);
+        a1 = _mm256_fmadd_ps(_mm256_load_ps(q + i + 8), _mm256_load_ps(x + i + 8), a1);
+    }
+    return hsum_avx2(_mm256_add_ps(a0, a1));
+}
+
+SYNAPSE_TARGET("avx2,fma")
+static void dot4_f32_avx2(const float* q, size_t qstride, const float* x, size_t len, float* out) {
+    __m256 a0 = _mm256_setzero_ps(), a1 = _mm256_setzero_ps(), a2 = _mm256_setzero_ps(), a3 = _mm256_setzero_ps();
+    for (size_t i = 0; i < len; i += 8) {
+        __m256 v = _mm256_load_ps(x + i);
+        a0 = _mm256_fmadd_ps(_mm256_load_ps(q + i), v, a0);
+        a1 = _mm256_fmadd_ps(_mm256_load_ps(q + qstride + i), v, a1);
+        a2 = _mm256_fmadd_ps(_mm256_load_ps(q + 2 * qstride + i), v, a2);
+        a3 = _mm256_fmadd_ps(_mm256_load_ps(q + 3 * qstride + i), v, a3);
+    }
+    out[0] = hsum_avx2(a0);
+    out[1] = hsum_avx2(a1);
+    out[2] = hsum_avx2(a2);
+    out[3] = hsum_avx2(a3);
+}
+
+SYNAPSE_TARGET("avx2,fma,f16c")
+static float dot_f16_avx2(const float* q, const uint16_t* x, size_t len) {
+    __m256 a0 = _mm256_setzero_ps(), a1 = _mm256_setzero_ps();
+    for (size_t i = 0; i < len; i += 16) {
+        __m256 v0 = _mm256_cvtph_ps(_mm_load_si128((const __m128i*)(x + i)));
+        __m256 v1 = _mm256_cvtph_ps(_mm_load_si128((const __m128i*)(x + i + 8)));
+        a0 = _mm256_fmadd_ps(_mm256_load_ps(q + i), v0, a0);
+        a1 = _mm256_fmadd_ps(_mm256_load_ps(q + i + 8), v1, a1);
+    }
+    return hsum_avx2(_mm256_add_ps(a0, a1));
+}
+
+SYNAPSE_TARGET("avx2,fma,f16c")
+static void dot4_f16_avx2(const float* q, size_t qstride, const uint16_t* x, size_t len, float* out) {
+    __m256 a0 = _mm256_setzero_ps(), a1 = _mm256_setzero_ps(), a2 = _mm256_setzero_ps(), a3 = _mm256_setzero_ps();
+    for (size_t i = 0; i < len; i += 8) {
+        __m256 v = _mm256_cvtph_ps(_mm_load_si128((const __m128i*)(x + i)));
+        a0 = _mm256_fmadd_ps(_mm256_load_ps(q + i), v, a0);
+        a1 = _mm256_fmadd_ps(_mm256_load_ps(q + qstride + i), v, a1);
+        a2 = _mm256_fmadd_ps(_mm256_load_ps(q + 2 * qstride + i), v, a2);
+        a3 = _mm256_fmadd_ps(_mm256_load_ps(q + 3 * qstride + i), v, a3);
+    }
+    out[0] = hsum_avx2(a0);
+    out[1] = hsum_avx2(a1);
+    out[2] = hsum_avx2(a2);
+    out[3] = hsum_avx2(a3);
+}
+
+SYNAPSE_TARGET("avx512f")
+static float dot_f32_avx512(const float* q, const float* x, size_t len) {
+    __m512 acc = _mm512_setzero_ps();
+    for (size_t i = 0; i < len; i += 16) {
+        acc = _mm512_fmadd_ps(_mm512_load_ps(q + i), _mm512_load_ps(x + i), acc);
+    }
+    return _mm512_reduce_add_ps(acc);
+}
+
+SYNAPSE_TARGET("avx512f")
+static void dot4_f32_avx512(const float* q, size_t qstride, const float* x, size_t len, float* out) {
+    __m512 a0 = _mm512_setzero_ps(), a1 = _mm512_setzero_ps(), a2 = _mm512_setzero_ps(), a3 = _mm512_setzero_ps();
+    for (size_t i = 0; i < len; i += 16) {
+        __m512 v = _mm512_load_ps(x + i);
+        a0 = _mm512_fmadd_ps(_mm512_load_ps(q + i), v, a0);
+        a1 = _mm512_fmadd_ps(_mm512_load_ps(q + qstride + i), v, a1);
+        a2 = _mm512_fmadd_ps(_mm512_load_ps(q + 2 * qstride + i), v, a2);
+        a3 = _mm512_fmadd_ps(_mm512_load_ps(q + 3 * qstride + i), v, a3);
+    }
+    out[0] = _mm512_reduce_add_ps(a0);
+    out[1] = _mm512_reduce_add_ps(a1);
+    out[2] = _mm512_reduce_add_ps(a2);
+    out[3] = _mm512_reduce_add_ps(a3);
+}
+
+SYNAPSE_TARGET("avx512f")
+static float dot_f16_avx512(const float* q, const uint16_t* x, size_t len) {
+    __m512 acc = _mm512_setzero_ps();
+    for (size_t i = 0; i < len; i += 16) {
+        __m512 v = _mm512_cvtph_ps(_mm256_load_si256((const __m256i*)(x + i)));
+        acc = _mm512_fmadd_ps(_mm512_load_ps(q + i), v, acc);
+    }
+    return _mm512_reduce_add_ps(acc);
+}
+
+SYNAPSE_TARGET("avx512f")
+static void dot4_f16_avx512(const float* q, size_t qstride, const uint16_t* x, size_t len, float* out) {
+    __m512 a0 = _mm512_setzero_ps(), a1 = _mm512_setzero_ps(), a2 = _mm512_setzero_ps(), a3 = _mm512_setzero_ps();
+    for (size_t i = 0; i < len; i += 16) {
+        __m512 v = _mm512_cvtph_ps(_mm256_load_si256((const __m256i*)(x + i)));
+        a0 = _mm512_fmadd_ps(_mm512_load_ps(q + i), v, a0);
+        a1 = _mm512_fmadd_ps(_mm512_load_ps(q + qstride + i), v, a1);
+        a2 = _mm512_fmadd_ps(_mm512_load_ps(q + 2 * qstride + i), v, a2);
+        a3 = _mm512_fmadd_ps(_mm512_load_ps(q + 3 * qstride + i), v, a3);
+    }
+    out[0] = _mm512_reduce_add_ps(a0);
+    out[1] = _mm512_reduce_add_ps(a1);
+    out[2] = _mm512_reduce_add_ps(a2);
+    out[3] = _mm512_reduce_add_ps(a3);
+}
+
+static bool cpu_has_avx2() {
+#if defined(_MSC_VER) && !defined(__clang__)
+    int regs[4];
+    __cpuid(regs, 1);
+    bool fma = regs[2] & (1 << 12), osxsave = regs[2] & (1 << 27), f16c = regs[2] & (1 << 29);
+    if (!fma || !osxsave || !f16c || (_xgetbv(0) & 0x6) != 0x6) return false;
+    __cpuidex(regs, 7, 0);
+    return regs[1] & (1 << 5);
+#else
+    return __builtin_cpu_supports("avx2") && __builtin_cpu_supports("fma") && __builtin_cpu_supports("f16c");
+#endif
+}
+
+static bool cpu_has_avx512() {
+#if defined(_MSC_VER) && !defined(__clang__)
+    int regs[4];
+    __cpuidex(regs, 7, 0);
+    return (regs[1] & (1 << 16)) && (_xgetbv(0) & 0xe6) == 0xe6;
+#else
+    return __builtin_cpu_supports("avx512f");
+#endif
+}
+
+#endif // SYNAPSE_X86
+
+static const Kernels& kernels() {
+    static const Kernels selected = []() -> Kernels {
+#ifdef SYNAPSE_X86
+        if (cpu_has_avx2() && cpu_has_avx512()) {
+            return {"avx512", dot_f32_avx512, dot4_f32_avx512, dot_f16_avx512, dot4_f16_avx512};
+        }
+        if (cpu_has_avx2()) return {"avx2", dot_f32_avx2, dot4_f32_avx2, dot_f16_avx2, dot4_f16_avx2};
+#endif
+        return {"scalar", dot_f32_scalar, dot4_f32_scalar, dot_f16_scalar, dot4_f16_scalar};
+    }();
+    return selected;
+}
+
+const char* kernel_name() {
+    return kernels().name;
+}
+
+// ============================================================================
+// TOP-K
+// ============================================================================
+
+void TopK::push(float dist, long id) {
+    if (k_ == 0) return;
+    if (heap_.size() < k_) {
+        heap_.emplace_back(dist, id);
+        std::push_heap(heap_.begin(), heap_.end());
+    } else if (dist < heap_.front().first) {
+        std::pop_heap(heap_.begin(), heap_.end());
+        heap_.back() = {dist, id};
+        std::push_heap(heap_.begin(), heap_.end());
+    }
+}
+
+void TopK::merge(const TopK& other) {
+    for (const auto& [dist, id] : other.heap_) push(dist, id);
+}
+
+std::vector<std::pair<float, long>> TopK::take_sorted() {
+    std::sort_heap(heap_.begin(), heap_.end());
+    return std::move(heap_);
+}
+
+// ============================================================================
+// MATRIX
+// ============================================================================
+
+ExactMatrix::ExactMatrix(size_t dimension, Storage storage)
+    : dim_(dimension), stride_((dimension + kLanes - 1) / kLanes * kLanes), storage_(storage) {}
+
+void ExactMatrix::reserve(size_t rows) {
+    ids_.reserve(rows);
+    if (storage_ == Storage::FP16) f16_.reserve(rows * stride_);
+    else f32_.reserve(rows * stride_);
+}
+
+void ExactMatrix::append(long id, const float* vec) {
+    ids_.push_back(id);
+    if (storage_ == Storage::FP16) {
+        size_t at = f16_.size();
+        f16_.resize(at + stride_, 0);
+        for (size_t i = 0; i < dim_; ++i) f16_[at + i] = float_to_half(vec[i]);
+    } else {
+        size_t at = f32_.size();
+        f32_.resize(at + stride_, 0.0f);
+        std::copy(vec, vec + dim_, f32_.begin() + at);
+    }
+}
+
+void ExactMatrix::append_row(const ExactMatrix& other, size_t row) {
+    ids_.push_back(other.ids_[row]);
+    if (storage_ == other.storage_ && stride_ == other.stride_) {
+        if (storage_ == Storage::FP16) {
+            f16_.insert(f16_.end(), other.f16_.begin() + row * stride_, other.f16_.begin() + (row + 1) * stride_);
+        } else {
+            f32_.insert(f32_.end(), other.f32_.begin() + row * stride_, other.f32_.begin() + (row + 1) * stride_);
+        }
+        return;
+    }
+    ids_.pop_back();
+    std::vector<float> tmp(other.dim_);
+    other.decode_row(row, tmp.data());
+    append(other.ids_[row], tmp.data());
+}
+
+size_t ExactMatrix::bytes() const {
+    return ids_.size() * sizeof(long) + f32_.size() * sizeof(float) + f16_.size() * sizeof(uint16_t);
+}
+
+void ExactMatrix::decode_row(size_t row, float* out) const {
+    if (storage_ == Storage::FP16) {
+        const uint16_t* src = f16_.data() + row * stride_;
+        for (size_t i = 0; i < dim_; ++i) out[i] = half_to_float(src[i]);
+    } else {
+        const float* src = f32_.data() + row * stride_;
+        std::copy(src, src + dim_, out);
+    }
+}
+
+bool ExactMatrix::decode(long id, float* out) const {
+    auto it = std::lower_bound(ids_.begin(), ids_.end(), id);
+    if (it == ids_.end() || *it != id) return false;
+    decode_row((size_t)(it - ids_.begin()), out);
+    return true;
+}
+
+void ExactMatrix::scan(const float* queries, size_t n, const faiss::IDSelector* sel, TopK* heaps,
+                       size_t row_begin, size_t row_end) const {
+    row_end = std::min(row_end, ids_.size());
+    if (n == 0 || row_begin >= row_end) return;
+    const Kernels& kern = kernels();
+
+    // Queries padded to the row stride: the zero lanes meet zero lanes and add nothing
+    std::vector<float, AlignedAllocator<float>> padded(n * stride_, 0.0f);
+    for (size_t q = 0; q < n; ++q) std::copy(queries + q * dim_, queries + (q + 1) * dim_, padded.begin() + q * stride_);
+
+    bool keep[kRowBlock];
+    float ip[kQueryBlock];
+    for (size_t r0 = row_begin; r0 < row_end; r0 += kRowBlock) {
+        size_t r1 = std::min(row_end, r0 + kRowBlock);
+        for (size_t r = r0; r < r1; ++r) keep[r - r0] = !sel || sel->is_member(ids_[r]);
+
+        // Register-blocked GEMM: each row is loaded once per block of four queries
+        size_t q = 0;
+        for (; q + kQueryBlock <= n; q += kQueryBlock) {
+            const float* qb = padded.data() + q * stride_;
+            for (size_t r = r0; r < r1; ++r) {
+                if (!keep[r - r0]) continue;
+                if (storage_ == Storage::FP16) kern.dot4_f16(qb, stride_, f16_.data() + r * stride_, stride_, ip);
+                else kern.dot4_f32(qb, stride_, f32_.data() + r * stride_, stride_, ip);
+                for (size_t j = 0; j < kQueryBlock; ++j) heaps[q + j].push(2.0f - 2.0f * ip[j], ids_[r]);
+            }
+        }
+        for (; q < n; ++q) {
+            const float* qv = padded.data() + q * stride_;
+            for (size_t r = r0; r < r1; ++r) {
+                if (!keep[r - r0]) continue;
+                float dot = storage_ == Storage::FP16 ? kern.dot_f16(qv, f16_.data() + r * stride_, stride_)
+                                                      : kern.dot_f32(qv, f32_.data() + r * stride_, stride_);
+                heaps[q].push(2.0f - 2.0f * dot, ids_[r]);
+            }
+        }
+    }
+}
+
+} // namespace exact
+} // namespace code_assistance
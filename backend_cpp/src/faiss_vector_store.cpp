@@ -1,6 +1,15 @@
 #include "faiss_vector_store.hpp"
+#include "node_store.hpp"
+#include "exact_search.hpp"
+#include "reference_graph.hpp"
+#include "utils/MappedFile.hpp"
 #include <faiss/IndexHNSW.h>
+#include <faiss/IndexIDMap.h>
+#include <faiss/IndexFlat.h>
+#include <faiss/IndexIVFPQ.h>
+#include <faiss/IndexScalarQuantizer.h>
 #include <faiss/index_io.h>
+#include <faiss/impl/io.h>
 #include <faiss/impl/FaissAssert.h>
 #include <vector>
 #include <numeric>
@@ -9,153 +18,1272 @@
 #include <nlohmann/json.hpp>
 #include <spdlog/spdlog.h>
 #include <unordered_map>
+#include <algorithm>
+#include <array>
+#include <chrono>
+#include <tuple>
+
+// FAISS 1.10 added zero-copy mmap reads (IO_FLAG_MMAP_IFC); its file mapping is POSIX-only
+#if !defined(_WIN32) && (FAISS_VERSION_MAJOR > 1 || (FAISS_VERSION_MAJOR == 1 && FAISS_VERSION_MINOR >= 10))
+#define SYNAPSE_FAISS_MMAP 1
+#else
+#define SYNAPSE_FAISS_MMAP 0
+#endif
 
 namespace fs = std::filesystem;
 using json = nlohmann::json;
 
 namespace code_assistance {
 
-struct IndexDeleter {
-    void operator()(faiss::Index* idx) {
-        delete idx;
+// 🧹 Compaction kicks in once this many vectors are dead AND they make up this share of the index
+static constexpr size_t kCompactionMinTombstones = 1024;
+static constexpr double kCompactionRatio = 0.25;
+
+// 🗜️ IVF-PQ needs a k-means sample: below this many vectors the store stays exact (flat staging)
+static constexpr size_t kIvfPqMinTrain = 4096;
+static constexpr size_t kIvfPqPointsPerList = 39; // FAISS warns below 39 training points per centroid
+
+// 📖 Delta chunks are scanned exactly; past this many vectors they are folded into a new segment
+// (unless the whole store is still under exact_max_vectors)
+static constexpr size_t kDeltaFoldVectors = 2048;
+// Delta rows per parallel scan task
+static constexpr size_t kScanTaskRows = 4096;
+
+// 🪜 Tiered segments: tier t holds about kDeltaFoldVectors * kSegmentMergeFactor^t vectors.
+// kSegmentMergeFactor segments of the same tier are merged into one of the next tier.
+static constexpr size_t kSegmentMergeFactor = 4;
+static constexpr size_t kMaxSegments = 16; // Past this, the two newest segments merge regardless of tier
+
+// ⏱️ Adaptive search doubles efSearch per round up to this width
+static constexpr int kMaxAdaptiveEf = 1024;
+
+std::string index_mode_name(IndexMode mode) {
+    switch (mode) {
+        case IndexMode::FLAT: return "flat";
+        case IndexMode::HNSW_FLAT: return "hnsw";
+        case IndexMode::HNSW_SQ8: return "hnsw_sq8";
+        case IndexMode::HNSW_FP16: return "hnsw_fp16";
+        case IndexMode::IVF_PQ: return "ivf_pq";
+    }
+    return "hnsw";
+}
+
+VectorIndexConfig VectorIndexConfig::from_json(const json& j) {
+    VectorIndexConfig cfg;
+    if (!j.is_object()) return cfg;
+
+    std::string mode = j.value("mode", "hnsw");
+    if (mode == "flat") cfg.mode = IndexMode::FLAT;
+    else if (mode == "hnsw_sq8") cfg.mode = IndexMode::HNSW_SQ8;
+    else if (mode == "hnsw_fp16") cfg.mode = IndexMode::HNSW_FP16;
+    else if (mode == "ivf_pq") cfg.mode = IndexMode::IVF_PQ;
+    else if (mode != "hnsw") spdlog::warn("⚠️ Unknown vector_index mode '{}', using hnsw", mode);
+
+    cfg.hnsw_m = j.value("hnsw_m", cfg.hnsw_m);
+    cfg.ef_construction = j.value("ef_construction", cfg.ef_construction);
+    cfg.ef_search = j.value("ef_search", cfg.ef_search);
+    cfg.ivf_nlist = j.value("ivf_nlist", cfg.ivf_nlist);
+    cfg.ivf_nprobe = j.value("ivf_nprobe", cfg.ivf_nprobe);
+    cfg.pq_m = j.value("pq_m", cfg.pq_m);
+    cfg.pq_nbits = j.value("pq_nbits", cfg.pq_nbits);
+    cfg.keep_node_embeddings = j.value("keep_node_embeddings", cfg.keep_node_embeddings);
+    cfg.exact_max_vectors = j.value("exact_max_vectors", cfg.exact_max_vectors);
+    cfg.exact_fp16 = j.value("exact_fp16", cfg.exact_fp16);
+    cfg.mmap_segments = j.value("mmap_segments", cfg.mmap_segments);
+
+    std::string prefetch = j.value("prefetch", "willneed");
+    if (prefetch == "none") cfg.prefetch = IndexPrefetch::NONE;
+    else if (prefetch == "populate") cfg.prefetch = IndexPrefetch::POPULATE;
+    else if (prefetch != "willneed") spdlog::warn("⚠️ Unknown vector_index prefetch '{}', using willneed", prefetch);
+    return cfg;
+}
+
+SearchParams SearchParams::from_json(const json& j) {
+    SearchParams params;
+    if (!j.is_object()) return params;
+    params.ef = std::max(0, j.value("ef", 0));
+    params.time_budget_us = std::max<int64_t>(0, j.value("time_budget_us", (int64_t)0));
+    params.nprobe = std::max(0, j.value("nprobe", 0));
+    params.adaptive = j.value("adaptive", false);
+    return params;
+}
+
+static bool filter_matches(const VectorFilter& filter, long id, const CodeNode* node) {
+    for (const auto* set : filter.all_of) {
+        if (!set->count(id)) return false;
     }
+    if (!filter.any_of.empty()) {
+        bool hit = false;
+        for (const auto* set : filter.any_of) {
+            if (set->count(id)) { hit = true; break; }
+        }
+        if (!hit) return false;
+    }
+    if (!filter.code_types.empty() && !filter.code_types.count(node->type)) return false;
+    if (!filter.path_prefix.empty() &&
+        node->file_path.compare(0, filter.path_prefix.size(), filter.path_prefix) != 0) return false;
+    return true;
+}
+
+// Which layout a (possibly loaded-from-disk) inner index actually has
+static IndexMode detect_mode(const faiss::Index* idx) {
+    if (auto* hnsw = dynamic_cast<const faiss::IndexHNSW*>(idx)) {
+        if (auto* sq = dynamic_cast<const faiss::IndexScalarQuantizer*>(hnsw->storage)) {
+            return sq->sq.qtype == faiss::ScalarQuantizer::QT_fp16 ? IndexMode::HNSW_FP16 : IndexMode::HNSW_SQ8;
+        }
+        return IndexMode::HNSW_FLAT;
+    }
+    if (dynamic_cast<const faiss::IndexIVFPQ*>(idx)) return IndexMode::IVF_PQ;
+    return IndexMode::FLAT;
+}
+
+static size_t segment_tier(size_t ntotal) {
+    size_t tier = 0;
+    for (size_t cap = kDeltaFoldVectors * kSegmentMergeFactor; ntotal >= cap; cap *= kSegmentMergeFactor) tier++;
+    return tier;
+}
+
+// Segments are ordered oldest (largest) first. Returns the [from, to) run to merge next; empty if none.
+static std::pair<size_t, size_t> plan_merge(const std::vector<std::shared_ptr<const faiss::IndexIDMap2>>& segments) {
+    size_t n = segments.size();
+    if (n < 2) return {n, n};
+
+    size_t tier = segment_tier((size_t)segments.back()->ntotal);
+    size_t from = n - 1;
+    while (from > 0 && segment_tier((size_t)segments[from - 1]->ntotal) <= tier) from--;
+    if (n - from >= kSegmentMergeFactor) return {from, n};
+    if (n > kMaxSegments) return {n - 2, n};
+    return {n, n};
+}
+
+// Reads one segment file. Mapped, the flat codes and HNSW links are served from the page cache
+// instead of being copied into the heap; the mapping lives as long as the index does.
+static faiss::Index* read_segment(const fs::path& file, [[maybe_unused]] const VectorIndexConfig& config) {
+#if SYNAPSE_FAISS_MMAP
+    if (config.mmap_segments) {
+        if (config.prefetch != IndexPrefetch::NONE) {
+            // Warms the page cache that FAISS's own mapping will share
+            MappedFile(file.string()).prefetch(config.prefetch == IndexPrefetch::POPULATE);
+        }
+        try {
+            return faiss::read_index(file.string().c_str(), faiss::IO_FLAG_MMAP_IFC);
+        } catch (const faiss::FaissException& e) {
+            spdlog::warn("⚠️ Mapped read of {} failed, loading into memory: {}", file.string(), e.what());
+        }
+    }
+#endif
+    return faiss::read_index(file.string().c_str());
+}
+
+// Writes next to the target and renames over it: a segment mapped from the old file keeps
+// its inode, and a crash never leaves a half-written segment behind
+static void write_segment(const faiss::Index* index, const fs::path& file) {
+    fs::path tmp = file;
+    tmp += ".tmp";
+    faiss::write_index(index, tmp.string().c_str());
+    fs::rename(tmp, file);
+}
+
+// Segment 0 keeps the historical single-index file name, so older readers still find the bulk of the index
+static fs::path segment_file(const fs::path& dir, size_t i) {
+    return i == 0 ? dir / "faiss.index" : dir / ("faiss." + std::to_string(i) + ".index");
+}
+
+// ============================================================================
+// VERSIONED READ VIEW
+// ============================================================================
+
+// FAISS id -> live CodeNode, split into fixed pages. A new version copies the page list
+// and clones only the pages it writes, so a pinned older version never observes a change.
+class FaissVectorStore::NodeTable {
+public:
+    static constexpr size_t kPageBits = 10;
+    static constexpr size_t kPageSize = size_t(1) << kPageBits;
+
+    const std::shared_ptr<CodeNode>* slot(long id) const {
+        size_t p = (size_t)id >> kPageBits;
+        if (id < 0 || p >= pages_.size() || !pages_[p]) return nullptr;
+        const auto& node = (*pages_[p])[(size_t)id & (kPageSize - 1)];
+        return node ? &node : nullptr;
+    }
+    const CodeNode* get(long id) const {
+        auto* s = slot(id);
+        return s ? s->get() : nullptr;
+    }
+
+    void set(long id, std::shared_ptr<CodeNode> node) {
+        size_t p = (size_t)id >> kPageBits;
+        if (p >= pages_.size()) {
+            if (!node) return;
+            pages_.resize(p + 1);
+        }
+        auto& page = pages_[p];
+        if (!page) {
+            if (!node) return;
+            page = std::make_shared<Page>();
+        } else if (page.use_count() > 1) {
+            // Still referenced by a published version: copy on write. A count of 1 means
+            // only this unpublished table holds the page, and nobody else can reach it.
+            page = std::make_shared<Page>(*page);
+        }
+        auto& entry = (*page)[(size_t)id & (kPageSize - 1)];
+        entry = std::move(node);
+        if (!entry && std::none_of(page->begin(), page->end(), [](const auto& n) { return (bool)n; })) {
+            page.reset(); // Fully dead pages (old ids after re-syncs) cost one null pointer
+        }
+    }
+
+    template <typename Fn>
+    void for_each(Fn&& fn) const {
+        for (size_t p = 0; p < pages_.size(); ++p) {
+            if (!pages_[p]) continue;
+            for (size_t i = 0; i < kPageSize; ++i) {
+                const auto& node = (*pages_[p])[i];
+                if (node) fn((long)((p << kPageBits) | i), node);
+            }
+        }
+    }
+
+private:
+    using Page = std::array<std::shared_ptr<CodeNode>, kPageSize>;
+    std::vector<std::shared_ptr<Page>> pages_;
 };
 
-FaissVectorStore::FaissVectorStore(int dimension) : dimension_(dimension) {
-    // 🚀 THE ACCELERATOR: 32 links per node. efConstruction=128.
-    // This allows the search to 'jump' across the code graph.
-    faiss::IndexHNSWFlat* hnsw_idx = new faiss::IndexHNSWFlat(dimension, 32);
-    hnsw_idx->hnsw.efConstruction = 128; // High precision indexing
-    hnsw_idx->hnsw.efSearch = 64;       // Fast retrieval
-    
-    index_.reset(hnsw_idx); 
-    spdlog::info("🚀 HNSW Accelerator Core Primed. Dimension: {}", dimension);
+struct FaissVectorStore::Snapshot {
+    uint64_t version = 0;
+    // Frozen once published, oldest (largest) first. Folds append a segment, merges replace a run of them.
+    std::vector<std::shared_ptr<const faiss::IndexIDMap2>> segments;
+    // Recent writes as normalized exact matrices (ascending ids), scanned until a fold turns them into a segment.
+    // Chunk sizes strictly decrease, so a delta of n vectors is at most log2(n) + 1 chunks.
+    std::vector<std::shared_ptr<const exact::ExactMatrix>> delta;
+    NodeTable nodes;
+    uint64_t node_epoch = 0; // Bumped when nodes changes; folds and merges carry it over
+    // Last linked reference graph (carried into every later version) and the node_epoch it was linked from
+    std::shared_ptr<const ReferenceGraph> refs;
+    uint64_t refs_epoch = 0;
+    size_t live = 0;       // Non-null entries in nodes
+    size_t dead = 0;       // Tombstoned vectors still inside segments/delta
+    size_t delta_size = 0; // Vectors across all delta chunks
+
+    size_t physical() const {
+        size_t total = delta_size;
+        for (const auto& seg : segments) total += (size_t)seg->ntotal;
+        return total;
+    }
+};
+
+FaissVectorStore::FaissVectorStore(int dimension, VectorIndexConfig config)
+    : dimension_(dimension), config_(config) {
+    if (config_.mode == IndexMode::IVF_PQ && (config_.pq_m <= 0 || dimension_ % config_.pq_m != 0)) {
+        spdlog::warn("⚠️ pq_m={} does not divide dimension {}, falling back to hnsw_sq8", config_.pq_m, dimension_);
+        config_.mode = IndexMode::HNSW_SQ8;
+    }
+    snapshot_.store(std::make_shared<Snapshot>());
+    spdlog::info("🚀 Vector Accelerator Core Primed. Mode: {} | Dimension: {}", index_mode_name(config_.mode), dimension);
 }
 
 FaissVectorStore::~FaissVectorStore() {
+    if (compaction_thread_.joinable()) compaction_thread_.join();
 }
 
-void FaissVectorStore::add_nodes(const std::vector<std::shared_ptr<CodeNode>>& nodes) {
-    std::unique_lock lock(rw_mutex_);
+std::unique_ptr<faiss::IndexIDMap2> FaissVectorStore::make_index(const float* train, size_t n_train) const {
+    faiss::Index* inner = nullptr;
 
-    if (nodes.empty()) return;
+    switch (config_.mode) {
+        case IndexMode::FLAT:
+            inner = new faiss::IndexFlatL2(dimension_);
+            break;
+        case IndexMode::HNSW_SQ8:
+        case IndexMode::HNSW_FP16: {
+            auto qtype = config_.mode == IndexMode::HNSW_FP16 ? faiss::ScalarQuantizer::QT_fp16
+                                                              : faiss::ScalarQuantizer::QT_8bit;
+            auto* hnsw = new faiss::IndexHNSWSQ(dimension_, qtype, config_.hnsw_m);
+            hnsw->hnsw.efConstruction = config_.ef_construction;
+            hnsw->hnsw.efSearch = config_.ef_search;
+            // SQ8 learns per-dimension ranges; with no sample yet it trains on what arrives first
+            if (train && n_train > 0) hnsw->train(n_train, train);
+            inner = hnsw;
+            break;
+        }
+        case IndexMode::IVF_PQ: {
+            if (!train || n_train < kIvfPqMinTrain) {
+                inner = new faiss::IndexFlatL2(dimension_); // Exact staging until there is enough to train on
+                break;
+            }
+            size_t nlist = std::clamp<size_t>(n_train / kIvfPqPointsPerList, 1, (size_t)config_.ivf_nlist);
+            auto* quantizer = new faiss::IndexFlatL2(dimension_);
+            auto* ivf = new faiss::IndexIVFPQ(quantizer, dimension_, nlist, config_.pq_m, config_.pq_nbits);
+            ivf->own_fields = true;
+            ivf->nprobe = config_.ivf_nprobe;
+            ivf->train(n_train, train);
+            ivf->make_direct_map(); // reconstruct() is needed by compaction and save
+            inner = ivf;
+            break;
+        }
+        case IndexMode::HNSW_FLAT:
+        default: {
+            // 🚀 THE ACCELERATOR: 32 links per node. efConstruction=128.
+            // This allows the search to 'jump' across the code graph.
+            auto* hnsw_idx = new faiss::IndexHNSWFlat(dimension_, config_.hnsw_m);
+            hnsw_idx->hnsw.efConstruction = config_.ef_construction; // High precision indexing
+            hnsw_idx->hnsw.efSearch = config_.ef_search;             // Fast retrieval
+            inner = hnsw_idx;
+            break;
+        }
+    }
 
-    std::vector<float> vectors_flat;
-    std::vector<const std::shared_ptr<CodeNode>*> node_pointers;
+    auto id_map = std::make_unique<faiss::IndexIDMap2>(inner);
+    id_map->own_fields = true;
+    return id_map;
+}
+
+std::unique_ptr<faiss::IndexIDMap2> FaissVectorStore::build_segment(const std::vector<long>& ids,
+                                                                   const std::vector<float>& vecs) const {
+    if (ids.empty()) return nullptr;
+    // Every segment trains its own quantizer on its own contents, so SQ8 ranges and
+    // IVF-PQ centroids are refreshed each time a merge rebuilds a larger segment
+    auto seg = make_index(vecs.data(), ids.size());
+    if (!seg->index->is_trained) seg->index->train(ids.size(), vecs.data());
+    seg->is_trained = true;
+    std::vector<faiss::idx_t> faiss_ids(ids.begin(), ids.end());
+    seg->add_with_ids(faiss_ids.size(), vecs.data(), faiss_ids.data());
+    return seg;
+}
+
+std::unique_ptr<faiss::SearchParameters> FaissVectorStore::make_search_params(const faiss::Index* inner, int k, int ef, int nprobe,
+                                                                              faiss::IDSelector* sel) const {
+    // Dispatch on the live layout, not config_: IVF-PQ may still be in flat staging
+    std::unique_ptr<faiss::SearchParameters> params;
+    if (dynamic_cast<const faiss::IndexHNSW*>(inner)) {
+        auto p = std::make_unique<faiss::SearchParametersHNSW>();
+        p->efSearch = std::max(ef, k);
+        params = std::move(p);
+    } else if (dynamic_cast<const faiss::IndexIVF*>(inner)) {
+        auto p = std::make_unique<faiss::SearchParametersIVF>();
+        p->nprobe = nprobe; // FAISS clamps this to nlist
+        params = std::move(p);
+    } else {
+        params = std::make_unique<faiss::SearchParameters>();
+    }
+    params->sel = sel;
+    return params;
+}
+
+std::shared_ptr<const FaissVectorStore::Snapshot> FaissVectorStore::current() const {
+    return snapshot_.load(std::memory_order_acquire);
+}
+
+void FaissVectorStore::publish_locked(std::shared_ptr<Snapshot> next) {
+    // NO LOCK HERE - caller must hold write_mutex_
+    next->version = ++version_;
+    next->dead = tombstones_.size();
+    snapshot_.store(std::move(next), std::memory_order_release);
+}
+
+void FaissVectorStore::reconstruct(const Snapshot& snap, long id, float* out) const {
+    for (const auto& chunk : snap.delta) {
+        if (chunk->decode(id, out)) return;
+    }
+    for (const auto& seg : snap.segments) {
+        if (seg->rev_map.count(id)) {
+            seg->reconstruct(id, out);
+            return;
+        }
+    }
+    std::fill(out, out + dimension_, 0.0f);
+}
 
-    for (const auto& node : nodes) {
-        if (!node->embedding.empty()) {
-            vectors_flat.insert(vectors_flat.end(), node->embedding.begin(), node->embedding.end());
-            node_pointers.push_back(&node);
+void FaissVectorStore::vector_of_locked(const Snapshot& snap, long id, float* out) const {
+    // NO LOCK HERE - caller must hold persist_mutex_ (mapped_ may be read)
+    // Prefer exact fp32 sources over decoding a (possibly quantized) code from the index
+    if (const auto* slot = snap.nodes.slot(id)) {
+        const auto& node = *slot;
+        std::span<const float> raw;
+        if (node->embedding.size() == (size_t)dimension_) {
+            raw = node->embedding;
+        } else if (mapped_) {
+            auto row = mapped_row_.find(id);
+            if (row != mapped_row_.end()) raw = mapped_->embedding(row->second);
         }
+        if (raw.size() == (size_t)dimension_) {
+            std::copy(raw.begin(), raw.end(), out);
+            faiss::fvec_renorm_L2(dimension_, 1, out);
+            return;
+        }
+    }
+    reconstruct(snap, id, out);
+}
+
+std::shared_ptr<exact::ExactMatrix> FaissVectorStore::make_chunk() const {
+    return std::make_shared<exact::ExactMatrix>(dimension_, config_.exact_fp16 ? exact::Storage::FP16
+                                                                               : exact::Storage::FP32);
+}
+
+void FaissVectorStore::coalesce_delta_locked(Snapshot& next) {
+    // NO LOCK HERE - caller must hold write_mutex_
+    // Binary-counter merging: a chunk no larger than the newest one absorbs it, so chunk sizes
+    // strictly decrease and each vector is copied O(log n) times. Agent steps write one node
+    // at a time and would otherwise leave a long list of one-row chunks to scan.
+    // Dead rows are dropped on the way, unless a running fold may have pinned them.
+    bool reclaim = !compacting_.load();
+    auto& delta = next.delta;
+    while (delta.size() >= 2 && delta[delta.size() - 2]->size() <= delta.back()->size()) {
+        const auto& older = *delta[delta.size() - 2];
+        const auto& newer = *delta.back();
+        auto merged = make_chunk();
+        merged->reserve(older.size() + newer.size());
+        for (const auto* src : {&older, &newer}) {
+            for (size_t r = 0; r < src->size(); ++r) {
+                long id = src->ids()[r];
+                if (reclaim && !next.nodes.get(id)) {
+                    tombstones_.erase(id);
+                    next.delta_size--;
+                    continue;
+                }
+                merged->append_row(*src, r);
+            }
+        }
+        delta.pop_back();
+        if (merged->size() > 0) delta.back() = std::move(merged);
+        else delta.pop_back();
+    }
+}
+
+void FaissVectorStore::add_nodes(const std::vector<std::shared_ptr<CodeNode>>& nodes) {
+    upsert_nodes(nodes);
+}
+
+void FaissVectorStore::drop_node_locked(Snapshot& next, const std::string& node_id) {
+    // NO LOCK HERE - caller must hold write_mutex_
+    auto it = name_to_id_map_.find(node_id);
+    if (it == name_to_id_map_.end()) return;
+
+    tombstones_.insert(it->second);
+    next.nodes.set(it->second, nullptr);
+    next.live--;
+    name_to_id_map_.erase(it);
+}
+
+std::vector<long> FaissVectorStore::upsert_nodes(const std::vector<std::shared_ptr<CodeNode>>& nodes) {
+    std::lock_guard<std::mutex> lock(write_mutex_);
+
+    std::vector<long> assigned(nodes.size(), -1);
+    if (nodes.empty()) return assigned;
+
+    // New vectors land in an exact delta chunk: no graph insertion on the write path
+    std::vector<float> batch;
+    std::vector<size_t> input_pos;
+
+    for (size_t i = 0; i < nodes.size(); ++i) {
+        const auto& node = nodes[i];
+        if (!node || node->embedding.size() != (size_t)dimension_) continue;
+
+        batch.insert(batch.end(), node->embedding.begin(), node->embedding.end());
+        input_pos.push_back(i);
     }
 
-    if (vectors_flat.empty()) return;
+    if (input_pos.empty()) return assigned;
+
+    long num_to_add = input_pos.size();
+    faiss::fvec_renorm_L2(dimension_, num_to_add, batch.data());
 
-    long start_idx = index_->ntotal;
-    long num_to_add = node_pointers.size();
-    
-    faiss::fvec_renorm_L2(dimension_, num_to_add, vectors_flat.data());
-    
-    index_->add(num_to_add, vectors_flat.data());
+    auto chunk = make_chunk();
+    chunk->reserve(num_to_add);
+    for (long i = 0; i < num_to_add; ++i) chunk->append(next_id_++, batch.data() + i * dimension_);
 
+    // Readers keep the published version; everything below edits a private copy
+    auto next = std::make_shared<Snapshot>(*current());
     for (long i = 0; i < num_to_add; ++i) {
-        long current_id = start_idx + i;
-        auto node = *node_pointers[i];
-        
-        nodes_list_.push_back(node);
-        id_to_node_map_[current_id] = node;
-        name_to_id_map_[node->id] = current_id;
+        const auto& node = nodes[input_pos[i]];
+
+        // Replacing a node = tombstone the old vector. Within one batch the last duplicate wins.
+        drop_node_locked(*next, node->id);
+
+        long id = chunk->ids()[i];
+        next->nodes.set(id, node);
+        next->live++;
+        name_to_id_map_[node->id] = id;
+        assigned[input_pos[i]] = id;
+    }
+    next->delta.push_back(std::move(chunk));
+    next->delta_size += num_to_add;
+    next->node_epoch++;
+    coalesce_delta_locked(*next);
+    publish_locked(next);
+
+    if (!config_.keep_node_embeddings) {
+        // The delta (then the index, plus nodes.bin after the next save) is now the only copy
+        for (size_t pos : input_pos) {
+            auto& emb = nodes[pos]->embedding;
+            emb.clear();
+            emb.shrink_to_fit();
+        }
+    }
+
+    spdlog::info("✅ Upserted {} nodes to FAISS. Live: {} | Tombstones: {} | Delta: {}",
+                 num_to_add, next->live, tombstones_.size(), next->delta_size);
+    maybe_schedule_compaction(*next);
+    return assigned;
+}
+
+size_t FaissVectorStore::remove_nodes(const std::vector<std::string>& node_ids) {
+    std::lock_guard<std::mutex> lock(write_mutex_);
+
+    auto next = std::make_shared<Snapshot>(*current());
+    size_t removed = 0;
+    for (const auto& id : node_ids) {
+        if (name_to_id_map_.count(id)) {
+            drop_node_locked(*next, id);
+            removed++;
+        }
     }
 
-    spdlog::info("✅ Added {} nodes to FAISS. Total: {}", num_to_add, index_->ntotal);
+    if (removed > 0) {
+        next->node_epoch++;
+        publish_locked(next);
+        spdlog::info("🪦 Tombstoned {} nodes. Live: {} | Tombstones: {}", removed, next->live, tombstones_.size());
+        maybe_schedule_compaction(*next);
+    }
+    return removed;
 }
 
 std::vector<FaissSearchResult> FaissVectorStore::search(const std::vector<float>& query_vector, int k) {
-    std::shared_lock lock(rw_mutex_);
+    return search(query_vector, k, VectorFilter{}, SearchParams{});
+}
+
+std::vector<FaissSearchResult> FaissVectorStore::search(const std::vector<float>& query_vector, int k, const SearchParams& params) {
+    return search(query_vector, k, VectorFilter{}, params);
+}
+
+std::vector<FaissSearchResult> FaissVectorStore::search(const std::vector<float>& query_vector, int k, const VectorFilter& filter,
+                                                        const SearchParams& params) {
+    if (query_vector.size() != (size_t)dimension_) return {};
+    auto batch = search_batch(query_vector.data(), 1, k, filter, params);
+    return std::move(batch.front());
+}
+
+std::vector<std::vector<FaissSearchResult>> FaissVectorStore::search_batch(const float* queries, size_t n, int k,
+                                                                           const VectorFilter& filter,
+                                                                           const SearchParams& params) {
+    // Masks tombstoned ids during the walk: a dead id has no node in the pinned table
+    struct LiveSelector : faiss::IDSelector {
+        const NodeTable* nodes;
+        explicit LiveSelector(const NodeTable* t) : nodes(t) {}
+        bool is_member(faiss::idx_t id) const override { return nodes->get((long)id) != nullptr; }
+    };
+    // Evaluates a VectorFilter per visited id (tombstones have no node, so they fail the lookup)
+    struct FilterSelector : faiss::IDSelector {
+        const VectorFilter* filter;
+        const NodeTable* nodes;
+        FilterSelector(const VectorFilter* f, const NodeTable* t) : filter(f), nodes(t) {}
+        bool is_member(faiss::idx_t id) const override {
+            const CodeNode* node = nodes->get((long)id);
+            return node && filter_matches(*filter, (long)id, node);
+        }
+    };
+
+    std::vector<std::vector<FaissSearchResult>> results(n);
+    if (n == 0 || k <= 0) return results;
+    const auto started = std::chrono::steady_clock::now();
+
+    // Pin one version for the whole batch; writers publish newer ones without waiting for us
+    auto snap = current();
+    if (snap->live == 0) return results;
+
+    // One contiguous n x d block, one renorm, one index call: FAISS fans the queries
+    // out over its OpenMP pool instead of us paying the dispatch n times
+    const size_t d = (size_t)dimension_;
+    std::vector<float> query_block(queries, queries + n * d);
+    faiss::fvec_renorm_L2(d, n, query_block.data());
+
+    // Tombstones (and the filter) are applied inside the graph walk, so we still get k live hits
+    LiveSelector live_sel(&snap->nodes);
+    FilterSelector filter_sel(&filter, &snap->nodes);
+    faiss::IDSelector* sel = nullptr;
+    if (!filter.empty()) sel = &filter_sel;
+    else if (snap->dead > 0) sel = &live_sel;
+
+    // Exact scan of the delta. Each task scores every query over a row range (four queries share
+    // each row load); splitting by rows lets a lone query over a large exact-phase delta use every core.
+    std::vector<exact::TopK> heaps(n, exact::TopK(k));
+    if (snap->delta_size > 0) {
+        std::vector<std::tuple<const exact::ExactMatrix*, size_t, size_t>> tasks;
+        for (const auto& chunk : snap->delta) {
+            for (size_t r = 0; r < chunk->size(); r += kScanTaskRows) {
+                tasks.emplace_back(chunk.get(), r, std::min(chunk->size(), r + kScanTaskRows));
+            }
+        }
+        #pragma omp parallel if (tasks.size() > 1)
+        {
+            std::vector<exact::TopK> local(n, exact::TopK(k));
+            #pragma omp for schedule(dynamic) nowait
+            for (long t = 0; t < (long)tasks.size(); ++t) {
+                const auto& [chunk, row_begin, row_end] = tasks[t];
+                chunk->scan(query_block.data(), n, sel, local.data(), row_begin, row_end);
+            }
+            #pragma omp critical
+            for (size_t q = 0; q < n; ++q) heaps[q].merge(local[q]);
+        }
+    }
+
+    // Segments are independent: a lone query searches them side by side. A larger batch already
+    // keeps FAISS's OpenMP pool busy across its queries, so the segments then run one after another.
+    const auto& segments = snap->segments;
+    const size_t n_seg = segments.size();
+    const size_t stride = n * k; // One n x k result block per segment
+    std::vector<float> scores(n_seg * stride);
+    std::vector<faiss::idx_t> indices(n_seg * stride, -1);
+    auto search_segments = [&](int ef, int nprobe) {
+        std::fill(indices.begin(), indices.end(), -1);
+        #pragma omp parallel for schedule(dynamic) if (n_seg > 1 && n < n_seg)
+        for (long s = 0; s < (long)n_seg; ++s) {
+            const faiss::IndexIDMap2& seg = *segments[s];
+            if (seg.ntotal == 0) continue;
+            auto seg_params = make_search_params(seg.index, k, ef, nprobe, sel);
+            seg.search((faiss::idx_t)n, query_block.data(), k, scores.data() + s * stride,
+                       indices.data() + s * stride, seg_params.get());
+        }
+    };
+
+    int ef = params.ef > 0 ? params.ef : config_.ef_search;
+    int nprobe = params.nprobe > 0 ? params.nprobe : config_.ivf_nprobe;
+    auto round_start = std::chrono::steady_clock::now();
+    search_segments(ef, nprobe);
 
-    if (index_->ntotal == 0 || nodes_list_.empty()) return {};
-    
-    std::vector<float> query_copy = query_vector;
-    faiss::fvec_renorm_L2(dimension_, 1, query_copy.data());
+    // ⏱️ Adaptive: widen the walk until every query's top-k id set repeats. The delta is exact,
+    // so only approximate segments (HNSW / IVF) are re-searched. The next round is assumed to
+    // cost about twice the last one, and it only starts if that still fits the budget.
+    bool approximate = std::any_of(segments.begin(), segments.end(), [](const auto& seg) {
+        return dynamic_cast<const faiss::IndexHNSW*>(seg->index) || dynamic_cast<const faiss::IndexIVF*>(seg->index);
+    });
+    if (params.is_adaptive() && approximate) {
+        auto top_ids = [&]() {
+            std::vector<std::vector<long>> ids(n);
+            for (size_t q = 0; q < n; ++q) {
+                exact::TopK merged = heaps[q];
+                for (size_t s = 0; s < n_seg; ++s) {
+                    for (int i = 0; i < k; ++i) {
+                        size_t at = s * stride + q * k + i;
+                        if (indices[at] != -1) merged.push(scores[at], (long)indices[at]);
+                    }
+                }
+                for (const auto& hit : merged.take_sorted()) ids[q].push_back(hit.second);
+                std::sort(ids[q].begin(), ids[q].end());
+            }
+            return ids;
+        };
+        auto previous = top_ids();
+        int rounds = 1;
+        while (std::max(ef, k) < kMaxAdaptiveEf) {
+            auto now = std::chrono::steady_clock::now();
+            if (params.time_budget_us > 0) {
+                auto elapsed = std::chrono::duration_cast<std::chrono::microseconds>(now - started).count();
+                auto last_round = std::chrono::duration_cast<std::chrono::microseconds>(now - round_start).count();
+                if (elapsed + 2 * last_round > params.time_budget_us) break;
+            }
+            ef = std::min(std::max(ef, k) * 2, kMaxAdaptiveEf);
+            nprobe *= 2;
+            round_start = now;
+            search_segments(ef, nprobe);
+            rounds++;
+
+            auto ids = top_ids();
+            bool stable = ids == previous;
+            previous = std::move(ids);
+            if (stable) break;
+        }
+        spdlog::debug("⏱️ Adaptive search settled at ef={} nprobe={} after {} rounds", ef, nprobe, rounds);
+    }
 
-    std::vector<float> scores(k);
-    std::vector<faiss::idx_t> indices(k);
+    // Merge each query's per-segment hits into its delta top-k
+    #pragma omp parallel for schedule(dynamic) if (n > 1 && !filter.empty())
+    for (long q = 0; q < (long)n; ++q) {
+        const float* query = query_block.data() + q * d;
+        for (size_t s = 0; s < n_seg; ++s) {
+            for (int i = 0; i < k; ++i) {
+                size_t at = s * stride + q * k + i;
+                if (indices[at] != -1) heaps[q].push(scores[at], (long)indices[at]);
+            }
+        }
+        auto hits = heaps[q].take_sorted();
 
-    index_->search(1, query_copy.data(), k, scores.data(), indices.data());
+        auto& out = results[q];
+        out.reserve(hits.size());
+        for (const auto& [score, id] : hits) {
+            // 🛡️ CRITICAL FIX: Ensure the ID returned by FAISS exists in our mapping
+            if (const auto* node = snap->nodes.slot(id)) {
+                out.push_back({*node, score, id});
+            }
+        }
 
-    std::vector<FaissSearchResult> results;
-    for (int i = 0; i < k; ++i) {
-        if (indices[i] == -1) continue;
-        
-        // 🛡️ CRITICAL FIX: Ensure the ID returned by FAISS exists in our mapping
-        if (id_to_node_map_.count(indices[i])) {
-            results.push_back({id_to_node_map_[indices[i]], scores[i]});
+        // A very selective filter can starve the HNSW candidate queue (ef bounds the walk):
+        // fall back to scoring the matching set exactly
+        if (!filter.empty() && (int)out.size() < k) {
+            exact_filtered_search(*snap, query, k, filter, out);
         }
     }
     return results;
 }
 
+void FaissVectorStore::exact_filtered_search(const Snapshot& snap, const float* query, int k, const VectorFilter& filter,
+                                             std::vector<FaissSearchResult>& results) const {
+    // Candidates: the smallest id set the filter names, else every live vector
+    std::vector<long> candidates;
+    const std::unordered_set<long>* smallest = nullptr;
+    for (const auto* set : filter.all_of) {
+        if (!smallest || set->size() < smallest->size()) smallest = set;
+    }
+    size_t any_total = 0;
+    for (const auto* set : filter.any_of) any_total += set->size();
+
+    if (smallest && (filter.any_of.empty() || smallest->size() <= any_total)) {
+        candidates.assign(smallest->begin(), smallest->end());
+    } else if (!filter.any_of.empty()) {
+        candidates.reserve(any_total);
+        for (const auto* set : filter.any_of) candidates.insert(candidates.end(), set->begin(), set->end());
+        std::sort(candidates.begin(), candidates.end());
+        candidates.erase(std::unique(candidates.begin(), candidates.end()), candidates.end());
+    } else {
+        candidates.reserve(snap.live);
+        snap.nodes.for_each([&](long id, const std::shared_ptr<CodeNode>&) { candidates.push_back(id); });
+    }
+
+    std::vector<std::pair<float, long>> scored;
+    std::vector<float> vec(dimension_);
+    for (long id : candidates) {
+        const CodeNode* node = snap.nodes.get(id);
+        if (!node || !filter_matches(filter, id, node)) continue;
+        reconstruct(snap, id, vec.data());
+        scored.emplace_back(faiss::fvec_L2sqr(query, vec.data(), dimension_), id);
+    }
+
+    size_t top = std::min(scored.size(), (size_t)k);
+    std::partial_sort(scored.begin(), scored.begin() + top, scored.end());
+
+    results.clear();
+    for (size_t i = 0; i < top; ++i) {
+        results.push_back({*snap.nodes.slot(scored[i].second), scored[i].first, scored[i].second});
+    }
+}
+
+void FaissVectorStore::reconcile_layout_locked(const Snapshot& snap) {
+    // NO LOCK HERE - caller must hold write_mutex_
+    for (const auto& seg : snap.segments) {
+        IndexMode on_disk = detect_mode(seg->index);
+        bool staging = config_.mode == IndexMode::IVF_PQ && on_disk == IndexMode::FLAT;
+        if (on_disk != config_.mode && !staging) {
+            spdlog::info("🗜️ Index on disk is {}, config wants {}: rebuilding in background",
+                         index_mode_name(on_disk), index_mode_name(config_.mode));
+            rebuild_pending_ = true;
+            break;
+        }
+    }
+    maybe_schedule_compaction(snap);
+}
+
+bool FaissVectorStore::exact_phase(const Snapshot& snap) const {
+    // Small stores never build a segment: the first fold past the threshold switches to `mode`
+    return snap.segments.empty() && snap.physical() <= config_.exact_max_vectors;
+}
+
+bool FaissVectorStore::needs_rebuild_locked(const Snapshot& snap) const {
+    // NO LOCK HERE - caller must hold write_mutex_
+    // True when every segment must be rebuilt into one from live vectors, rather than folded or merged
+    if (rebuild_pending_) return true;
+    if (exact_phase(snap)) return false; // Dead delta rows are reclaimed by coalescing instead
+
+    size_t dead = tombstones_.size();
+    if (dead >= kCompactionMinTombstones && (double)dead >= (double)snap.physical() * kCompactionRatio) return true;
+
+    // IVF-PQ graduates from flat staging once there is a big enough training sample.
+    // Small segments may stay flat (merges train them as they grow); the largest one may not.
+    if (config_.mode == IndexMode::IVF_PQ && snap.live >= kIvfPqMinTrain) {
+        return snap.segments.empty() || !dynamic_cast<const faiss::IndexIVF*>(snap.segments.front()->index);
+    }
+    return false;
+}
+
+void FaissVectorStore::maybe_schedule_compaction(const Snapshot& snap) {
+    // NO LOCK HERE - caller must hold write_mutex_
+    auto [from, to] = plan_merge(snap.segments);
+    bool fold = snap.delta_size >= kDeltaFoldVectors && !exact_phase(snap);
+    if (!fold && to == from && !needs_rebuild_locked(snap)) return;
+
+    bool expected = false;
+    if (!compacting_.compare_exchange_strong(expected, true)) return;
+
+    // The previous worker cleared the flag on its way out, so this join is immediate
+    if (compaction_thread_.joinable()) compaction_thread_.join();
+    compaction_thread_ = std::thread([this]() { compact(); });
+}
+
+void FaissVectorStore::compact() {
+    enum class Job { FOLD, MERGE, REBUILD };
+    static constexpr const char* kJobNames[] = {"Delta Fold", "Segment Merge", "Compaction"};
+
+    while (true) {
+        auto start = std::chrono::high_resolution_clock::now();
+
+        std::shared_ptr<const Snapshot> snap;
+        std::vector<long> dropped; // Dead at the pin and physically left out of the new segment
+        long watermark = 0;
+        long epoch = 0;
+        Job job = Job::FOLD;
+        size_t from = 0, to = 0;
+
+        // 1. Pin the version to work on; writers keep publishing newer ones meanwhile.
+        // The idle check shares write_mutex_ with maybe_schedule_compaction, so no wake-up is lost.
+        {
+            std::lock_guard<std::mutex> lock(write_mutex_);
+            snap = current();
+            watermark = next_id_;
+            epoch = index_epoch_;
+            std::tie(from, to) = plan_merge(snap->segments);
+
+            if (needs_rebuild_locked(*snap)) {
+                job = Job::REBUILD;
+                dropped.assign(tombstones_.begin(), tombstones_.end());
+            } else if (snap->delta_size >= kDeltaFoldVectors && !exact_phase(*snap)) {
+                job = Job::FOLD;
+            } else if (to > from) {
+                job = Job::MERGE;
+            } else {
+                compacting_ = false;
+                return;
+            }
+        }
+
+        // 2. Build the new segment without holding any lock
+        std::vector<long> ids;
+        std::vector<float> vecs;
+        if (job == Job::FOLD) {
+            // Delta vectors are already normalized: decode the rows, no reconstruction needed
+            ids.reserve(snap->delta_size);
+            vecs.reserve(snap->delta_size * dimension_);
+            for (const auto& chunk : snap->delta) {
+                for (size_t i = 0; i < chunk->size(); ++i) {
+                    long id = chunk->ids()[i];
+                    if (!snap->nodes.get(id)) {
+                        dropped.push_back(id);
+                        continue;
+                    }
+                    ids.push_back(id);
+                    vecs.resize(ids.size() * dimension_);
+                    chunk->decode_row(i, vecs.data() + (ids.size() - 1) * dimension_);
+                }
+            }
+        } else {
+            std::lock_guard<std::mutex> persist(persist_mutex_);
+            if (job == Job::REBUILD) {
+                // Every live vector, wherever it sits (drops tombstones, retrains quantizers)
+                ids.reserve(snap->live);
+                snap->nodes.for_each([&](long id, const std::shared_ptr<CodeNode>&) { ids.push_back(id); });
+            } else {
+                for (size_t s = from; s < to; ++s) {
+                    for (faiss::idx_t id : snap->segments[s]->id_map) {
+                        if (snap->nodes.get((long)id)) ids.push_back((long)id);
+                        else dropped.push_back((long)id);
+                    }
+                }
+            }
+            vecs.resize(ids.size() * dimension_);
+            for (size_t i = 0; i < ids.size(); ++i) {
+                vector_of_locked(*snap, ids[i], vecs.data() + i * dimension_);
+            }
+        }
+        std::shared_ptr<const faiss::IndexIDMap2> fresh = build_segment(ids, vecs);
+
+        // 3. Publish. Only this worker (or load(), which bumps the epoch) changes segments,
+        // so the pinned segment list is still the live one.
+        {
+            std::lock_guard<std::mutex> lock(write_mutex_);
+            if (epoch != index_epoch_) {
+                spdlog::warn("🧹 {} discarded: index was replaced while rebuilding.", kJobNames[(int)job]);
+                continue;
+            }
+
+            auto next = std::make_shared<Snapshot>(*current());
+            auto& segs = next->segments;
+            if (job == Job::MERGE) {
+                segs.erase(segs.begin() + from, segs.begin() + to);
+                if (fresh) segs.insert(segs.begin() + from, std::move(fresh));
+            } else {
+                if (job == Job::REBUILD) segs.clear();
+                if (fresh) segs.push_back(std::move(fresh));
+
+                // Ids below the watermark now live in the new segment, newer chunks stay in the delta
+                std::vector<std::shared_ptr<const exact::ExactMatrix>> kept;
+                size_t kept_size = 0;
+                for (const auto& chunk : next->delta) {
+                    const auto& chunk_ids = chunk->ids();
+                    auto cut = std::lower_bound(chunk_ids.begin(), chunk_ids.end(), watermark);
+                    if (cut == chunk_ids.end()) continue;
+                    if (cut == chunk_ids.begin()) {
+                        kept.push_back(chunk);
+                    } else {
+                        // A coalesced chunk can straddle the watermark
+                        auto tail = make_chunk();
+                        tail->reserve(chunk_ids.end() - cut);
+                        for (size_t r = cut - chunk_ids.begin(); r < chunk->size(); ++r) tail->append_row(*chunk, r);
+                        kept.push_back(std::move(tail));
+                    }
+                    kept_size += kept.back()->size();
+                }
+                next->delta = std::move(kept);
+                next->delta_size = kept_size;
+            }
+
+            // Vectors already dead at the pin were left out; later deaths stay tombstoned
+            size_t reclaimed = 0;
+            for (long id : dropped) reclaimed += tombstones_.erase(id);
+            if (job == Job::REBUILD) rebuild_pending_ = false;
+            publish_locked(next);
+
+            double ms = std::chrono::duration<double, std::milli>(std::chrono::high_resolution_clock::now() - start).count();
+            spdlog::info("🧹 Index {} ({}): {} vectors into a new segment, reclaimed {} tombstones, {} segments in {:.2f} ms",
+                         kJobNames[(int)job], index_mode_name(config_.mode), ids.size(), reclaimed, segs.size(), ms);
+        }
+    }
+}
+
 void FaissVectorStore::save(const std::string& path) const {
-    std::shared_lock lock(rw_mutex_); 
+    std::shared_ptr<const Snapshot> snap;
+    long next_id = 0;
+    std::vector<int64_t> dead;
+    {
+        std::lock_guard<std::mutex> lock(write_mutex_);
+        snap = current();
+        next_id = next_id_;
+        // Only segments go to disk: delta vectors are restored from nodes.bin rows
+        for (long id : tombstones_) {
+            for (const auto& seg : snap->segments) {
+                if (seg->rev_map.count(id)) {
+                    dead.push_back(id);
+                    break;
+                }
+            }
+        }
+    }
+    std::lock_guard<std::mutex> persist(persist_mutex_);
 
     fs::path dir(path);
     fs::create_directories(dir);
 
-    // Use .get() to pass raw pointer to FAISS function
-    faiss::write_index(index_.get(), (dir / "faiss.index").string().c_str());
+    // One file per segment. Stale higher-numbered files go first so a reload never mixes generations.
+    size_t n_files = std::max<size_t>(snap->segments.size(), 1);
+    std::error_code stale_ec;
+    for (size_t i = n_files; fs::exists(segment_file(dir, i)); ++i) fs::remove(segment_file(dir, i), stale_ec);
+    if (snap->segments.empty()) {
+        auto empty = make_index();
+        write_segment(empty.get(), segment_file(dir, 0));
+    }
+    for (size_t i = 0; i < snap->segments.size(); ++i) {
+        write_segment(snap->segments[i].get(), segment_file(dir, i));
+    }
+
+    node_store::Writer writer(node_store::Kind::CODE_NODES, dimension_);
+    writer.set_next_id(next_id);
+    writer.set_longs(std::move(dead));
+
+    std::string file = (dir / "nodes.bin").string();
+    bool same_file = mapped_path_ == file;
+
+    std::unordered_map<long, int64_t> rows;
+    rows.reserve(snap->live);
+    std::vector<float> decoded(dimension_);
+    snap->nodes.for_each([&](long faiss_id, const std::shared_ptr<CodeNode>& node) {
+        std::span<const float> vec = node->embedding;
+        if (vec.empty() && mapped_) {
+            auto it = mapped_row_.find(faiss_id);
+            if (it != mapped_row_.end()) vec = mapped_->embedding(it->second);
+        }
+        if (vec.empty()) {
+            // keep_node_embeddings=false and never saved: the index holds the only copy
+            reconstruct(*snap, faiss_id, decoded.data());
+            vec = decoded;
+        }
+        int64_t row = writer.add_code_node(*node, faiss_id, vec);
+        if (row >= 0) rows[faiss_id] = row;
+    });
 
-    json metadata = json::array();
-    for(const auto& node : nodes_list_){
-        metadata.push_back(node->to_json());
+    if (!writer.write_tmp(file)) {
+        spdlog::error("⚠️ Failed to write node store {}", file);
+        return;
     }
 
-    std::ofstream meta_file(dir / "metadata.json");
-    meta_file << metadata.dump(2);
+    // Windows cannot replace a mapped file, so let go of the old mapping first
+    if (same_file) mapped_.reset();
+    if (!node_store::Writer::commit(file)) {
+        if (same_file) {
+            mapped_ = std::make_unique<node_store::Reader>();
+            if (!mapped_->open(file, node_store::Kind::CODE_NODES)) mapped_.reset();
+        }
+        return;
+    }
+
+    std::error_code ec;
+    fs::remove(dir / "metadata.json", ec); // Superseded by nodes.bin
+
+    // 🔗 The graph of exactly these nodes, stamped with next_id so load() can tell it belongs to this nodes.bin
+    auto refs = snap->refs && snap->refs_epoch == snap->node_epoch ? snap->refs : link_snapshot(*snap);
+    if (!refs->save((dir / "refs.bin").string(), next_id)) {
+        spdlog::error("⚠️ Failed to write reference graph {}", (dir / "refs.bin").string());
+    }
+
+    if (same_file) {
+        // Rows now refer to the file just written
+        mapped_ = std::make_unique<node_store::Reader>();
+        if (mapped_->open(file, node_store::Kind::CODE_NODES)) {
+            mapped_row_ = std::move(rows);
+        } else {
+            mapped_.reset();
+        }
+    }
 }
 
 void FaissVectorStore::load(const std::string& path) {
-    std::unique_lock lock(rw_mutex_);
+    std::lock_guard<std::mutex> lock(write_mutex_);
+    std::lock_guard<std::mutex> persist(persist_mutex_);
 
     fs::path dir(path);
-    
-    // reset() deletes the old index and takes ownership of the new one
-    faiss::Index* raw_index = faiss::read_index((dir / "faiss.index").string().c_str());
-    index_.reset(raw_index);
-    
-    std::ifstream meta_file(dir / "metadata.json");
-    json metadata = json::parse(meta_file);
-    
-    nodes_list_.clear();
-    id_to_node_map_.clear();
+    auto started = std::chrono::steady_clock::now();
+
+    std::unique_ptr<faiss::Index> raw_index(read_segment(segment_file(dir, 0), config_));
+
+    // Searches already in flight finish on the version they pinned
+    auto next = std::make_shared<Snapshot>();
+    next->node_epoch = current()->node_epoch + 1; // Epochs never repeat, so no older graph can be published over this one
+    next->refs_epoch = next->node_epoch;
     name_to_id_map_.clear();
-    
-    for (const auto& j_node : metadata) {
-        nodes_list_.push_back(std::make_shared<CodeNode>(CodeNode::from_json(j_node)));
+    tombstones_.clear();
+    mapped_.reset();
+    mapped_row_.clear();
+    index_epoch_++;
+    rebuild_pending_ = false;
+
+    auto adopt_node = [&](long id, std::shared_ptr<CodeNode> node) {
+        if (name_to_id_map_.count(node->id)) drop_node_locked(*next, node->id);
+        name_to_id_map_[node->id] = id;
+        next->nodes.set(id, std::move(node));
+        next->live++;
+    };
+
+    fs::path bin_path = dir / "nodes.bin";
+    if (fs::exists(bin_path)) {
+        auto* id_map = dynamic_cast<faiss::IndexIDMap2*>(raw_index.get());
+        auto reader = std::make_unique<node_store::Reader>();
+        if (!id_map || !reader->open(bin_path.string(), node_store::Kind::CODE_NODES)) {
+            throw std::runtime_error("unreadable node store " + bin_path.string());
+        }
+        raw_index.release();
+        if (id_map->ntotal > 0) next->segments.emplace_back(id_map);
+        else delete id_map;
+        for (size_t s = 1; fs::exists(segment_file(dir, s)); ++s) {
+            std::unique_ptr<faiss::Index> raw_seg(read_segment(segment_file(dir, s), config_));
+            auto* seg = dynamic_cast<faiss::IndexIDMap2*>(raw_seg.get());
+            if (!seg) throw std::runtime_error("unreadable index segment " + segment_file(dir, s).string());
+            raw_seg.release();
+            next->segments.emplace_back(seg);
+        }
+        auto in_segments = [&](long id) {
+            for (const auto& seg : next->segments) {
+                if (seg->rev_map.count(id)) return true;
+            }
+            return false;
+        };
+        next_id_ = reader->next_id();
+        for (int64_t id : reader->longs()) tombstones_.insert((long)id);
+
+        // No JSON DOM, no embedding copies: strings are copied once out of the mapping.
+        // Nodes saved while still in the delta have no vector in any segment: re-stage their rows.
+        // A project small enough for the exact engine re-stages every row and drops its segments.
+        bool demote = !next->segments.empty() && reader->size() <= config_.exact_max_vectors;
+        bool segment_used = false;
+        std::vector<std::pair<long, std::span<const float>>> staged;
+        for (size_t i = 0; i < reader->size(); ++i) {
+            const auto& rec = reader->code_record(i);
+            if (rec.faiss_id < 0) continue;
+            long id = (long)rec.faiss_id;
+            auto vec = reader->embedding(rec.embedding_row);
+            bool has_row = vec.size() == (size_t)dimension_;
+            bool indexed = in_segments(id) && !(demote && has_row);
+            if (!indexed && !has_row) continue;
+
+            if (rec.embedding_row >= 0) mapped_row_[id] = rec.embedding_row;
+            adopt_node(id, std::make_shared<CodeNode>(reader->to_code_node(i, false)));
+            if (!indexed) staged.emplace_back(id, vec);
+            segment_used |= indexed;
+        }
+        if (demote && !segment_used) {
+            spdlog::info("🎯 {} vectors fit the exact engine: dropping {} index segment(s)", staged.size(), next->segments.size());
+            next->segments.clear();
+            for (int64_t id : reader->longs()) tombstones_.erase((long)id); // Masked ids inside the dropped segments
+        }
+
+        if (!staged.empty()) {
+            std::sort(staged.begin(), staged.end(), [](const auto& a, const auto& b) { return a.first < b.first; });
+            auto chunk = make_chunk();
+            chunk->reserve(staged.size());
+            std::vector<float> unit(dimension_);
+            for (const auto& [id, vec] : staged) {
+                std::copy(vec.begin(), vec.end(), unit.begin());
+                faiss::fvec_renorm_L2(dimension_, 1, unit.data());
+                chunk->append(id, unit.data());
+            }
+            next->delta_size = chunk->size();
+            next->delta.push_back(std::move(chunk));
+        }
+        // A refs.bin from another generation of nodes.bin (or none at all) is relinked before publishing
+        int64_t stamp = -1;
+        next->refs = ReferenceGraph::load((dir / "refs.bin").string(), stamp);
+        if (!next->refs || stamp != reader->next_id() || next->refs->size() != next->live) next->refs = link_snapshot(*next);
+        mapped_ = std::move(reader);
+        mapped_path_ = bin_path.string();
+
+        publish_locked(next);
+        reconcile_layout_locked(*next);
+        double ms = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - started).count();
+        spdlog::info("✅ Loaded FAISS index with {} nodes ({} tombstones, {} staged, {} segments) from {} in {:.1f} ms",
+                     next->live, tombstones_.size(), next->delta_size, next->segments.size(), path, ms);
+        return;
     }
 
-    for (long i = 0; i < nodes_list_.size(); ++i) {
-        id_to_node_map_[i] = nodes_list_[i];
-        name_to_id_map_[nodes_list_[i]->id] = i;
+    // 🔄 Pre-binary layouts: parse metadata.json once; the next save() rewrites it as nodes.bin
+    std::ifstream meta_file(dir / "metadata.json");
+    json metadata = json::parse(meta_file);
+    mapped_path_ = bin_path.string();
+
+    if (auto* id_map = dynamic_cast<faiss::IndexIDMap2*>(raw_index.get())) {
+        // Format 2: ids are stored explicitly next to each node
+        raw_index.release();
+        next->segments.emplace_back(id_map);
+        next_id_ = metadata.value("next_id", 0L);
+        for (long id : metadata.value("tombstones", std::vector<long>{})) tombstones_.insert(id);
+
+        for (const auto& j_node : metadata["nodes"]) {
+            long id = j_node.value("faiss_id", -1L);
+            if (id < 0) continue;
+            adopt_node(id, std::make_shared<CodeNode>(CodeNode::from_json(j_node)));
+        }
+    } else {
+        // 🔄 Legacy layout: bare HNSW + positional metadata array. Position i == FAISS id i.
+        // IndexIDMap2 refuses non-empty inputs, so adopt the trained graph by hand instead of rebuilding it.
+        auto adopted = make_index();
+        delete adopted->index;
+        adopted->index = raw_index.release();
+        adopted->ntotal = adopted->index->ntotal;
+        adopted->id_map.resize(adopted->ntotal);
+        std::iota(adopted->id_map.begin(), adopted->id_map.end(), 0);
+        adopted->construct_rev_map();
+        next_id_ = adopted->ntotal;
+        spdlog::info("🔄 Migrated legacy FAISS index to stable ids ({} vectors)", adopted->ntotal);
+        next->segments.emplace_back(std::move(adopted));
+
+        const json& legacy_nodes = metadata.is_array() ? metadata : metadata["nodes"];
+        long i = 0;
+        for (const auto& j_node : legacy_nodes) {
+            adopt_node(i++, std::make_shared<CodeNode>(CodeNode::from_json(j_node)));
+        }
     }
-    spdlog::info("✅ Loaded FAISS index with {} nodes from {}", index_->ntotal, path);
+
+    next->refs = link_snapshot(*next);
+    publish_locked(next);
+    reconcile_layout_locked(*next);
+
+    spdlog::info("✅ Loaded FAISS index with {} nodes ({} tombstones) from {}", next->live, tombstones_.size(), path);
+}
+
+size_t FaissVectorStore::index_bytes() const {
+    auto snap = current();
+    faiss::VectorIOWriter writer;
+    for (const auto& seg : snap->segments) faiss::write_index(seg.get(), &writer);
+    size_t bytes = writer.data.size();
+    for (const auto& chunk : snap->delta) bytes += chunk->bytes();
+    return bytes;
+}
+
+IndexMode FaissVectorStore::index_mode() const {
+    auto snap = current();
+    if (snap->segments.empty()) return IndexMode::FLAT; // Exact phase: everything is in the scanned delta
+    return detect_mode(snap->segments.front()->index);
+}
+
+std::vector<std::shared_ptr<CodeNode>> FaissVectorStore::get_all_nodes() const {
+    auto snap = current();
+    std::vector<std::shared_ptr<CodeNode>> nodes;
+    nodes.reserve(snap->live);
+    snap->nodes.for_each([&](long, const std::shared_ptr<CodeNode>& node) { nodes.push_back(node); });
+    return nodes;
 }
 
-const std::vector<std::shared_ptr<CodeNode>>& FaissVectorStore::get_all_nodes() const {
-    return nodes_list_;
+size_t FaissVectorStore::size() const {
+    return current()->live;
+}
+
+size_t FaissVectorStore::delta_size() const {
+    return current()->delta_size;
+}
+
+size_t FaissVectorStore::segment_count() const {
+    return current()->segments.size();
+}
+
+bool FaissVectorStore::compacting() const {
+    return compacting_.load();
 }
 
 std::shared_ptr<CodeNode> FaissVectorStore::get_node_by_name(const std::string& name) const {
-    std::shared_lock lock(rw_mutex_);
-    
+    std::lock_guard<std::mutex> lock(write_mutex_);
+
     auto it = name_to_id_map_.find(name);
     if (it != name_to_id_map_.end()) {
-        auto node_it = id_to_node_map_.find(it->second);
-        if (node_it != id_to_node_map_.end()) {
-            return node_it->second;
+        if (const auto* node = current()->nodes.slot(it->second)) {
+            return *node;
         }
     }
     return nullptr;
 }
 
-} // namespace code_assistance
\ No newline at end of file
+std::shared_ptr<CodeNode> FaissVectorStore::get_node(long faiss_id) const {
+    if (const auto* node = current()->nodes.slot(faiss_id)) return *node;
+    return nullptr;
+}
+
+std::shared_ptr<const ReferenceGraph> FaissVectorStore::reference_graph() const {
+    return current()->refs;
+}
+
+void FaissVectorStore::link_references() {
+    std::lock_guard<std::mutex> linking(link_mutex_);
+    auto snap = current();
+    if (snap->refs && snap->refs_epoch == snap->node_epoch) return;
+
+    // Linked from a pinned version with no write lock held: writers and searches keep going
+    auto graph = link_snapshot(*snap);
+
+    std::lock_guard<std::mutex> lock(write_mutex_);
+    if (current()->refs && current()->refs_epoch >= snap->node_epoch) return; // load() got there first
+    auto next = std::make_shared<Snapshot>(*current());
+    next->refs = std::move(graph);
+    next->refs_epoch = snap->node_epoch; // Writes published meanwhile leave it stale for the next call
+    publish_locked(next);
+}
+
+std::shared_ptr<const ReferenceGraph> FaissVectorStore::link_snapshot(const Snapshot& snap) {
+    std::vector<std::pair<long, const CodeNode*>> nodes;
+    nodes.reserve(snap.live);
+    snap.nodes.for_each([&](long id, const std::shared_ptr<CodeNode>& node) { nodes.emplace_back(id, node.get()); });
+    return ReferenceGraph::link(nodes);
+}
+
+long FaissVectorStore::faiss_id_of(const std::string& node_id) const {
+    std::lock_guard<std::mutex> lock(write_mutex_);
+    auto it = name_to_id_map_.find(node_id);
+    return it != name_to_id_map_.end() ? it->second : -1;
+}
+
+size_t FaissVectorStore::tombstone_count() const {
+    return current()->dead;
+}
+
+} // namespace code_assistance
@@ -15,9 +15,11 @@
 #include "LogManager.hpp"
 #include "ThreadPool.hpp"
 #include "sync_service.hpp"
+#include "sync_watcher.hpp"
 #include "SystemMonitor.hpp"
 #include "embedding_service.hpp"
 #include "faiss_vector_store.hpp"
+#include "node_store.hpp"
 
 #include "agent/SubAgent.hpp"
 #include "agent/AgentExecutor.hpp"
@@ -91,6 +93,7 @@ public:
         );
 
         setup_routes();
+        start_registered_watchers();
 
         std::thread([this]() {
             while (true) {
@@ -140,18 +143,31 @@ private:
     std::unordered_map<std::string, std::string> project_context_cache_;
     std::mutex cache_mutex_;
 
+    // One sync at a time per project: /sync/run, /sync/file and the watcher all diff the same manifest
+    std::unordered_map<std::string, std::mutex> sync_locks_;
+    std::mutex sync_locks_mutex_;
+
+    // Declared last: watchers call back into everything above, so they must stop first
+    std::unordered_map<std::string, std::unique_ptr<code_assistance::ProjectWatcher>> watchers_;
+    std::mutex watchers_mutex_;
+
     // --- HELPER METHODS (Must be inside class) ---
 
     std::shared_ptr<code_assistance::FaissVectorStore> load_vector_store(const std::string& project_id) {
         std::lock_guard<std::mutex> lock(store_mutex);
         if (project_stores_.count(project_id)) return project_stores_[project_id];
 
-        fs::path vector_path = fs::path("data") / "graphs" / project_id;
+        fs::path vector_path = code_assistance::project_graph_dir(project_id);
         if (!fs::exists(vector_path)) return nullptr;
 
         try {
-            auto store = std::make_shared<code_assistance::FaissVectorStore>(768);
+            auto index_config = code_assistance::VectorIndexConfig::from_json(
+                load_project_config(project_id).value("vector_index", json::object()));
+            auto t_start = std::chrono::steady_clock::now();
+            auto store = std::make_shared<code_assistance::FaissVectorStore>(768, index_config);
             store->load(vector_path.string());
+            code_assistance::SystemMonitor::record_index_warmup(
+                std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - t_start).count());
             project_stores_[project_id] = store;
             return store;
         } catch (...) { return nullptr; }
@@ -163,6 +179,110 @@ private:
         try { std::ifstream f(default_path); json c; f >> c; return c; } catch (...) { return json({}); }
     }
 
+    // Written beside config.json and renamed over it: a watcher or sync reading the config
+    // concurrently sees the old file or the new one, never a truncated one
+    void save_project_config(const std::string& project_id, const json& config) {
+        fs::path project_dir = fs::path("data") / project_id;
+        fs::create_directories(project_dir);
+        fs::path tmp = project_dir / "config.json.tmp";
+        {
+            std::ofstream f(tmp);
+            f << config.dump(2);
+            if (!f.flush()) throw std::runtime_error("Cannot write " + tmp.string());
+        }
+        fs::rename(tmp, project_dir / "config.json");
+    }
+
+    std::mutex& project_sync_lock(const std::string& project_id) {
+        std::lock_guard<std::mutex> lock(sync_locks_mutex_);
+        return sync_locks_[project_id];
+    }
+
+    static std::string project_store_path(const std::string& project_id, const json& config) {
+        std::string store_path = config.value("storage_path", "");
+        return store_path.empty() ? (fs::path("data") / project_id).string() : store_path;
+    }
+
+    struct ProjectFilters {
+        std::vector<std::string> ext, ign, inc;
+    };
+
+    static ProjectFilters project_filters(const json& config) {
+        ProjectFilters f;
+        f.ext = config.value("allowed_extensions", std::vector<std::string>{});
+        f.ign = config.value("ignored_paths", std::vector<std::string>{});
+        f.inc = config.value("included_paths", std::vector<std::string>{});
+
+        // Ensure defaults if empty (Backend Safety)
+        if (f.ext.empty()) f.ext = {"java", "json", "py", "cpp", "h", "ts", "js", "txt", "md"};
+        return f;
+    }
+
+    // 🚰 Feeds embedded batches into the project graph while the sync is still walking / embedding
+    code_assistance::SyncSink ingest_sink(const std::string& project_id) {
+        return [this, project_id](const code_assistance::SyncResult& partial) {
+            executor_->ingest_sync_results(project_id, partial);
+        };
+    }
+
+    // ⚡ Watch batches and /sync/file land here: parse + embed + upsert only what changed.
+    // `full` (inotify overflow) re-runs the whole manifest diff instead.
+    void run_incremental_sync(const std::string& project_id, const std::vector<std::string>& paths, bool full) {
+        auto t_start = std::chrono::high_resolution_clock::now();
+        std::lock_guard<std::mutex> lock(project_sync_lock(project_id));
+
+        json config = load_project_config(project_id);
+        std::string local_path = config.value("local_path", "");
+        if (local_path.empty()) return;
+        std::string store_path = project_store_path(project_id, config);
+        auto filters = project_filters(config);
+
+        code_assistance::SyncService sync(ai_service_);
+        auto sync_res = full
+            ? sync.perform_sync(project_id, local_path, store_path, filters.ext, filters.ign, filters.inc, ingest_sink(project_id))
+            : sync.sync_paths(project_id, local_path, store_path, filters.ext, filters.ign, filters.inc, paths, ingest_sink(project_id));
+
+        if (!sync_res.nodes.empty() || !sync_res.removed_files.empty()) {
+            executor_->ingest_sync_results(project_id, sync_res);
+        }
+        // The aggregate context only moves on full syncs (incremental ones leave it to the next /sync/run)
+        if (full || sync_res.full_rebuild) {
+            this->refresh_context_cache(project_id, store_path);
+        }
+
+        double ms = std::chrono::duration<double, std::milli>(std::chrono::high_resolution_clock::now() - t_start).count();
+        code_assistance::SystemMonitor::global_sync_latency_ms.store(ms);
+        spdlog::info("⏱️ Incremental Sync '{}' Complete in {:.2f} ms", project_id, ms);
+    }
+
+    // 👁️ (Re)starts the watcher of a project from its current config; "watch": false opts out
+    void start_watcher(const std::string& project_id) {
+        json config = load_project_config(project_id);
+        std::string local_path = config.value("local_path", "");
+
+        std::lock_guard<std::mutex> lock(watchers_mutex_);
+        watchers_.erase(project_id); // Stops the old one (and waits for its batch in flight)
+        if (local_path.empty() || !config.value("watch", true)) return;
+
+        auto filters = project_filters(config);
+        auto watcher = std::make_unique<code_assistance::ProjectWatcher>(
+            project_id, local_path, project_store_path(project_id, config),
+            code_assistance::make_filter_config(filters.ext, filters.ign, filters.inc),
+            [this, project_id](const std::vector<std::string>& paths, bool overflow) {
+                this->run_incremental_sync(project_id, paths, overflow);
+            });
+        if (watcher->start()) watchers_[project_id] = std::move(watcher);
+    }
+
+    void start_registered_watchers() {
+        std::error_code ec;
+        for (const auto& entry : fs::directory_iterator("data", ec)) {
+            if (entry.is_directory() && fs::exists(entry.path() / "config.json")) {
+                start_watcher(entry.path().filename().string());
+            }
+        }
+    }
+
     void refresh_context_cache(const std::string& project_id, const fs::path& storage_path) {
         std::lock_guard<std::mutex> lock(cache_mutex_);
         std::stringstream ss;
@@ -312,13 +432,11 @@ private:
             }
             
             // Rest of your original code...
-            fs::path project_dir = fs::path("data") / project_id;
-            fs::create_directories(project_dir);
-            
-            std::ofstream f(project_dir / "config.json");
-            f << body.dump(2);
+            save_project_config(project_id, body);
             
             spdlog::info("🛰️ Project Registered: {}", project_id);
+            // Replacing a watcher waits for its batch in flight, so it never runs on the request thread
+            thread_pool_.enqueue([this, project_id]() { start_watcher(project_id); });
             res.set_content(json{{"success", true}}.dump(), "application/json");
             
         } catch (const std::exception& e) {
@@ -346,17 +464,18 @@ private:
             
             thread_pool_.enqueue([this, project_id, store_path]() {
                 auto t_start = std::chrono::high_resolution_clock::now();
+                std::lock_guard<std::mutex> lock(project_sync_lock(project_id));
 
                 // A. Run Sync
                 json config = load_project_config(project_id);
                 code_assistance::SyncService sync(ai_service_);
                 
                 // Perform Sync
-                auto sync_res = sync.perform_sync(project_id, config.value("local_path",""), store_path, {}, {}, {});
+                auto sync_res = sync.perform_sync(project_id, config.value("local_path",""), store_path, {}, {}, {}, ingest_sink(project_id));
                 
-                // B. 🚀 UNIFIED INGESTION: Feed results to AgentExecutor's Graph
-                if (!sync_res.nodes.empty()) {
-                    executor_->ingest_sync_results(project_id, sync_res.nodes);
+                // B. 🚀 UNIFIED INGESTION: changed files streamed in during the sync; this retires removed ones
+                if (!sync_res.nodes.empty() || !sync_res.removed_files.empty()) {
+                    executor_->ingest_sync_results(project_id, sync_res);
                 }
 
                 // C. Hot-Load RAM Context (Optional now, as Graph handles retrieval)
@@ -444,6 +563,30 @@ private:
         }
     }
 
+    // 🎯 Candidates are code unless the caller asks otherwise; the filter is pushed
+    // into the index so episodic PROMPT/TOOL_CALL nodes never eat the top-k slots
+    static code_assistance::SearchFilter candidate_filter_from(const json& body) {
+        code_assistance::SearchFilter filter;
+        filter.path_prefix = body.value("path_prefix", "");
+        for (const auto& t : body.value("node_types", std::vector<std::string>{"CONTEXT_CODE"})) {
+            filter.types.push_back(code_assistance::string_to_node_type(t));
+        }
+        return filter;
+    }
+
+    static json candidates_to_json(const std::vector<code_assistance::PointerNode>& results) {
+        json candidates = json::array();
+        for (const auto& node : results) {
+            json item;
+            item["file_path"] = node.metadata.count("file_path") ? node.metadata.at("file_path") : "unknown";
+            item["name"] = node.metadata.count("node_name") ? node.metadata.at("node_name") : "anonymous";
+            item["content"] = node.content; // The code snippet
+            item["type"] = node_type_to_string(node.type);
+            candidates.push_back(item);
+        }
+        return candidates;
+    }
+
     void handle_retrieve_candidates(const httplib::Request& req, httplib::Response& res) {
         try {
             
@@ -477,19 +620,13 @@ private:
                 throw std::runtime_error("Failed to generate query embedding");
             }
 
+            auto filter = candidate_filter_from(body);
+
             // Use the PointerGraph's semantic search directly
             // This returns nodes that are guaranteed to exist in RAM
-            auto results = graph->semantic_search(query_emb, 10);
-            
-            json candidates = json::array();
-            for (const auto& node : results) {
-                json item;
-                item["file_path"] = node.metadata.count("file_path") ? node.metadata.at("file_path") : "unknown";
-                item["name"] = node.metadata.count("node_name") ? node.metadata.at("node_name") : "anonymous";
-                item["content"] = node.content; // The code snippet
-                item["type"] = node_type_to_string(node.type);
-                candidates.push_back(item);
-            }
+            // Optional "ef" / "time_budget_us" / "adaptive": ghost text asks for a tight budget
+            auto results = graph->semantic_search(query_emb, 10, filter, code_assistance::SearchParams::from_json(body));
+            json candidates = candidates_to_json(results);
 
             spdlog::info("🔎 RAG Audit: Found {} candidates for project {}", candidates.size(), project_id);
             res.set_content(json{{"candidates", candidates}}.dump(), "application/json");
@@ -506,6 +643,70 @@ private:
         }
     }
 
+    // 📚 N prompts, one round trip: one batchEmbedContents call + one multi-query index search.
+    // Response "results" is index-aligned with the request "prompts".
+    void handle_retrieve_candidates_batch(const httplib::Request& req, httplib::Response& res) {
+        static constexpr size_t kMaxBatchPrompts = 100; // batchEmbedContents request cap
+        try {
+            std::string safe_body = code_assistance::scrub_json_string(req.body);
+            nlohmann::json body = nlohmann::json::parse(safe_body, nullptr, false);
+            if (body.is_discarded()) body = nlohmann::json::parse(req.body, nullptr, false);
+
+            if (body.is_discarded() || !body.is_object()) {
+                spdlog::error("❌ JSON Error. Body length: {}", req.body.length());
+                res.status = 400;
+                res.set_content("{\"error\":\"Invalid JSON encoding\"}", "application/json");
+                return;
+            }
+
+            std::string project_id = body.value("project_id", "");
+            auto prompts = body.value("prompts", std::vector<std::string>{});
+            int k = std::clamp(body.value("k", 10), 1, 100);
+            if (prompts.empty() || prompts.size() > kMaxBatchPrompts) {
+                res.status = 400;
+                res.set_content(json{{"error", "prompts must hold 1-" + std::to_string(kMaxBatchPrompts) + " entries"}}.dump(), "application/json");
+                return;
+            }
+
+            auto t_start = std::chrono::high_resolution_clock::now();
+            auto graph = executor_->get_or_create_graph(project_id);
+
+            auto query_embs = ai_service_->generate_embeddings_batch(prompts);
+            bool all_embedded = query_embs.size() == prompts.size() &&
+                std::none_of(query_embs.begin(), query_embs.end(), [](const auto& e) { return e.empty(); });
+            if (!all_embedded) {
+                throw std::runtime_error("Failed to generate query embeddings");
+            }
+            auto t_embedded = std::chrono::high_resolution_clock::now();
+
+            auto results = graph->semantic_search_batch(query_embs, k, candidate_filter_from(body),
+                                                        code_assistance::SearchParams::from_json(body));
+            auto t_end = std::chrono::high_resolution_clock::now();
+
+            double embed_ms = std::chrono::duration<double, std::milli>(t_embedded - t_start).count();
+            double search_ms = std::chrono::duration<double, std::milli>(t_end - t_embedded).count();
+            code_assistance::SystemMonitor::global_embedding_latency_ms.store(embed_ms);
+            code_assistance::SystemMonitor::global_batch_search_latency_ms.store(search_ms);
+            code_assistance::SystemMonitor::global_batch_search_size.store((int)prompts.size());
+
+            json out = json::array();
+            size_t total = 0;
+            for (const auto& r : results) {
+                total += r.size();
+                out.push_back(json{{"candidates", candidates_to_json(r)}});
+            }
+
+            spdlog::info("🔎 RAG Audit: {} prompts -> {} candidates for project {} (embed {:.1f} ms, search {:.1f} ms)",
+                         prompts.size(), total, project_id, embed_ms, search_ms);
+            res.set_content(json{{"results", out}, {"latency_ms", embed_ms + search_ms}}.dump(), "application/json");
+
+        } catch (const std::exception& e) {
+            spdlog::error("❌ Batch Retrieval API Error: {}", e.what());
+            res.status = 500;
+            res.set_content(json{{"error", e.what()}}.dump(), "application/json");
+        }
+    }
+
     void setup_routes() {
         // --- CORS HEADERS ---
         server_.set_pre_routing_handler([](const httplib::Request&, httplib::Response& res) {
@@ -593,6 +794,7 @@ private:
         server_.Post("/sync/register/:project_id", [this](const httplib::Request& req, httplib::Response& res) { this->handle_register_project(req, res); });
         server_.Post("/generate-code-suggestion", [this](const httplib::Request& req, httplib::Response& res) { this->handle_generate_suggestion(req, res); });
         server_.Post("/retrieve-context-candidates", [this](const httplib::Request& req, httplib::Response& res) { this->handle_retrieve_candidates(req, res); });
+        server_.Post("/retrieve-context-candidates/batch", [this](const httplib::Request& req, httplib::Response& res) { this->handle_retrieve_candidates_batch(req, res); });
 
         // 3. SYNC RUN (Fixed Logic)
         server_.Post("/sync/run/:project_id", [this](const httplib::Request& req, httplib::Response& res) {
@@ -622,17 +824,21 @@ private:
                 
                 thread_pool_.enqueue([this, project_id, store_path]() {
                     auto t_start = std::chrono::high_resolution_clock::now();
+                    std::unique_lock<std::mutex> lock(project_sync_lock(project_id));
 
                     // A. Load Config
                     json config = load_project_config(project_id);
+
+                    // The watcher must skip this directory, so it is remembered in the project config
+                    bool storage_moved = false;
+                    if (config.value("storage_path", "") != store_path) {
+                        config["storage_path"] = store_path;
+                        save_project_config(project_id, config);
+                        storage_moved = true;
+                    }
                     
                     // 🚀 EXTRACT LISTS (FIXED PART)
-                    std::vector<std::string> ext = config.value("allowed_extensions", std::vector<std::string>{});
-                    std::vector<std::string> ign = config.value("ignored_paths", std::vector<std::string>{});
-                    std::vector<std::string> inc = config.value("included_paths", std::vector<std::string>{});
-
-                    // Ensure defaults if empty (Backend Safety)
-                    if (ext.empty()) ext = {"java", "json", "py", "cpp", "h", "ts", "js", "txt", "md"};
+                    auto filters = project_filters(config);
                     
                     code_assistance::SyncService sync(ai_service_);
                     
@@ -641,14 +847,15 @@ private:
                         project_id, 
                         config.value("local_path", ""), 
                         store_path, 
-                        ext, 
-                        ign, 
-                        inc
+                        filters.ext, 
+                        filters.ign, 
+                        filters.inc,
+                        ingest_sink(project_id)
                     );
                     
-                    // B. Unified Ingestion
-                    if (!sync_res.nodes.empty()) {
-                        executor_->ingest_sync_results(project_id, sync_res.nodes);
+                    // B. Unified Ingestion (removals + stale files; changed ones already streamed in)
+                    if (!sync_res.nodes.empty() || !sync_res.removed_files.empty()) {
+                        executor_->ingest_sync_results(project_id, sync_res);
                     }
 
                     // C. Hot-Load RAM Context
@@ -658,6 +865,9 @@ private:
                     double ms = std::chrono::duration<double, std::milli>(t_end - t_start).count();
                     code_assistance::SystemMonitor::global_sync_latency_ms.store(ms);
                     spdlog::info("⏱️ Sync Complete in {:.2f} ms", ms);
+
+                    lock.unlock(); // A stopping watcher may be waiting on this lock
+                    if (storage_moved) this->start_watcher(project_id);
                 });
 
                 res.set_content(json{{"success", true}}.dump(), "application/json");
@@ -689,11 +899,11 @@ private:
 
                 std::string rel_path = body.value("file_path", "");
                 
-                if (rel_path.find(".study_assistant") == std::string::npos) {
-                    fs::path default_store = fs::path("data") / project_id;
-                    thread_pool_.enqueue([this, project_id, default_store]() {
-                        std::this_thread::sleep_for(std::chrono::milliseconds(200)); // Debounce
-                        this->refresh_context_cache(project_id, default_store);
+                // Watched projects already picked the save up; re-running it here is a hash compare and no-op
+                if (!rel_path.empty() && rel_path.find(".study_assistant") == std::string::npos) {
+                    std::replace(rel_path.begin(), rel_path.end(), '\\', '/');
+                    thread_pool_.enqueue([this, project_id, rel_path]() {
+                        this->run_incremental_sync(project_id, {rel_path}, false);
                     });
                 }
                 res.set_content(json{{"status", "queued"}}.dump(), "application/json");
@@ -714,7 +924,20 @@ private:
                 {"cache_size_mb", m.cache_size_mb},
                 {"llm_latency", m.llm_generation_ms},
                 {"tps", m.tokens_per_second},
-                {"vector_latency", m.vector_latency_ms}
+                {"vector_latency", m.vector_latency_ms},
+                {"batch_search_latency", m.batch_search_latency_ms},
+                {"batch_search_size", m.batch_search_size},
+                {"startup_ms", m.startup_ms},
+                {"index_warmup_max_ms", m.index_warmup_max_ms}
+            };
+            auto cache = ai_service_->embedding_cache_stats();
+            uint64_t lookups = cache.hits + cache.misses;
+            payload["metrics"]["embedding_cache"] = {
+                {"hits", cache.hits},
+                {"misses", cache.misses},
+                {"hit_rate", lookups ? (double)cache.hits / (double)lookups : 0.0},
+                {"entries", cache.entries},
+                {"size_mb", (double)cache.bytes / (1024.0 * 1024.0)}
             };
             payload["logs"] = logs;
             payload["agent_traces"] = traces;
@@ -726,15 +949,14 @@ private:
         server_.Get("/api/admin/graph/:project_id", [this](const httplib::Request& req, httplib::Response& res) {
             std::string project_id = req.path_params.at("project_id");
             
-            // Sanitize ID (same logic as AgentExecutor)
-            std::string safe_id = project_id;
-            std::replace(safe_id.begin(), safe_id.end(), ':', '_');
-            std::replace(safe_id.begin(), safe_id.end(), '/', '_');
-            std::replace(safe_id.begin(), safe_id.end(), '\\', '_');
-            
-            fs::path graph_path = fs::path("data/graphs") / safe_id / "graph.json";
+            fs::path graph_dir = code_assistance::project_graph_dir(project_id);
+            fs::path bin_path = graph_dir / "graph.bin";
+            fs::path graph_path = graph_dir / "graph.json";
             
-            if (fs::exists(graph_path)) {
+            // JSON only exists at this edge; the graph itself persists as graph.bin
+            if (fs::exists(bin_path)) {
+                res.set_content(code_assistance::node_store::export_pointer_nodes_json(bin_path.string()), "application/json");
+            } else if (fs::exists(graph_path)) {
                 std::ifstream f(graph_path);
                 std::stringstream buffer;
                 buffer << f.rdbuf();
@@ -755,6 +977,7 @@ void pre_flight_check() {
 }
 
 int main() {
+    auto t_start = std::chrono::steady_clock::now();
     spdlog::set_pattern("[%H:%M:%S] [%^%l%$] %v");
     
     signal(SIGINT, signal_handler);
@@ -767,6 +990,8 @@ int main() {
     // But ensuring ThreadPool destructors run (via app going out of scope) is usually enough 
     // if the server.listen() loop breaks.
     
+    code_assistance::SystemMonitor::global_startup_ms.store(
+        std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - t_start).count());
     app.run(); // This blocks
     
     return 0;
@@ -0,0 +1,289 @@
+#include "memory/GraphJournal.hpp"
+#include <array>
+#include <cstring>
+#include <fstream>
+#include <spdlog/spdlog.h>
+
+#ifdef _WIN32
+#include <io.h>
+#else
+#include <unistd.h>
+#endif
+
+namespace code_assistance {
+
+namespace fs = std::filesystem;
+
+static constexpr char kWalMagic[8] = {'S', 'F', 'W', 'A', 'L', '0', '0', '1'};
+static constexpr size_t kFlushThresholdBytes = 1 << 20; // Buffered (bulk) records spill past 1 MB
+
+// --- CRC32 (IEEE) for torn-write detection ---
+static uint32_t crc32(const char* data, size_t len) {
+    static const auto table = [] {
+        std::array<uint32_t, 256> t{};
+        for (uint32_t i = 0; i < 256; ++i) {
+            uint32_t c = i;
+            for (int k = 0; k < 8; ++k) c = (c & 1) ? 0xEDB88320u ^ (c >> 1) : c >> 1;
+            t[i] = c;
+        }
+        return t;
+    }();
+    uint32_t crc = 0xFFFFFFFFu;
+    for (size_t i = 0; i < len; ++i) {
+        crc = table[(crc ^ (uint8_t)data[i]) & 0xFF] ^ (crc >> 8);
+    }
+    return crc ^ 0xFFFFFFFFu;
+}
+
+// --- Encoding helpers (host byte order; the log never leaves this machine) ---
+template <typename T>
+static void put(std::string& out, T v) {
+    out.append(reinterpret_cast<const char*>(&v), sizeof(T));
+}
+
+static void put_str(std::string& out, const std::string& s) {
+    put<uint32_t>(out, (uint32_t)s.size());
+    out.append(s);
+}
+
+struct Reader {
+    const char* p;
+    const char* end;
+
+    template <typename T>
+    bool get(T& v) {
+        if ((size_t)(end - p) < sizeof(T)) return false;
+        std::memcpy(&v, p, sizeof(T));
+        p += sizeof(T);
+        return true;
+    }
+
+    bool get_str(std::string& s) {
+        uint32_t len = 0;
+        if (!get(len) || (size_t)(end - p) < len) return false;
+        s.assign(p, len);
+        p += len;
+        return true;
+    }
+};
+
+GraphJournal::GraphJournal(const std::string& storage_path)
+    : wal_path_(fs::path(storage_path) / "graph.wal"),
+      rotated_path_(fs::path(storage_path) / "graph.wal.1") {}
+
+GraphJournal::~GraphJournal() {
+    std::lock_guard<std::mutex> lock(mutex_);
+    flush_locked(true);
+    if (file_) std::fclose(file_);
+}
+
+void GraphJournal::open_locked() {
+    if (file_) return;
+    fs::create_directories(wal_path_.parent_path());
+    bool fresh = !fs::exists(wal_path_) || fs::file_size(wal_path_) == 0;
+    file_ = std::fopen(wal_path_.string().c_str(), "ab");
+    if (!file_) {
+        spdlog::error("📜 WAL: cannot open {}", wal_path_.string());
+        return;
+    }
+    if (fresh) std::fwrite(kWalMagic, 1, sizeof(kWalMagic), file_);
+}
+
+void GraphJournal::append_record_locked(const std::string& payload, bool buffered) {
+    put<uint32_t>(buffer_, (uint32_t)payload.size());
+    put<uint32_t>(buffer_, crc32(payload.data(), payload.size()));
+    buffer_.append(payload);
+    records_since_snapshot_++;
+    // Unbuffered records also push out any bulk records queued ahead of them, keeping log order
+    if (!buffered || buffer_.size() >= kFlushThresholdBytes) flush_locked(false);
+}
+
+void GraphJournal::append_upsert(const PointerNode& node, const std::vector<float>& embedding, bool buffered) {
+    std::string payload;
+    payload.reserve(64 + node.content.size() + embedding.size() * sizeof(float));
+    put<uint8_t>(payload, (uint8_t)JournalOp::UPSERT_NODE);
+    put_str(payload, node.id);
+    put<uint8_t>(payload, (uint8_t)node.type);
+    put<int64_t>(payload, (int64_t)node.timestamp);
+    put_str(payload, node.parent_id);
+    put_str(payload, node.content);
+    put<uint32_t>(payload, (uint32_t)node.metadata.size());
+    for (const auto& [k, v] : node.metadata) {
+        put_str(payload, k);
+        put_str(payload, v);
+    }
+    put<uint32_t>(payload, (uint32_t)embedding.size());
+    payload.append(reinterpret_cast<const char*>(embedding.data()), embedding.size() * sizeof(float));
+
+    std::lock_guard<std::mutex> lock(mutex_);
+    append_record_locked(payload, buffered);
+}
+
+void GraphJournal::append_update_metadata(const std::string& node_id, const std::string& key, const std::string& value) {
+    std::string payload;
+    put<uint8_t>(payload, (uint8_t)JournalOp::UPDATE_METADATA);
+    put_str(payload, node_id);
+    put_str(payload, key);
+    put_str(payload, value);
+
+    std::lock_guard<std::mutex> lock(mutex_);
+    append_record_locked(payload);
+}
+
+void GraphJournal::append_remove(const std::string& node_id) {
+    std::string payload;
+    put<uint8_t>(payload, (uint8_t)JournalOp::REMOVE_NODE);
+    put_str(payload, node_id);
+
+    std::lock_guard<std::mutex> lock(mutex_);
+    append_record_locked(payload);
+}
+
+void GraphJournal::append_clear() {
+    std::string payload;
+    put<uint8_t>(payload, (uint8_t)JournalOp::CLEAR);
+
+    std::lock_guard<std::mutex> lock(mutex_);
+    append_record_locked(payload);
+}
+
+void GraphJournal::flush_locked(bool durable) {
+    if (buffer_.empty() && !durable) return;
+    open_locked();
+    if (!file_) return;
+
+    if (!buffer_.empty()) {
+        std::fwrite(buffer_.data(), 1, buffer_.size(), file_);
+        buffer_.clear();
+    }
+    std::fflush(file_);
+    if (durable) {
+#ifdef _WIN32
+        _commit(_fileno(file_));
+#else
+        fsync(fileno(file_));
+#endif
+    }
+}
+
+void GraphJournal::flush() {
+    std::lock_guard<std::mutex> lock(mutex_);
+    flush_locked(true);
+}
+
+size_t GraphJournal::records_since_snapshot() const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    return records_since_snapshot_;
+}
+
+void GraphJournal::rotate() {
+    std::lock_guard<std::mutex> lock(mutex_);
+    flush_locked(true);
+    if (file_) {
+        std::fclose(file_);
+        file_ = nullptr;
+    }
+
+    std::error_code ec;
+    if (fs::exists(wal_path_)) {
+        if (fs::exists(rotated_path_)) {
+            // A previous snapshot never completed: keep its records by chaining them in front
+            std::ofstream out(rotated_path_, std::ios::binary | std::ios::app);
+            std::ifstream in(wal_path_, std::ios::binary);
+            in.seekg(sizeof(kWalMagic));
+            out << in.rdbuf();
+            out.close();
+            in.close();
+            fs::remove(wal_path_, ec);
+        } else {
+            fs::rename(wal_path_, rotated_path_, ec);
+        }
+    }
+    records_since_snapshot_ = 0;
+}
+
+void GraphJournal::discard_rotated() {
+    std::lock_guard<std::mutex> lock(mutex_);
+    std::error_code ec;
+    fs::remove(rotated_path_, ec);
+}
+
+size_t GraphJournal::replay_file(const fs::path& path, const std::function<void(const JournalRecord&)>& apply) {
+    if (!fs::exists(path)) return 0;
+
+    std::ifstream in(path, std::ios::binary);
+    std::string data((std::istreambuf_iterator<char>(in)), std::istreambuf_iterator<char>());
+    in.close();
+
+    if (data.size() < sizeof(kWalMagic) || std::memcmp(data.data(), kWalMagic, sizeof(kWalMagic)) != 0) {
+        spdlog::error("📜 WAL: {} has no valid header, ignoring it", path.string());
+        return 0;
+    }
+
+    size_t applied = 0;
+    size_t offset = sizeof(kWalMagic);
+    while (offset + 8 <= data.size()) {
+        uint32_t len = 0, crc = 0;
+        std::memcpy(&len, data.data() + offset, 4);
+        std::memcpy(&crc, data.data() + offset + 4, 4);
+        if (offset + 8 + len > data.size()) break;
+
+        const char* payload = data.data() + offset + 8;
+        if (crc32(payload, len) != crc) break;
+
+        Reader r{payload, payload + len};
+        JournalRecord rec;
+        uint8_t op = 0;
+        bool ok = r.get(op);
+        rec.op = (JournalOp)op;
+
+        if (ok && rec.op == JournalOp::UPSERT_NODE) {
+            uint8_t type = 0;
+            int64_t ts = 0;
+            uint32_t meta_count = 0, dim = 0;
+            ok = r.get_str(rec.spec.id) && r.get(type) && r.get(ts) &&
+                 r.get_str(rec.spec.parent_id) && r.get_str(rec.spec.content) && r.get(meta_count);
+            rec.spec.type = (NodeType)type;
+            rec.spec.timestamp = ts;
+            for (uint32_t i = 0; ok && i < meta_count; ++i) {
+                std::string k, v;
+                ok = r.get_str(k) && r.get_str(v);
+                rec.spec.metadata[k] = std::move(v);
+            }
+            ok = ok && r.get(dim) && (size_t)(r.end - r.p) >= dim * sizeof(float);
+            if (ok) {
+                rec.spec.embedding.resize(dim);
+                std::memcpy(rec.spec.embedding.data(), r.p, dim * sizeof(float));
+            }
+        } else if (ok && rec.op == JournalOp::UPDATE_METADATA) {
+            ok = r.get_str(rec.spec.id) && r.get_str(rec.key) && r.get_str(rec.value);
+        } else if (ok && rec.op == JournalOp::REMOVE_NODE) {
+            ok = r.get_str(rec.spec.id);
+        } else if (!(ok && rec.op == JournalOp::CLEAR)) {
+            ok = false;
+        }
+
+        if (!ok) break;
+        apply(rec);
+        applied++;
+        offset += 8 + len;
+    }
+
+    if (offset < data.size()) {
+        // Torn tail from a crash mid-append: cut it so new records land on a clean boundary
+        spdlog::warn("📜 WAL: dropping {} trailing bytes of {}", data.size() - offset, path.string());
+        std::error_code ec;
+        fs::resize_file(path, offset, ec);
+    }
+    return applied;
+}
+
+size_t GraphJournal::replay(const std::function<void(const JournalRecord&)>& apply) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    size_t applied = replay_file(rotated_path_, apply);
+    applied += replay_file(wal_path_, apply);
+    records_since_snapshot_ = applied;
+    return applied;
+}
+
+}
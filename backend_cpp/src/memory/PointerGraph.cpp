@@ -6,21 +6,29 @@
 #include <random>
 #include <sstream>
 #include <iomanip>
+#include <algorithm>
 #include "utils/Scrubber.hpp"
+#include "node_store.hpp"
 
 namespace code_assistance {
 
 namespace fs = std::filesystem;
 
-PointerGraph::PointerGraph(const std::string& storage_path, int dimension)
-    : storage_path_(storage_path), dimension_(dimension) {
+// Snapshot once this many mutations sit in the WAL (keeps replay on startup short)
+static constexpr size_t kSnapshotEveryRecords = 4096;
+
+PointerGraph::PointerGraph(const std::string& storage_path, int dimension, VectorIndexConfig index_config)
+    : storage_path_(storage_path), dimension_(dimension), index_config_(index_config) {
     
-    vector_store_ = std::make_unique<FaissVectorStore>(dimension);
+    vector_store_ = std::make_shared<FaissVectorStore>(dimension, index_config);
+    journal_ = std::make_unique<GraphJournal>(storage_path);
     load(); // Auto-load on startup
 }
 
 PointerGraph::~PointerGraph() {
-    save(); // Auto-save on shutdown
+    if (snapshot_thread_.joinable()) snapshot_thread_.join();
+    // Clean shutdown: fold the WAL into a fresh snapshot so the next start replays nothing
+    if (journal_->records_since_snapshot() > 0) snapshot();
 }
 
 std::string PointerGraph::generate_uuid() {
@@ -31,6 +39,93 @@ std::string PointerGraph::generate_uuid() {
     return ss.str();
 }
 
+std::vector<std::string> PointerGraph::generate_uuid_block(size_t count) {
+    // One clock read for the whole block; the sequence suffix keeps ids unique and ordered.
+    // Zero-padded so text order is insertion order ("_b00000010" after "_b00000009"): the whole
+    // block shares one timestamp, so postings fall back to the id to order it.
+    if (count == 1) return {generate_uuid()};
+    std::vector<std::string> ids;
+    ids.reserve(count);
+    std::string base = "node_" + std::to_string(std::chrono::system_clock::now().time_since_epoch().count());
+    for (size_t i = 0; i < count; ++i) {
+        ids.push_back(fmt::format("{}_b{:08}", base, i));
+    }
+    return ids;
+}
+
+std::shared_ptr<CodeNode> PointerGraph::make_vector_node(const PointerNode& node, const std::vector<float>& embedding) const {
+    auto wrapper_node = std::make_shared<CodeNode>();
+    wrapper_node->id = node.id;
+    wrapper_node->content = node.content;
+    wrapper_node->embedding = embedding;
+
+    const auto& metadata = node.metadata;
+    // ✅ FIX: Copy ALL metadata fields properly
+    if(metadata.count("file_path")) 
+        wrapper_node->file_path = metadata.at("file_path");
+    if(metadata.count("node_name")) 
+        wrapper_node->name = metadata.at("node_name");
+    if(metadata.count("node_type"))  // ← ADD THIS
+        wrapper_node->type = metadata.at("node_type");
+    
+    // Optional: Copy dependencies if present
+    if(metadata.count("dependencies")) {
+        std::istringstream ss(metadata.at("dependencies"));
+        std::string dep;
+        while(std::getline(ss, dep, ',')) {
+            if(!dep.empty()) wrapper_node->dependencies.insert(dep);
+        }
+    }
+    // Calls / bases / type uses, linked into the store's reference graph
+    if(metadata.count("references"))
+        wrapper_node->references = parse_references(metadata.at("references"));
+    return wrapper_node;
+}
+
+const PointerGraph::Postings* PointerGraph::postings_locked(const std::string& key, const std::string& value) const {
+    auto k_it = meta_index_.find(key);
+    if (k_it == meta_index_.end()) return nullptr;
+    auto v_it = k_it->second.find(value);
+    if (v_it == k_it->second.end()) return nullptr;
+    return &v_it->second;
+}
+
+void PointerGraph::index_meta_locked(const PointerNode& node, const std::string& key, const std::string& value) {
+    meta_index_[key][value].emplace(node.timestamp, node.id);
+}
+
+void PointerGraph::unindex_meta_locked(const PointerNode& node, const std::string& key, const std::string& value) {
+    auto k_it = meta_index_.find(key);
+    if (k_it == meta_index_.end()) return;
+    auto v_it = k_it->second.find(value);
+    if (v_it == k_it->second.end()) return;
+    v_it->second.erase({node.timestamp, node.id});
+    // Drop empty buckets so indexed_files() only lists live paths
+    if (v_it->second.empty()) k_it->second.erase(v_it);
+    if (k_it->second.empty()) meta_index_.erase(k_it);
+}
+
+void PointerGraph::track_vector_locked(const PointerNode& node) {
+    if (node.faiss_id == -1) return;
+    faiss_to_uuid_[node.faiss_id] = node.id;
+    vectors_by_type_[node.type].insert(node.faiss_id);
+}
+
+void PointerGraph::untrack_vector_locked(const PointerNode& node) {
+    if (node.faiss_id == -1) return;
+    faiss_to_uuid_.erase(node.faiss_id);
+    auto it = vectors_by_type_.find(node.type);
+    if (it != vectors_by_type_.end()) it->second.erase(node.faiss_id);
+}
+
+void PointerGraph::index_node_locked(const PointerNode& node) {
+    for (const auto& [key, value] : node.metadata) index_meta_locked(node, key, value);
+}
+
+void PointerGraph::unindex_node_locked(const PointerNode& node) {
+    for (const auto& [key, value] : node.metadata) unindex_meta_locked(node, key, value);
+}
+
 std::string PointerGraph::add_node(const std::string& content, 
                                    NodeType type, 
                                    const std::string& parent_id, 
@@ -39,59 +134,176 @@ std::string PointerGraph::add_node(const std::string& content,
     
     std::unique_lock lock(data_mutex_);
 
-    PointerNode node;
-    node.id = generate_uuid();
-    node.type = type;
-    node.timestamp = std::chrono::system_clock::to_time_t(std::chrono::system_clock::now());
-    node.content = content;
-    node.parent_id = parent_id;
-    node.metadata = metadata;
+    NodeSpec spec;
+    spec.content = content;
+    spec.type = type;
+    spec.parent_id = parent_id;
+    spec.embedding = embedding;
+    spec.metadata = metadata;
+    return upsert_locked({&spec, 1})[0];
+}
 
-    if (!parent_id.empty() && nodes_.count(parent_id)) {
-        nodes_[parent_id].children_ids.push_back(node.id);
+std::vector<std::string> PointerGraph::upsert_locked(std::span<const NodeSpec> specs, bool bulk) {
+    // NO LOCK HERE - caller must hold unique_lock
+    size_t fresh_count = 0;
+    for (const auto& spec : specs) {
+        if (spec.id.empty()) fresh_count++;
     }
+    auto fresh_ids = generate_uuid_block(fresh_count);
+    size_t next_fresh = 0;
 
-    if (!embedding.empty()) {
-        auto wrapper_node = std::make_shared<CodeNode>();
-        wrapper_node->id = node.id;
-        wrapper_node->content = content;
-        wrapper_node->embedding = embedding;
-        
-        // ✅ FIX: Copy ALL metadata fields properly
-        if(metadata.count("file_path")) 
-            wrapper_node->file_path = metadata.at("file_path");
-        if(metadata.count("node_name")) 
-            wrapper_node->name = metadata.at("node_name");
-        if(metadata.count("node_type"))  // ← ADD THIS
-            wrapper_node->type = metadata.at("node_type");
-        
-        // Optional: Copy dependencies if present
-        if(metadata.count("dependencies")) {
-            std::istringstream ss(metadata.at("dependencies"));
-            std::string dep;
-            while(std::getline(ss, dep, ',')) {
-                if(!dep.empty()) wrapper_node->dependencies.insert(dep);
+    long long now = std::chrono::system_clock::to_time_t(std::chrono::system_clock::now());
+
+    std::vector<std::string> ids;
+    ids.reserve(specs.size());
+    std::vector<std::shared_ptr<CodeNode>> wrappers;
+    std::vector<PointerNode*> owners; // unordered_map references survive rehashing
+    std::vector<std::string> unindexed;
+
+    for (const auto& spec : specs) {
+        std::string id = spec.id.empty() ? fresh_ids[next_fresh++] : spec.id;
+
+        auto [it, inserted] = nodes_.try_emplace(id);
+        PointerNode& node = it->second;
+        if (inserted) {
+            node.id = id;
+            node.parent_id = spec.parent_id;
+            if (!spec.parent_id.empty()) {
+                auto parent_it = nodes_.find(spec.parent_id);
+                if (parent_it != nodes_.end()) parent_it->second.children_ids.push_back(id);
             }
+        } else {
+            // Existing node: keep its place in the graph, replace payload + vector
+            // Postings are keyed by the old timestamp, so pull them before it changes
+            unindex_node_locked(node);
+            untrack_vector_locked(node);
         }
 
-        vector_store_->add_nodes({wrapper_node});
-        
-        long internal_id = vector_store_->get_all_nodes().size() - 1; 
-        node.faiss_id = internal_id;
-        faiss_to_uuid_[internal_id] = node.id;
+        node.type = spec.type;
+        node.timestamp = spec.timestamp ? spec.timestamp : now;
+        node.content = spec.content;
+        node.metadata = spec.metadata;
+        node.faiss_id = -1;
+
+        if (!spec.embedding.empty()) {
+            wrappers.push_back(make_vector_node(node, spec.embedding));
+            owners.push_back(&node);
+        } else if (!inserted) {
+            unindexed.push_back(id);
+        }
+
+        index_node_locked(node);
+        if (!replaying_) journal_->append_upsert(node, spec.embedding, bulk);
+        ids.push_back(std::move(id));
     }
 
-    nodes_[node.id] = node;
-    
-    if (nodes_.size() % 10 == 0) {
-        // 🚀 FIX: Call the INTERNAL version because we already hold the lock
-        save_internal(); 
+    if (!unindexed.empty()) vector_store_->remove_nodes(unindexed);
+
+    if (!wrappers.empty()) {
+        // One contiguous matrix, one FAISS add, ids allocated as a block
+        auto faiss_ids = vector_store_->upsert_nodes(wrappers);
+        for (size_t i = 0; i < owners.size(); ++i) {
+            owners[i]->faiss_id = faiss_ids[i];
+            track_vector_locked(*owners[i]);
+        }
+    }
+    return ids;
+}
+
+std::vector<std::string> PointerGraph::add_nodes_bulk(std::span<const NodeSpec> specs) {
+    if (specs.empty()) return {};
+    auto start = std::chrono::high_resolution_clock::now();
+
+    std::unique_lock lock(data_mutex_);
+    auto ids = upsert_locked(specs, true);
+    size_t total = nodes_.size();
+    lock.unlock();
+    save(); // 💾 One journal flush for the whole batch
+
+    double ms = std::chrono::duration<double, std::milli>(std::chrono::high_resolution_clock::now() - start).count();
+    spdlog::info("📥 Bulk ingested {} nodes in {:.2f} ms. Total: {}", specs.size(), ms, total);
+    return ids;
+}
+
+std::string PointerGraph::upsert_node(const std::string& node_id,
+                                      const std::string& content,
+                                      NodeType type,
+                                      const std::vector<float>& embedding,
+                                      const std::unordered_map<std::string, std::string>& metadata) {
+    std::unique_lock lock(data_mutex_);
+
+    NodeSpec spec;
+    spec.id = node_id;
+    spec.content = content;
+    spec.type = type;
+    spec.embedding = embedding;
+    spec.metadata = metadata;
+    return upsert_locked({&spec, 1})[0];
+}
+
+size_t PointerGraph::remove_nodes_locked(const std::vector<std::string>& node_ids) {
+    // NO LOCK HERE - caller must hold unique_lock
+    std::vector<std::string> vector_ids;
+    size_t removed = 0;
+
+    for (const auto& id : node_ids) {
+        auto it = nodes_.find(id);
+        if (it == nodes_.end()) continue;
+
+        const PointerNode& node = it->second;
+        if (!node.parent_id.empty()) {
+            auto parent_it = nodes_.find(node.parent_id);
+            if (parent_it != nodes_.end()) {
+                auto& kids = parent_it->second.children_ids;
+                kids.erase(std::remove(kids.begin(), kids.end(), id), kids.end());
+            }
+        }
+        // Graphs saved before faiss_id was persisted still own vectors, so always ask the store
+        untrack_vector_locked(node);
+        vector_ids.push_back(id);
+        unindex_node_locked(node);
+        if (!replaying_) journal_->append_remove(id);
+        nodes_.erase(it);
+        removed++;
     }
 
-    return node.id;
+    if (!vector_ids.empty()) vector_store_->remove_nodes(vector_ids);
+    return removed;
 }
 
-std::string PointerGraph::get_relevant_context(const std::string& query, int max_chars) {
+size_t PointerGraph::remove_nodes(const std::vector<std::string>& node_ids) {
+    std::unique_lock lock(data_mutex_);
+    return remove_nodes_locked(node_ids);
+}
+
+size_t PointerGraph::remove_file_nodes(const std::string& file_path) {
+    std::unique_lock lock(data_mutex_);
+    const Postings* postings = postings_locked("file_path", file_path);
+    if (!postings) return 0;
+    std::vector<std::string> ids;
+    ids.reserve(postings->size());
+    for (const auto& [ts, id] : *postings) ids.push_back(id);
+    return remove_nodes_locked(ids);
+}
+
+bool PointerGraph::contains(const std::string& node_id) const {
+    std::shared_lock lock(data_mutex_);
+    return nodes_.count(node_id) > 0;
+}
+
+std::vector<std::string> PointerGraph::indexed_files() const {
+    std::shared_lock lock(data_mutex_);
+    std::vector<std::string> files;
+    auto it = meta_index_.find("file_path");
+    if (it == meta_index_.end()) return files;
+    files.reserve(it->second.size());
+    for (const auto& [path, postings] : it->second) {
+        if (!path.empty()) files.push_back(path);
+    }
+    return files;
+}
+
+std::string PointerGraph::get_relevant_context([[maybe_unused]] const std::string& query, [[maybe_unused]] int max_chars) {
     // Placeholder: In a real high-frequency scenario, we can't run BERT/Gecko every 50ms.
     // We will stick to the "Project Cache" strategy for now, but filter it using the graph later.
     // For this specific turn, let's keep the Architecture Simple.
@@ -101,16 +313,67 @@ std::string PointerGraph::get_relevant_context(const std::string& query, int max
 
 void PointerGraph::update_metadata(const std::string& node_id, const std::string& key, const std::string& value) {
     std::unique_lock lock(data_mutex_);
-    if (nodes_.count(node_id)) {
-        nodes_[node_id].metadata[key] = value;
+    update_metadata_locked(node_id, key, value);
+}
+
+void PointerGraph::update_metadata_locked(const std::string& node_id, const std::string& key, const std::string& value) {
+    // NO LOCK HERE - caller must hold unique_lock
+    auto it = nodes_.find(node_id);
+    if (it != nodes_.end()) {
+        PointerNode& node = it->second;
+        auto old = node.metadata.find(key);
+        if (old != node.metadata.end()) unindex_meta_locked(node, key, old->second);
+        node.metadata[key] = value;
+        index_meta_locked(node, key, value);
+        if (!replaying_) journal_->append_update_metadata(node_id, key, value);
     }
 }
 
-std::vector<PointerNode> PointerGraph::semantic_search(const std::vector<float>& query_vec, int k) {
+bool PointerGraph::build_vector_filter_locked(const SearchFilter& filter, VectorFilter& vf,
+                                              std::unordered_set<long>& meta_ids) const {
+    // NO LOCK HERE - caller must hold data_mutex_
+    // Translate the graph-level filter into FAISS id sets the store can test in O(1).
+    // Returns false when nothing can match.
+    vf.path_prefix = filter.path_prefix;
+    for (NodeType t : filter.types) {
+        auto it = vectors_by_type_.find(t);
+        if (it != vectors_by_type_.end() && !it->second.empty()) vf.any_of.push_back(&it->second);
+    }
+    if (!filter.types.empty() && vf.any_of.empty()) return false; // No vectors of any requested type
+
+    if (!filter.metadata.empty()) {
+        // Walk the rarest posting list, verify the remaining keys on the node itself
+        const Postings* rarest = nullptr;
+        for (const auto& [key, value] : filter.metadata) {
+            const Postings* p = postings_locked(key, value);
+            if (!p) return false;
+            if (!rarest || p->size() < rarest->size()) rarest = p;
+        }
+        for (const auto& [ts, id] : *rarest) {
+            const PointerNode& node = nodes_.at(id);
+            if (node.faiss_id == -1) continue;
+            bool ok = std::all_of(filter.metadata.begin(), filter.metadata.end(), [&](const auto& kv) {
+                auto m = node.metadata.find(kv.first);
+                return m != node.metadata.end() && m->second == kv.second;
+            });
+            if (ok) meta_ids.insert(node.faiss_id);
+        }
+        if (meta_ids.empty()) return false;
+        vf.all_of.push_back(&meta_ids);
+    }
+    return true;
+}
+
+std::vector<PointerNode> PointerGraph::semantic_search(const std::vector<float>& query_vec, int k, const SearchFilter& filter,
+                                                      const SearchParams& params) {
     std::shared_lock lock(data_mutex_);
-    
+
+    VectorFilter vf;
+    std::unordered_set<long> meta_ids;
+    if (!build_vector_filter_locked(filter, vf, meta_ids)) return {};
+
     // Use existing HNSW search
-    auto results = vector_store_->search(query_vec, k);
+    auto results = vector_store_->search(query_vec, k, vf, params);
     
     std::vector<PointerNode> pointer_results;
     for (const auto& res : results) {
@@ -123,6 +386,39 @@ std::vector<PointerNode> PointerGraph::semantic_search(const std::vector<float>&
     return pointer_results;
 }
 
+std::vector<std::vector<PointerNode>> PointerGraph::semantic_search_batch(const std::vector<std::vector<float>>& query_vecs,
+                                                                         int k, const SearchFilter& filter,
+                                                                         const SearchParams& params) {
+    std::vector<std::vector<PointerNode>> pointer_results(query_vecs.size());
+    std::shared_lock lock(data_mutex_);
+
+    VectorFilter vf;
+    std::unordered_set<long> meta_ids;
+    if (!build_vector_filter_locked(filter, vf, meta_ids)) return pointer_results;
+
+    // Pack the well-formed queries into one row-major block; malformed ones keep an empty slot
+    const size_t dim = (size_t)dimension_;
+    std::vector<float> block;
+    std::vector<size_t> slot_of_row;
+    block.reserve(query_vecs.size() * dim);
+    for (size_t i = 0; i < query_vecs.size(); ++i) {
+        if (query_vecs[i].size() != dim) continue;
+        block.insert(block.end(), query_vecs[i].begin(), query_vecs[i].end());
+        slot_of_row.push_back(i);
+    }
+    if (slot_of_row.empty()) return pointer_results;
+
+    auto results = vector_store_->search_batch(block.data(), slot_of_row.size(), k, vf, params);
+    for (size_t row = 0; row < results.size(); ++row) {
+        auto& out = pointer_results[slot_of_row[row]];
+        for (const auto& res : results[row]) {
+            auto it = nodes_.find(res.node->id);
+            if (it != nodes_.end()) out.push_back(it->second);
+        }
+    }
+    return pointer_results;
+}
+
 std::vector<PointerNode> PointerGraph::get_children(const std::string& node_id) {
     std::shared_lock lock(data_mutex_);
     std::vector<PointerNode> children;
@@ -157,58 +453,98 @@ std::vector<PointerNode> PointerGraph::get_trace(const std::string& end_node_id)
 std::vector<PointerNode> PointerGraph::query_by_metadata(const std::string& key, const std::string& value) {
     std::shared_lock lock(data_mutex_);
     std::vector<PointerNode> matches;
-    for (const auto& [id, node] : nodes_) {
-        if (node.metadata.count(key) && node.metadata.at(key) == value) {
-            matches.push_back(node);
-        }
+    const Postings* postings = postings_locked(key, value);
+    if (!postings) return matches;
+    matches.reserve(postings->size());
+    for (const auto& [ts, id] : *postings) {
+        matches.push_back(nodes_.at(id));
     }
     return matches;
 }
 
+std::vector<NodeHandle> PointerGraph::find_by_metadata(const std::string& key, const std::string& value) const {
+    std::shared_lock lock(data_mutex_);
+    std::vector<NodeHandle> handles;
+    const Postings* postings = postings_locked(key, value);
+    if (!postings) return handles;
+    handles.reserve(postings->size());
+    for (const auto& [ts, id] : *postings) {
+        handles.push_back({id, nodes_.at(id).type, ts});
+    }
+    return handles;
+}
+
+std::optional<NodeHandle> PointerGraph::latest_by_metadata(const std::string& key, const std::string& value) const {
+    std::shared_lock lock(data_mutex_);
+    const Postings* postings = postings_locked(key, value);
+    if (!postings || postings->empty()) return std::nullopt;
+    const auto& [ts, id] = *postings->rbegin();
+    return NodeHandle{id, nodes_.at(id).type, ts};
+}
+
 void PointerGraph::save() {
-    std::unique_lock lock(data_mutex_); 
-    save_internal();
-    spdlog::info("💾 Pointer Graph Saved: {} nodes", nodes_.size());
+    // No graph lock: the journal serializes its own appends/flushes
+    journal_->flush();
+    spdlog::info("💾 Pointer Graph Saved: {} journaled mutations pending snapshot", journal_->records_since_snapshot());
+    maybe_schedule_snapshot();
 }
 
-void PointerGraph::save_internal() {
-    // NO LOCK HERE - caller must hold unique_lock
-    if (!fs::exists(storage_path_)) fs::create_directories(storage_path_);
-    vector_store_->save(storage_path_);
-    
-    nlohmann::json j = nlohmann::json::array();
-    for (auto& [id, node] : nodes_) {
-        nlohmann::json node_json;
-        node_json["id"] = code_assistance::scrub_json_string(node.id);
-        node_json["type"] = node_type_to_string(node.type);
-        node_json["timestamp"] = node.timestamp;
-
-        std::string content = node.content;
-        if (content.length() > 10000) {
-            content = content.substr(0, 10000) + "\n...[truncated]";
-        }
-        node_json["content"] = code_assistance::scrub_json_string(content);
-        
-        nlohmann::json meta_json = nlohmann::json::object();
-        for (auto const& [key, val] : node.metadata) {
-            meta_json[key] = code_assistance::scrub_json_string(val);
-        }
-        node_json["metadata"] = meta_json;
+void PointerGraph::maybe_schedule_snapshot() {
+    if (journal_->records_since_snapshot() < kSnapshotEveryRecords) return;
+    if (snapshotting_.exchange(true)) return; // One in flight is enough
 
-        nlohmann::json children_array = nlohmann::json::array();
-        for (const auto& child_id : node.children_ids) {
-            children_array.push_back(code_assistance::scrub_json_string(child_id));
+    if (snapshot_thread_.joinable()) snapshot_thread_.join();
+    snapshot_thread_ = std::thread([this]() {
+        try {
+            snapshot();
+        } catch (const std::exception& e) {
+            spdlog::error("⚠️ Graph snapshot failed: {}", e.what());
         }
-        node_json["children_ids"] = children_array;
-        
-        j.push_back(node_json);
+        snapshotting_ = false;
+    });
+}
+
+void PointerGraph::snapshot() {
+    std::lock_guard<std::mutex> guard(snapshot_mutex_);
+    auto start = std::chrono::high_resolution_clock::now();
+
+    std::vector<PointerNode> frozen;
+    {
+        // Shared lock: readers keep going, writers wait only for the copy + index dump.
+        // Rotating under it pins the cut point: everything after lands in the fresh WAL.
+        std::shared_lock lock(data_mutex_);
+        journal_->rotate();
+        frozen.reserve(nodes_.size());
+        for (const auto& [id, node] : nodes_) frozen.push_back(node);
+
+        if (!fs::exists(storage_path_)) fs::create_directories(storage_path_);
+        vector_store_->save(storage_path_);
     }
-    
-    std::ofstream f(fs::path(storage_path_) / "graph.json");
-    f << j.dump(-1, ' ', false, nlohmann::json::error_handler_t::replace);
+
+    // Encoding runs with no lock held
+    write_graph_store(frozen);
+    journal_->discard_rotated();
+
+    double ms = std::chrono::duration<double, std::milli>(std::chrono::high_resolution_clock::now() - start).count();
+    spdlog::info("📸 Pointer Graph Snapshot: {} nodes in {:.2f} ms", frozen.size(), ms);
+}
+
+void PointerGraph::write_graph_store(const std::vector<PointerNode>& nodes) const {
+    node_store::Writer writer(node_store::Kind::POINTER_NODES);
+    for (const auto& node : nodes) writer.add_pointer_node(node);
+
+    // Write-then-rename so a crash never leaves a half-written snapshot behind
+    fs::path final_path = fs::path(storage_path_) / "graph.bin";
+    if (!writer.write(final_path.string())) {
+        throw std::runtime_error("cannot write " + final_path.string());
+    }
+    std::error_code ec;
+    fs::remove(fs::path(storage_path_) / "graph.json", ec); // Superseded by graph.bin
 }
 
 void PointerGraph::load() {
+    std::unique_lock lock(data_mutex_);
+
     // 1. Load Vector Index
     try {
         if (fs::exists(fs::path(storage_path_) / "faiss.index")) {
@@ -218,9 +554,28 @@ void PointerGraph::load() {
         spdlog::error("⚠️ Failed to load Vector Store: {}", e.what());
     }
 
-    // 2. Load Graph Structure
+    // 2. Load Graph Structure (binary snapshot, else the pre-binary graph.json)
+    fs::path bin_path = fs::path(storage_path_) / "graph.bin";
     fs::path graph_path = fs::path(storage_path_) / "graph.json";
-    if (fs::exists(graph_path)) {
+    node_store::Reader reader;
+    if (fs::exists(bin_path)) {
+        if (reader.open(bin_path.string(), node_store::Kind::POINTER_NODES)) {
+            nodes_.clear();
+            faiss_to_uuid_.clear();
+            vectors_by_type_.clear();
+            meta_index_.clear();
+            nodes_.reserve(reader.size());
+
+            for (size_t i = 0; i < reader.size(); ++i) {
+                PointerNode node = reader.to_pointer_node(i);
+                index_node_locked(node);
+                nodes_[node.id] = node;
+            }
+            spdlog::info("🧠 Pointer Graph Loaded: {} nodes", nodes_.size());
+        } else {
+            spdlog::error("⚠️ Failed to load Graph Store: {}", bin_path.string());
+        }
+    } else if (fs::exists(graph_path)) {
         try {
             std::ifstream f(graph_path);
             nlohmann::json j;
@@ -228,33 +583,87 @@ void PointerGraph::load() {
             
             nodes_.clear();
             faiss_to_uuid_.clear();
+            vectors_by_type_.clear();
+            meta_index_.clear();
             
             for (const auto& item : j) {
                 PointerNode node = PointerNode::from_json(item);
+                index_node_locked(node);
                 nodes_[node.id] = node;
-                if (node.faiss_id != -1) {
-                    faiss_to_uuid_[node.faiss_id] = node.id;
-                }
             }
             spdlog::info("🧠 Pointer Graph Loaded: {} nodes", nodes_.size());
         } catch (const std::exception& e) {
             spdlog::error("⚠️ Failed to load Graph JSON: {}", e.what());
         }
     }
+
+    // Graphs saved before faiss_id was persisted still own vectors: ask the store
+    for (auto& [id, node] : nodes_) {
+        if (node.faiss_id == -1) node.faiss_id = vector_store_->faiss_id_of(id);
+        track_vector_locked(node);
+    }
+
+    // 3. Replay the WAL on top of the snapshot. Records are idempotent, so entries
+    // that an interrupted snapshot already captured are harmless to apply twice.
+    replaying_ = true;
+    std::vector<NodeSpec> pending; // Consecutive upserts go to FAISS as one batch
+    auto drain = [&]() {
+        if (pending.empty()) return;
+        upsert_locked(pending);
+        pending.clear();
+    };
+
+    size_t replayed = journal_->replay([&](const JournalRecord& rec) {
+        if (rec.op == JournalOp::UPSERT_NODE) {
+            pending.push_back(rec.spec);
+            return;
+        }
+        drain();
+        switch (rec.op) {
+            case JournalOp::UPDATE_METADATA: update_metadata_locked(rec.spec.id, rec.key, rec.value); break;
+            case JournalOp::REMOVE_NODE: remove_nodes_locked({rec.spec.id}); break;
+            case JournalOp::CLEAR: clear_locked(); break;
+            default: break;
+        }
+    });
+    drain();
+    replaying_ = false;
+
+    if (replayed > 0) {
+        spdlog::info("📜 Replayed {} WAL records. Total: {} nodes", replayed, nodes_.size());
+        vector_store_->link_references(); // Replayed upserts came after the loaded graph
+    }
+}
+
+void PointerGraph::link_references() {
+    // The lock only pins the store (clear() swaps it); linking runs from the store's own snapshot
+    std::shared_ptr<FaissVectorStore> store;
+    {
+        std::shared_lock lock(data_mutex_);
+        store = vector_store_;
+    }
+    store->link_references();
 }
 
 void PointerGraph::clear() {
     std::unique_lock lock(data_mutex_); // 🛡️ Thread-safe wipe
-    
+    clear_locked();
+}
+
+void PointerGraph::clear_locked() {
+    // NO LOCK HERE - caller must hold unique_lock
     // 1. Wipe the episodic memory map
     nodes_.clear();
     
     // 2. Wipe the ID mapping
     faiss_to_uuid_.clear();
+    vectors_by_type_.clear();
+    meta_index_.clear();
     
     // 3. Re-initialize the Vector Store to clear the FAISS index
     // This ensures that old vectors are completely removed from memory
-    vector_store_ = std::make_unique<FaissVectorStore>(dimension_);
+    vector_store_ = std::make_shared<FaissVectorStore>(dimension_, index_config_);
+    if (!replaying_) journal_->append_clear();
     
     spdlog::warn("🧠 [GRAPH WIPE] All episodic and semantic memory has been cleared.");
 }
@@ -0,0 +1,359 @@
+#include "node_store.hpp"
+#include "utils/Scrubber.hpp"
+#include <algorithm>
+#include <cstddef>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <map>
+#include <nlohmann/json.hpp>
+#include <spdlog/spdlog.h>
+
+namespace fs = std::filesystem;
+
+namespace code_assistance {
+namespace node_store {
+
+static uint64_t align_up(uint64_t v, uint64_t a) { return (v + a - 1) / a * a; }
+
+// Everything a v1 / v2 writer wrote: later fields came after it
+static constexpr size_t kHeaderV1Size = offsetof(Header, files_offset);
+static constexpr size_t kHeaderV2Size = offsetof(Header, symbol_refs_offset);
+
+// ============================================================================
+// WRITER
+// ============================================================================
+
+Writer::Writer(Kind kind, uint32_t dimension) : kind_(kind), dimension_(dimension) {}
+
+StrRef Writer::add_string(std::string_view s) {
+    StrRef ref{strings_.size(), s.size()};
+    strings_.append(s);
+    return ref;
+}
+
+int64_t Writer::add_code_node(const CodeNode& node, int64_t faiss_id, std::span<const float> embedding) {
+    CodeNodeRecord rec{};
+    rec.id = add_string(node.id);
+    rec.name = add_string(node.name);
+    rec.content = add_string(node.text());
+    rec.docstring = add_string(node.docstring);
+    rec.file_path = add_string(node.file_path);
+    rec.type = add_string(node.type);
+    rec.ai_summary = add_string(node.ai_summary);
+
+    rec.dependencies = {refs_.size(), node.dependencies.size()};
+    for (const auto& dep : node.dependencies) refs_.push_back(add_string(dep));
+
+    rec.weights = {weights_.size(), node.weights.size()};
+    for (const auto& [key, value] : node.weights) weights_.push_back({add_string(key), value});
+
+    record_refs_.push_back({symbol_refs_.size(), node.references.size()});
+    for (const auto& ref : node.references) symbol_refs_.push_back({add_string(ref.name), (uint32_t)ref.kind, 0});
+
+    rec.ai_quality_score = node.ai_quality_score;
+    rec.faiss_id = faiss_id;
+    rec.embedding_row = -1;
+    if (!embedding.empty() && embedding.size() == dimension_) {
+        rec.embedding_row = (int64_t)(floats_.size() / dimension_);
+        floats_.insert(floats_.end(), embedding.begin(), embedding.end());
+    }
+
+    code_records_.push_back(rec);
+    return rec.embedding_row;
+}
+
+void Writer::add_pointer_node(const PointerNode& node) {
+    PointerNodeRecord rec{};
+    rec.id = add_string(node.id);
+    rec.parent_id = add_string(node.parent_id);
+    rec.content = add_string(node.content);
+
+    rec.children = {refs_.size(), node.children_ids.size()};
+    for (const auto& child : node.children_ids) refs_.push_back(add_string(child));
+
+    rec.metadata = {refs_.size(), node.metadata.size() * 2};
+    for (const auto& [key, value] : node.metadata) {
+        refs_.push_back(add_string(key));
+        refs_.push_back(add_string(value));
+    }
+
+    rec.timestamp = node.timestamp;
+    rec.faiss_id = node.faiss_id;
+    rec.type = (uint32_t)node.type;
+    pointer_records_.push_back(rec);
+}
+
+bool Writer::write_tmp(const std::string& path) const {
+    Header h{};
+    std::memcpy(h.magic, kMagic, sizeof(kMagic));
+    h.version = kVersion;
+    h.kind = (uint32_t)kind_;
+    h.dimension = dimension_;
+    h.next_id = next_id_;
+
+    const void* records = nullptr;
+    size_t record_bytes = 0;
+    if (kind_ == Kind::CODE_NODES) {
+        h.record_count = code_records_.size();
+        records = code_records_.data();
+        record_bytes = code_records_.size() * sizeof(CodeNodeRecord);
+    } else {
+        h.record_count = pointer_records_.size();
+        records = pointer_records_.data();
+        record_bytes = pointer_records_.size() * sizeof(PointerNodeRecord);
+    }
+
+    h.records_offset = align_up(sizeof(Header), 8);
+    h.refs_offset = align_up(h.records_offset + record_bytes, 8);
+    h.ref_count = refs_.size();
+    h.weights_offset = align_up(h.refs_offset + refs_.size() * sizeof(StrRef), 8);
+    h.weight_count = weights_.size();
+    h.longs_offset = align_up(h.weights_offset + weights_.size() * sizeof(WeightEntry), 8);
+    h.long_count = longs_.size();
+
+    // 🗂️ File index: one run of record indices per file_path, paths in byte order for binary search
+    std::map<std::string_view, std::vector<uint64_t>> by_file;
+    for (size_t i = 0; i < code_records_.size(); ++i) {
+        const StrRef& ref = code_records_[i].file_path;
+        by_file[std::string_view(strings_).substr(ref.offset, ref.length)].push_back(i);
+    }
+    std::vector<FileEntry> files;
+    std::vector<uint64_t> file_records;
+    files.reserve(by_file.size());
+    file_records.reserve(code_records_.size());
+    for (const auto& [path, indices] : by_file) {
+        files.push_back({code_records_[indices.front()].file_path, {file_records.size(), indices.size()}});
+        file_records.insert(file_records.end(), indices.begin(), indices.end());
+    }
+    h.files_offset = align_up(h.longs_offset + longs_.size() * sizeof(int64_t), 8);
+    h.file_count = files.size();
+    h.file_records_offset = align_up(h.files_offset + files.size() * sizeof(FileEntry), 8);
+    h.file_record_count = file_records.size();
+
+    h.symbol_refs_offset = align_up(h.file_records_offset + file_records.size() * sizeof(uint64_t), 8);
+    h.symbol_ref_count = symbol_refs_.size();
+    h.record_refs_offset = align_up(h.symbol_refs_offset + symbol_refs_.size() * sizeof(SymbolRefEntry), 8);
+    h.record_ref_count = record_refs_.size();
+
+    h.floats_offset = align_up(h.record_refs_offset + record_refs_.size() * sizeof(ListRef), 64);
+    h.float_rows = dimension_ ? floats_.size() / dimension_ : 0;
+    h.strings_offset = align_up(h.floats_offset + floats_.size() * sizeof(float), 8);
+    h.strings_size = strings_.size();
+
+    std::ofstream out(path + ".tmp", std::ios::binary | std::ios::trunc);
+    if (!out) return false;
+
+    uint64_t pos = 0;
+    auto section = [&](uint64_t offset, const void* data, size_t bytes) {
+        static const char zeros[64] = {};
+        out.write(zeros, offset - pos); // Alignment padding
+        if (bytes) out.write(static_cast<const char*>(data), bytes);
+        pos = offset + bytes;
+    };
+
+    section(0, &h, sizeof(h));
+    section(h.records_offset, records, record_bytes);
+    section(h.refs_offset, refs_.data(), refs_.size() * sizeof(StrRef));
+    section(h.weights_offset, weights_.data(), weights_.size() * sizeof(WeightEntry));
+    section(h.longs_offset, longs_.data(), longs_.size() * sizeof(int64_t));
+    section(h.files_offset, files.data(), files.size() * sizeof(FileEntry));
+    section(h.file_records_offset, file_records.data(), file_records.size() * sizeof(uint64_t));
+    section(h.symbol_refs_offset, symbol_refs_.data(), symbol_refs_.size() * sizeof(SymbolRefEntry));
+    section(h.record_refs_offset, record_refs_.data(), record_refs_.size() * sizeof(ListRef));
+    section(h.floats_offset, floats_.data(), floats_.size() * sizeof(float));
+    section(h.strings_offset, strings_.data(), strings_.size());
+
+    out.close();
+    return (bool)out;
+}
+
+bool Writer::commit(const std::string& path) {
+    std::error_code ec;
+    fs::rename(path + ".tmp", path, ec);
+    if (ec) {
+        spdlog::error("📦 Node store: cannot replace {}: {}", path, ec.message());
+        return false;
+    }
+    return true;
+}
+
+// ============================================================================
+// READER
+// ============================================================================
+
+bool Reader::open(const std::string& path, Kind expected) {
+    header_ = nullptr;
+    has_file_index_ = false;
+    files_ = {};
+    file_records_ = {};
+    symbol_refs_ = {};
+    record_refs_ = {};
+    if (!file_.open(path) || file_.size() < kHeaderV1Size) return false;
+
+    const char* base = file_.data();
+    const uint64_t size = file_.size();
+    const auto* h = reinterpret_cast<const Header*>(base);
+
+    if (std::memcmp(h->magic, kMagic, sizeof(kMagic)) != 0) return false;
+    size_t header_size = h->version == 1 ? kHeaderV1Size : h->version == 2 ? kHeaderV2Size : sizeof(Header);
+    if (h->version < 1 || h->version > kVersion || size < header_size) {
+        spdlog::error("📦 Node store {}: unsupported version {}", path, h->version);
+        return false;
+    }
+    if (h->kind != (uint32_t)expected) return false;
+
+    // Every section must sit inside the mapping before anything is dereferenced
+    auto fits = [&](uint64_t offset, uint64_t count, uint64_t elem) {
+        return offset <= size && count <= (size - offset) / (elem ? elem : 1);
+    };
+    uint64_t record_size = expected == Kind::CODE_NODES ? sizeof(CodeNodeRecord) : sizeof(PointerNodeRecord);
+    if (!fits(h->records_offset, h->record_count, record_size) ||
+        !fits(h->refs_offset, h->ref_count, sizeof(StrRef)) ||
+        !fits(h->weights_offset, h->weight_count, sizeof(WeightEntry)) ||
+        !fits(h->longs_offset, h->long_count, sizeof(int64_t)) ||
+        !fits(h->floats_offset, h->float_rows * h->dimension, sizeof(float)) ||
+        !fits(h->strings_offset, h->strings_size, 1)) {
+        spdlog::error("📦 Node store {}: truncated or corrupt", path);
+        return false;
+    }
+
+    if (expected == Kind::CODE_NODES) {
+        code_records_ = {reinterpret_cast<const CodeNodeRecord*>(base + h->records_offset), h->record_count};
+    } else {
+        pointer_records_ = {reinterpret_cast<const PointerNodeRecord*>(base + h->records_offset), h->record_count};
+    }
+    refs_ = {reinterpret_cast<const StrRef*>(base + h->refs_offset), h->ref_count};
+    weights_ = {reinterpret_cast<const WeightEntry*>(base + h->weights_offset), h->weight_count};
+    longs_ = {reinterpret_cast<const int64_t*>(base + h->longs_offset), h->long_count};
+    floats_ = reinterpret_cast<const float*>(base + h->floats_offset);
+    strings_ = {base + h->strings_offset, h->strings_size};
+
+    if (h->version >= 2) {
+        if (!fits(h->files_offset, h->file_count, sizeof(FileEntry)) ||
+            !fits(h->file_records_offset, h->file_record_count, sizeof(uint64_t))) {
+            spdlog::error("📦 Node store {}: truncated or corrupt", path);
+            return false;
+        }
+        files_ = {reinterpret_cast<const FileEntry*>(base + h->files_offset), h->file_count};
+        file_records_ = {reinterpret_cast<const uint64_t*>(base + h->file_records_offset), h->file_record_count};
+        has_file_index_ = expected == Kind::CODE_NODES;
+    }
+    if (h->version >= 3) {
+        if (!fits(h->symbol_refs_offset, h->symbol_ref_count, sizeof(SymbolRefEntry)) ||
+            !fits(h->record_refs_offset, h->record_ref_count, sizeof(ListRef))) {
+            spdlog::error("📦 Node store {}: truncated or corrupt", path);
+            return false;
+        }
+        symbol_refs_ = {reinterpret_cast<const SymbolRefEntry*>(base + h->symbol_refs_offset), h->symbol_ref_count};
+        record_refs_ = {reinterpret_cast<const ListRef*>(base + h->record_refs_offset), h->record_ref_count};
+    }
+    header_ = h;
+    return true;
+}
+
+std::string_view Reader::str(const StrRef& ref) const {
+    if (ref.offset > strings_.size() || ref.length > strings_.size() - ref.offset) return {};
+    return strings_.substr(ref.offset, ref.length);
+}
+
+std::span<const StrRef> Reader::refs(const ListRef& list) const {
+    if (list.first > refs_.size() || list.count > refs_.size() - list.first) return {};
+    return refs_.subspan(list.first, list.count);
+}
+
+std::span<const WeightEntry> Reader::weights(const ListRef& list) const {
+    if (list.first > weights_.size() || list.count > weights_.size() - list.first) return {};
+    return weights_.subspan(list.first, list.count);
+}
+
+std::span<const uint64_t> Reader::file_records(const FileEntry& file) const {
+    const ListRef& list = file.records;
+    if (list.first > file_records_.size() || list.count > file_records_.size() - list.first) return {};
+    return file_records_.subspan(list.first, list.count);
+}
+
+std::span<const uint64_t> Reader::records_of(std::string_view file_path) const {
+    auto it = std::lower_bound(files_.begin(), files_.end(), file_path,
+                               [&](const FileEntry& e, std::string_view p) { return str(e.file_path) < p; });
+    if (it == files_.end() || str(it->file_path) != file_path) return {};
+    return file_records(*it);
+}
+
+std::span<const SymbolRefEntry> Reader::references(size_t i) const {
+    if (i >= record_refs_.size()) return {};
+    const ListRef& list = record_refs_[i];
+    if (list.first > symbol_refs_.size() || list.count > symbol_refs_.size() - list.first) return {};
+    return symbol_refs_.subspan(list.first, list.count);
+}
+
+std::span<const float> Reader::embedding(int64_t row) const {
+    if (!header_ || row < 0 || (uint64_t)row >= header_->float_rows) return {};
+    return {floats_ + (size_t)row * header_->dimension, header_->dimension};
+}
+
+CodeNode Reader::to_code_node(size_t i, bool with_embedding) const {
+    const auto& rec = code_records_[i];
+    CodeNode node;
+    node.id = str(rec.id);
+    node.name = str(rec.name);
+    node.content = str(rec.content);
+    node.docstring = str(rec.docstring);
+    node.file_path = str(rec.file_path);
+    node.type = str(rec.type);
+    node.ai_summary = str(rec.ai_summary);
+    node.ai_quality_score = rec.ai_quality_score;
+    for (const auto& dep : refs(rec.dependencies)) node.dependencies.emplace(str(dep));
+    for (const auto& w : weights(rec.weights)) node.weights.emplace(str(w.key), w.value);
+    auto refs_of_node = references(i);
+    node.references.reserve(refs_of_node.size());
+    for (const auto& ref : refs_of_node) node.references.push_back({std::string(str(ref.name)), (RefKind)ref.kind});
+    if (with_embedding) {
+        auto vec = embedding(rec.embedding_row);
+        node.embedding.assign(vec.begin(), vec.end());
+    }
+    return node;
+}
+
+PointerNode Reader::to_pointer_node(size_t i) const {
+    const auto& rec = pointer_records_[i];
+    PointerNode node;
+    node.id = str(rec.id);
+    node.parent_id = str(rec.parent_id);
+    node.content = str(rec.content);
+    node.type = (NodeType)rec.type;
+    node.timestamp = rec.timestamp;
+    node.faiss_id = rec.faiss_id;
+    for (const auto& child : refs(rec.children)) node.children_ids.emplace_back(str(child));
+    auto meta = refs(rec.metadata);
+    for (size_t k = 0; k + 1 < meta.size(); k += 2) {
+        node.metadata.emplace(str(meta[k]), str(meta[k + 1]));
+    }
+    return node;
+}
+
+// ============================================================================
+// ADMIN EXPORT
+// ============================================================================
+
+std::string export_pointer_nodes_json(const std::string& path) {
+    Reader reader;
+    if (!reader.open(path, Kind::POINTER_NODES)) return "[]";
+
+    nlohmann::json j = nlohmann::json::array();
+    for (size_t i = 0; i < reader.size(); ++i) {
+        PointerNode node = reader.to_pointer_node(i);
+        if (node.content.length() > 10000) {
+            node.content = node.content.substr(0, 10000) + "\n...[truncated]";
+        }
+        nlohmann::json node_json = node.to_json();
+        node_json["id"] = scrub_json_string(node.id);
+        node_json["parent_id"] = scrub_json_string(node.parent_id);
+        node_json["content"] = scrub_json_string(node.content);
+        j.push_back(std::move(node_json));
+    }
+    return j.dump(-1, ' ', false, nlohmann::json::error_handler_t::replace);
+}
+
+} // namespace node_store
+} // namespace code_assistance
@@ -1,8 +1,15 @@
 #include "parser_elite.hpp"
 #include <tree_sitter/api.h>
 #include <spdlog/spdlog.h>
-#include <stack>
+#include <algorithm>
+#include <cstdlib>
+#include <cstring>
 #include <filesystem>
+#include <list>
+#include <memory>
+#include <mutex>
+#include <unordered_map>
+#include <unordered_set>
 
 // 🚀 EXTERNAL SYMBOL LINKING
 // NOTE: TS, JS, and JSON are disabled until their grammar libs are linked.
@@ -18,9 +25,11 @@ namespace code_assistance::elite {
 
 ASTBooster::ASTBooster() {
     parser_ = ts_parser_new();
+    cursor_ = ts_query_cursor_new();
 }
 
 ASTBooster::~ASTBooster() {
+    if (cursor_) ts_query_cursor_delete(cursor_);
     if (parser_) ts_parser_delete(parser_);
 }
 
@@ -44,7 +53,7 @@ bool ASTBooster::validate_syntax(const std::string& content, const std::string&
 
     ts_parser_set_language(parser_, lang);
     
-    TSTree* tree = ts_parser_parse_string(parser_, nullptr, content.c_str(), (uint32_t)content.length());
+    TSTree* tree = ts_parser_parse_string(parser_, nullptr, content.data(), (uint32_t)content.length());
     if (!tree) return false;
 
     TSNode root = ts_tree_root_node(tree);
@@ -58,69 +67,554 @@ bool ASTBooster::validate_syntax(const std::string& content, const std::string&
     return !has_error;
 }
 
-std::vector<CodeNode> ASTBooster::extract_symbols(const std::string& path, const std::string& content) {
+// ========================================================================
+// 🌲 SYNTAX TREE CACHE (incremental reparsing)
+// Process-wide, since every thread has its own ASTBooster. An entry is immutable once cached:
+// a parse takes a ts_tree_copy of it (cheap, refcounted) and edits that copy.
+// ========================================================================
+
+namespace {
+
+struct CachedSymbol {
+    std::string name;
+    std::string type;
+    uint32_t start = 0;
+    uint32_t end = 0;
+    uint32_t doc_start = 0; // Start of the comment documenting it, if that comes first; else `start`
+    std::string docstring;
+    std::vector<SymbolRef> refs; // Sorted, unique
+};
+
+struct CachedTree {
+    std::string source; // The bytes `tree` was parsed from: the next version is diffed against them
+    const TSLanguage* lang = nullptr;
+    TSTree* tree = nullptr;
+    std::vector<CachedSymbol> symbols;
+
+    CachedTree() = default;
+    CachedTree(const CachedTree&) = delete;
+    CachedTree& operator=(const CachedTree&) = delete;
+    ~CachedTree() { if (tree) ts_tree_delete(tree); }
+};
+
+// LRU bounded by the bytes of source held (a tree costs a small multiple of its source)
+class TreeCache {
+public:
+    explicit TreeCache(size_t max_bytes) : max_bytes_(max_bytes) {}
+
+    std::shared_ptr<const CachedTree> get(const std::string& path) {
+        std::lock_guard<std::mutex> lock(mutex_);
+        auto it = map_.find(path);
+        if (it == map_.end()) return nullptr;
+        lru_.splice(lru_.begin(), lru_, it->second.list_it);
+        return it->second.entry;
+    }
+
+    void put(const std::string& path, std::shared_ptr<const CachedTree> entry) {
+        std::lock_guard<std::mutex> lock(mutex_);
+        erase_locked(path);
+        if (entry->source.size() > max_bytes_) return;
+        bytes_ += entry->source.size();
+        lru_.push_front(path);
+        map_[path] = {std::move(entry), lru_.begin()};
+        while (bytes_ > max_bytes_ && !lru_.empty()) erase_locked(lru_.back());
+    }
+
+    void erase(const std::string& path) {
+        std::lock_guard<std::mutex> lock(mutex_);
+        erase_locked(path);
+    }
+
+private:
+    struct Slot {
+        std::shared_ptr<const CachedTree> entry;
+        std::list<std::string>::iterator list_it;
+    };
+
+    void erase_locked(const std::string& path) {
+        auto it = map_.find(path);
+        if (it == map_.end()) return;
+        bytes_ -= it->second.entry->source.size();
+        lru_.erase(it->second.list_it);
+        map_.erase(it);
+    }
+
+    size_t max_bytes_;
+    size_t bytes_ = 0;
+    std::mutex mutex_;
+    std::list<std::string> lru_;
+    std::unordered_map<std::string, Slot> map_;
+};
+
+TreeCache g_tree_cache(64u << 20);
+
+TSPoint advance_point(TSPoint point, std::string_view text, size_t from, size_t to) {
+    for (size_t i = from; i < to; ++i) {
+        if (text[i] == '\n') {
+            point.row++;
+            point.column = 0;
+        } else {
+            point.column++;
+        }
+    }
+    return point;
+}
+
+// One edit spanning everything between the common prefix and the common suffix of the two versions.
+// Several keystrokes between saves become one range; tree-sitter only needs a superset of the change.
+TSInputEdit diff_edit(std::string_view before, std::string_view after) {
+    size_t limit = std::min(before.size(), after.size());
+    size_t prefix = std::mismatch(before.begin(), before.begin() + limit, after.begin()).first - before.begin();
+    size_t suffix = 0;
+    while (suffix < limit - prefix && before[before.size() - 1 - suffix] == after[after.size() - 1 - suffix]) suffix++;
+
+    TSInputEdit edit{};
+    edit.start_byte = (uint32_t)prefix;
+    edit.old_end_byte = (uint32_t)(before.size() - suffix);
+    edit.new_end_byte = (uint32_t)(after.size() - suffix);
+    edit.start_point = advance_point({0, 0}, before, 0, prefix);
+    edit.old_end_point = advance_point(edit.start_point, before, prefix, edit.old_end_byte);
+    edit.new_end_point = advance_point(edit.start_point, after, prefix, edit.new_end_byte);
+    return edit;
+}
+
+// ========================================================================
+// 🔎 SYMBOL QUERIES
+// One tree-sitter query per language, compiled on first use and shared by every parser thread (a
+// TSQuery is immutable; only the cursor running it is per-parser). Its captures:
+//   @definition, @name       a symbol and its name
+//   @doc (+ @doc.target)     a docstring: inside the definition, or the comments right before @doc.target
+//   @reference.*             a name a symbol uses: .call, .inherit (base classes), .type
+// ========================================================================
+
+constexpr const char* kCppSymbolQuery = R"scm(
+(function_definition
+  declarator: [
+    (function_declarator declarator: (_) @name)
+    (pointer_declarator declarator: (function_declarator declarator: (_) @name))
+    (reference_declarator (function_declarator declarator: (_) @name))
+  ]) @definition
+(class_specifier name: (_) @name body: (field_declaration_list)) @definition
+(struct_specifier name: (_) @name body: (field_declaration_list)) @definition
+
+((comment)+ @doc . [(function_definition) (class_specifier) (struct_specifier) (template_declaration)] @doc.target)
+
+(call_expression function: [
+  (identifier) @reference.call
+  (qualified_identifier name: (identifier) @reference.call)
+  (field_expression field: (field_identifier) @reference.call)
+  (template_function name: (identifier) @reference.call)
+])
+(base_class_clause [
+  (type_identifier) @reference.inherit
+  (qualified_identifier name: (type_identifier) @reference.inherit)
+  (template_type name: (type_identifier) @reference.inherit)
+])
+(type_identifier) @reference.type
+)scm";
+
+constexpr const char* kPythonSymbolQuery = R"scm(
+(function_definition name: (identifier) @name) @definition
+(class_definition name: (identifier) @name) @definition
+
+(function_definition body: (block . (expression_statement (string) @doc)))
+(class_definition body: (block . (expression_statement (string) @doc)))
+
+(call function: [
+  (identifier) @reference.call
+  (attribute attribute: (identifier) @reference.call)
+])
+(class_definition superclasses: (argument_list [
+  (identifier) @reference.inherit
+  (attribute attribute: (identifier) @reference.inherit)
+]))
+(type (identifier) @reference.type)
+)scm";
+
+enum class Capture : uint8_t { OTHER, DEFINITION, NAME, DOC, DOC_TARGET, REF_CALL, REF_INHERIT, REF_TYPE };
+
+struct LanguageQuery {
+    TSQuery* query = nullptr;          // nullptr: did not compile (the caller falls back to the bracket parser)
+    std::vector<Capture> captures;     // By capture id
+    std::vector<TSSymbol> definitions; // Node types that are symbols
+    TSSymbol comment = 0;              // 0 = the grammar has no such node
+    TSSymbol wrapper = 0;              // template_declaration: documented as a whole, defines what it wraps
+
+    bool is_definition(TSSymbol symbol) const {
+        return std::find(definitions.begin(), definitions.end(), symbol) != definitions.end();
+    }
+};
+
+TSSymbol symbol_named(const TSLanguage* lang, const char* name) {
+    return ts_language_symbol_for_name(lang, name, (uint32_t)std::strlen(name), true);
+}
+
+// Compiled once per language for the life of the process
+const LanguageQuery& language_query(const TSLanguage* lang) {
+    static std::mutex mutex;
+    static std::unordered_map<const TSLanguage*, std::unique_ptr<LanguageQuery>> compiled;
+
+    std::lock_guard<std::mutex> lock(mutex);
+    auto& slot = compiled[lang];
+    if (slot) return *slot;
+    slot = std::make_unique<LanguageQuery>();
+    LanguageQuery& lq = *slot;
+
+    const char* source = nullptr;
+    if (lang == tree_sitter_cpp()) {
+        source = kCppSymbolQuery;
+        lq.definitions = {symbol_named(lang, "function_definition"), symbol_named(lang, "class_specifier"),
+                          symbol_named(lang, "struct_specifier")};
+        lq.comment = symbol_named(lang, "comment");
+        lq.wrapper = symbol_named(lang, "template_declaration");
+    } else if (lang == tree_sitter_python()) {
+        source = kPythonSymbolQuery;
+        lq.definitions = {symbol_named(lang, "function_definition"), symbol_named(lang, "class_definition")};
+        lq.comment = symbol_named(lang, "comment");
+    }
+    if (!source) return lq;
+
+    uint32_t error_offset = 0;
+    TSQueryError error = TSQueryErrorNone;
+    lq.query = ts_query_new(lang, source, (uint32_t)std::strlen(source), &error_offset, &error);
+    if (!lq.query) {
+        spdlog::error("🔎 Symbol query does not compile against its grammar (error {} at byte {})", (int)error, error_offset);
+        return lq;
+    }
+
+    uint32_t count = ts_query_capture_count(lq.query);
+    lq.captures.resize(count, Capture::OTHER);
+    for (uint32_t id = 0; id < count; ++id) {
+        uint32_t length = 0;
+        const char* name = ts_query_capture_name_for_id(lq.query, id, &length);
+        std::string_view capture(name, length);
+        if (capture == "definition") lq.captures[id] = Capture::DEFINITION;
+        else if (capture == "name") lq.captures[id] = Capture::NAME;
+        else if (capture == "doc") lq.captures[id] = Capture::DOC;
+        else if (capture == "doc.target") lq.captures[id] = Capture::DOC_TARGET;
+        else if (capture == "reference.call") lq.captures[id] = Capture::REF_CALL;
+        else if (capture == "reference.inherit") lq.captures[id] = Capture::REF_INHERIT;
+        else if (capture == "reference.type") lq.captures[id] = Capture::REF_TYPE;
+    }
+    return lq;
+}
+
+// Comment markers and string quotes off every line, blank edge lines dropped
+std::string clean_docstring(std::string_view raw) {
+    std::string out;
+    size_t pos = 0;
+    while (pos <= raw.size()) {
+        size_t eol = raw.find('\n', pos);
+        if (eol == std::string_view::npos) eol = raw.size();
+        std::string_view line = raw.substr(pos, eol - pos);
+        size_t b = line.find_first_not_of(" \t\r");
+        if (b != std::string_view::npos) {
+            line = line.substr(b);
+            line = line.substr(std::min(line.size(), line.find_first_not_of("/*!\"'")));
+            line = line.substr(std::min(line.size(), line.find_first_not_of(" \t")));
+            size_t e = line.find_last_not_of(" \t\r*/\"'");
+            line = e == std::string_view::npos ? std::string_view() : line.substr(0, e + 1);
+        } else {
+            line = {};
+        }
+        if (!line.empty() || !out.empty()) {
+            out.append(line);
+            out.push_back('\n');
+        }
+        pos = eol + 1;
+    }
+    while (!out.empty() && out.back() == '\n') out.pop_back();
+    return out;
+}
+
+struct Extent {
+    uint32_t start = 0;
+    uint32_t end = UINT32_MAX;
+};
+
+// Every definition in `range` of the tree, each with its docstring and the names it references
+// (attributed to the innermost definition around them). Source order, outer before nested.
+std::vector<CachedSymbol> query_symbols(TSQueryCursor* cursor, const LanguageQuery& lq, TSNode root,
+                                        std::string_view content, Extent range) {
+    struct Use {
+        uint32_t start;
+        uint32_t end;
+        Capture kind;
+    };
+    std::vector<CachedSymbol> symbols;
+    std::vector<Use> uses;
+    std::unordered_set<uint32_t> name_starts;
+    std::unordered_map<uint32_t, std::pair<uint32_t, uint32_t>> docs_before; // Documented definition start -> comments
+
+    ts_query_cursor_set_byte_range(cursor, range.start, range.end);
+    ts_query_cursor_exec(cursor, lq.query, root);
+    TSQueryMatch match;
+    while (ts_query_cursor_next_match(cursor, &match)) {
+        TSNode def{}, name{}, target{};
+        uint32_t doc_start = UINT32_MAX, doc_end = 0;
+        for (uint16_t i = 0; i < match.capture_count; ++i) {
+            const TSQueryCapture& cap = match.captures[i];
+            Capture kind = lq.captures[cap.index];
+            switch (kind) {
+                case Capture::DEFINITION: def = cap.node; break;
+                case Capture::NAME: name = cap.node; break;
+                case Capture::DOC_TARGET: target = cap.node; break;
+                case Capture::DOC:
+                    doc_start = std::min(doc_start, ts_node_start_byte(cap.node));
+                    doc_end = std::max(doc_end, ts_node_end_byte(cap.node));
+                    break;
+                case Capture::OTHER: break;
+                default: uses.push_back({ts_node_start_byte(cap.node), ts_node_end_byte(cap.node), kind}); break;
+            }
+        }
+
+        if (!ts_node_is_null(def)) {
+            CachedSymbol sym;
+            sym.type = ts_node_type(def);
+            sym.start = ts_node_start_byte(def);
+            sym.end = ts_node_end_byte(def);
+            sym.doc_start = sym.start;
+            sym.name = "anonymous";
+            if (!ts_node_is_null(name)) {
+                uint32_t start = ts_node_start_byte(name);
+                sym.name.assign(content.substr(start, ts_node_end_byte(name) - start));
+                name_starts.insert(start);
+            }
+            symbols.push_back(std::move(sym));
+        } else if (doc_start < doc_end && !ts_node_is_null(target)) {
+            // A wrapper's comments document the definition it wraps (its last named child)
+            if (lq.wrapper && ts_node_symbol(target) == lq.wrapper) {
+                uint32_t count = ts_node_named_child_count(target);
+                if (count > 0) target = ts_node_named_child(target, count - 1);
+            }
+            // A run of comments may match once per suffix: the longest wins
+            auto [it, fresh] = docs_before.try_emplace(ts_node_start_byte(target), doc_start, doc_end);
+            if (!fresh && doc_start < it->second.first) it->second = {doc_start, doc_end};
+        } else if (doc_start < doc_end) {
+            uses.push_back({doc_start, doc_end, Capture::DOC});
+        }
+    }
+
+    std::sort(symbols.begin(), symbols.end(), [](const CachedSymbol& a, const CachedSymbol& b) {
+        return a.start != b.start ? a.start < b.start : a.end > b.end;
+    });
+    std::sort(uses.begin(), uses.end(), [](const Use& a, const Use& b) { return a.start < b.start; });
+
+    // One sweep: `open` holds the definitions around the current position, innermost on top
+    std::vector<size_t> open;
+    size_t next = 0;
+    for (const auto& use : uses) {
+        if (use.kind != Capture::DOC && name_starts.count(use.start)) continue; // A definition's own name
+        while (next < symbols.size() && symbols[next].start <= use.start) {
+            while (!open.empty() && symbols[open.back()].end <= symbols[next].start) open.pop_back();
+            open.push_back(next++);
+        }
+        while (!open.empty() && symbols[open.back()].end < use.end) open.pop_back();
+        if (open.empty()) continue; // File-level code
+        CachedSymbol& sym = symbols[open.back()];
+        std::string_view text = content.substr(use.start, use.end - use.start);
+        if (use.kind == Capture::DOC) {
+            if (sym.docstring.empty()) sym.docstring = clean_docstring(text);
+        } else {
+            RefKind kind = use.kind == Capture::REF_INHERIT ? RefKind::INHERIT
+                         : use.kind == Capture::REF_TYPE    ? RefKind::TYPE
+                                                            : RefKind::CALL;
+            sym.refs.push_back({std::string(text), kind});
+        }
+    }
+
+    for (auto& sym : symbols) {
+        auto doc = docs_before.find(sym.start);
+        if (doc != docs_before.end()) {
+            sym.doc_start = doc->second.first;
+            sym.docstring = clean_docstring(content.substr(doc->second.first, doc->second.second - doc->second.first));
+        }
+        std::sort(sym.refs.begin(), sym.refs.end());
+        // A base class also matches as a type use: the inheritance edge says more
+        auto redundant = [](const SymbolRef& kept, const SymbolRef& next) {
+            return kept == next || (kept.name == next.name && kept.kind == RefKind::INHERIT && next.kind == RefKind::TYPE);
+        };
+        sym.refs.erase(std::unique(sym.refs.begin(), sym.refs.end(), redundant), sym.refs.end());
+    }
+    return symbols;
+}
+
+// Where the query runs again after an incremental parse that changed [lo, hi]: a range holding every
+// definition that touches it, and the comments documenting those. The outermost definition around the
+// change if there is one; else the children of the smallest node around it that overlap the change.
+Extent requery_extent(TSNode root, const LanguageQuery& lq, uint32_t lo, uint32_t hi) {
+    uint32_t a = lo > 0 ? lo - 1 : 0;
+    uint32_t b = std::min(hi + 1, ts_node_end_byte(root));
+    TSNode around = ts_node_named_descendant_for_byte_range(root, a, b);
+    if (ts_node_is_null(around)) return {};
+
+    TSNode first = around, last = around;
+    bool in_definition = false;
+    for (TSNode p = around; !ts_node_is_null(p); p = ts_node_parent(p)) {
+        if (lq.is_definition(ts_node_symbol(p))) {
+            first = last = p;
+            in_definition = true;
+        }
+    }
+    if (!in_definition) {
+        bool found = false;
+        uint32_t count = ts_node_named_child_count(around);
+        for (uint32_t i = 0; i < count; ++i) {
+            TSNode child = ts_node_named_child(around, i);
+            if (ts_node_start_byte(child) > b) break;
+            if (ts_node_end_byte(child) < a) continue;
+            if (!found) first = child;
+            last = child;
+            found = true;
+        }
+    }
+
+    // Comments go with the definition after them, so a range ending in comments takes that along,
+    // and one starting at a definition takes its comments
+    while (lq.comment && ts_node_symbol(last) == lq.comment) {
+        TSNode next = ts_node_next_named_sibling(last);
+        if (ts_node_is_null(next)) break;
+        last = next;
+    }
+    if (lq.wrapper) {
+        TSNode parent = ts_node_parent(first);
+        if (!ts_node_is_null(parent) && ts_node_symbol(parent) == lq.wrapper) first = parent;
+    }
+    while (lq.comment) {
+        TSNode prev = ts_node_prev_named_sibling(first);
+        if (ts_node_is_null(prev) || ts_node_symbol(prev) != lq.comment) break;
+        first = prev;
+    }
+    return {ts_node_start_byte(first), ts_node_end_byte(last)};
+}
+
+} // namespace
+
+void ASTBooster::forget_tree(const std::string& path) {
+    g_tree_cache.erase(path);
+}
+
+std::vector<CodeNode> ASTBooster::extract_symbols(const std::string& path, const FileBuffer::Ptr& source) {
     std::vector<CodeNode> nodes;
+    std::string_view content = source->view();
     std::string ext = std::filesystem::path(path).extension().string();
     const TSLanguage* lang = get_lang(ext);
     
     if (!lang) return {}; // Returns empty vector if language not supported
+    const LanguageQuery& lq = language_query(lang);
+    if (!lq.query) return {};
 
     ts_parser_set_language(parser_, lang);
-    TSTree* tree = ts_parser_parse_string(parser_, nullptr, content.c_str(), (uint32_t)content.length());
+
+    // 🌲 Last version of this file still cached: edit its tree and let tree-sitter reuse the rest
+    std::shared_ptr<const CachedTree> cached = incremental_ ? g_tree_cache.get(path) : nullptr;
+    if (cached && cached->lang != lang) cached.reset();
+    TSTree* old_tree = nullptr;
+    TSInputEdit edit{};
+    if (cached) {
+        edit = diff_edit(cached->source, content);
+        old_tree = ts_tree_copy(cached->tree);
+        ts_tree_edit(old_tree, &edit);
+    }
+
+    TSTree* tree = ts_parser_parse_string(parser_, old_tree, content.data(), (uint32_t)content.length());
+    if (!tree) {
+        if (old_tree) ts_tree_delete(old_tree);
+        return {};
+    }
     TSNode root = ts_tree_root_node(tree);
 
-    std::stack<TSNode> traversal_stack;
-    traversal_stack.push(root);
-
-    while (!traversal_stack.empty()) {
-        TSNode node = traversal_stack.top();
-        traversal_stack.pop();
-
-        std::string type = ts_node_type(node);
-        
-        bool is_symbol = (
-            type == "function_definition" || 
-            type == "class_specifier" || 
-            type == "class_definition" ||
-            type == "method_definition" || 
-            type == "struct_specifier"
-        );
-        
-        if (is_symbol) {
-            CodeNode info;
-            info.file_path = path;
-            info.type = type;
-
-            info.name = "anonymous";
-            uint32_t child_count = ts_node_child_count(node);
-            for (uint32_t i = 0; i < child_count; i++) {
-                TSNode child = ts_node_child(node, i);
-                std::string c_type = ts_node_type(child);
-                if (c_type == "identifier" || c_type == "type_identifier" || c_type == "name") {
-                    uint32_t start = ts_node_start_byte(child);
-                    uint32_t end = ts_node_end_byte(child);
-                    info.name = content.substr(start, end - start);
-                    break;
-                }
-            }
+    // Byte ranges (new coordinates) whose symbols are extracted again: the edit itself, plus every
+    // range where the new tree's structure differs from the edited old one. Empty = full parse.
+    std::vector<std::pair<uint32_t, uint32_t>> dirty;
+    if (old_tree) {
+        dirty.emplace_back(edit.start_byte, edit.new_end_byte);
+        uint32_t count = 0;
+        TSRange* ranges = ts_tree_get_changed_ranges(old_tree, tree, &count);
+        for (uint32_t i = 0; i < count; ++i) dirty.emplace_back(ranges[i].start_byte, ranges[i].end_byte);
+        free(ranges);
+        ts_tree_delete(old_tree);
+    }
+    // Inclusive on purpose: an edit right at a symbol's edge re-extracts it
+    auto touches_dirty = [&](uint32_t start, uint32_t end) {
+        for (const auto& [a, b] : dirty) {
+            if (start <= b && a <= end) return true;
+        }
+        return false;
+    };
 
-            uint32_t start = ts_node_start_byte(node);
-            uint32_t end = ts_node_end_byte(node);
-            info.content = content.substr(start, end - start);
-            
-            info.id = path + "::" + info.name;
-            info.weights["structural"] = 0.8;
+    std::vector<CachedSymbol> symbols;
 
-            nodes.push_back(info);
+    // Symbols clear of every dirty range are carried over, shifted past the edit
+    if (cached) {
+        int64_t delta = (int64_t)edit.new_end_byte - (int64_t)edit.old_end_byte;
+        for (const auto& sym : cached->symbols) {
+            CachedSymbol moved = sym;
+            if (sym.doc_start >= edit.old_end_byte) {
+                moved.start = (uint32_t)(sym.start + delta);
+                moved.end = (uint32_t)(sym.end + delta);
+                moved.doc_start = (uint32_t)(sym.doc_start + delta);
+            } else if (sym.end > edit.start_byte) {
+                continue; // Overlapped the edit
+            }
+            if (!touches_dirty(moved.doc_start, moved.end)) symbols.push_back(std::move(moved));
         }
+    }
+    size_t reused = symbols.size();
 
-        uint32_t count = ts_node_child_count(node);
-        for (uint32_t i = 0; i < count; i++) {
-            traversal_stack.push(ts_node_child(node, i));
+    // Everything else comes from the new tree: the query runs only where something changed
+    Extent range;
+    if (!dirty.empty()) {
+        uint32_t lo = UINT32_MAX, hi = 0;
+        for (const auto& [a, b] : dirty) {
+            lo = std::min(lo, a);
+            hi = std::max(hi, b);
         }
+        range = requery_extent(root, lq, lo, hi);
+    }
+    for (auto& sym : query_symbols(cursor_, lq, root, content, range)) {
+        if (!dirty.empty() && !touches_dirty(sym.doc_start, sym.end)) continue; // Carried over above
+        symbols.push_back(std::move(sym));
+    }
+
+    // Source order, outer symbols before the ones nested in them
+    std::sort(symbols.begin(), symbols.end(), [](const CachedSymbol& a, const CachedSymbol& b) {
+        return a.start != b.start ? a.start < b.start : a.end > b.end;
+    });
+
+    nodes.reserve(symbols.size());
+    for (const auto& sym : symbols) {
+        CodeNode info;
+        info.file_path = path;
+        info.type = sym.type;
+        info.name = sym.name;
+        info.docstring = sym.docstring;
+        info.references = sym.refs;
+        info.source = source;
+        info.source_offset = sym.start;
+        info.source_length = sym.end - sym.start;
+        info.id = path + "::" + info.name;
+        info.weights["structural"] = 0.8;
+        nodes.push_back(std::move(info));
+    }
+    make_node_ids_unique(nodes);
+
+    if (cached) {
+        spdlog::debug("🌲 {} reparsed incrementally: {} dirty ranges, {}/{} symbols carried over",
+                      path, dirty.size(), reused, symbols.size());
+    }
+
+    if (incremental_) {
+        // The cache needs its own copy: it outlives this sync and the file buffers its nodes share
+        auto entry = std::make_shared<CachedTree>();
+        entry->source.assign(content);
+        entry->lang = lang;
+        entry->tree = tree;
+        entry->symbols = std::move(symbols);
+        g_tree_cache.put(path, std::move(entry));
+    } else {
+        ts_tree_delete(tree);
     }
-    
-    ts_tree_delete(tree);
     return nodes;
 }
 
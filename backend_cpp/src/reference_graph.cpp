@@ -0,0 +1,195 @@
+#include "reference_graph.hpp"
+#include <algorithm>
+#include <chrono>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <string_view>
+#include <unordered_map>
+#include <spdlog/spdlog.h>
+
+namespace code_assistance {
+
+namespace fs = std::filesystem;
+
+static constexpr char kRefsMagic[8] = {'S', 'F', 'R', 'E', 'F', 'S', '\0', '\0'};
+static constexpr uint32_t kRefsVersion = 1;
+// A name defined in more places than this (get, run, init, ...) says nothing about which one is meant
+static constexpr size_t kMaxFanout = 8;
+
+struct RefsHeader {
+    char magic[8];
+    uint32_t version;
+    uint32_t reserved;
+    uint64_t vertex_count;
+    uint64_t edge_count;
+    int64_t stamp;
+};
+
+// "ns::Type::method" -> "method": references are unqualified, so definitions are looked up that way
+static std::string_view unqualified(std::string_view name) {
+    size_t cut = name.find_last_of(':');
+    return cut == std::string_view::npos ? name : name.substr(cut + 1);
+}
+
+static std::string_view file_name(std::string_view path) {
+    size_t cut = path.find_last_of("/\\");
+    return cut == std::string_view::npos ? path : path.substr(cut + 1);
+}
+
+static bool is_type_node(const std::string& type) {
+    return type == "class_specifier" || type == "struct_specifier" || type == "class_definition";
+}
+
+std::shared_ptr<ReferenceGraph> ReferenceGraph::link(const std::vector<std::pair<long, const CodeNode*>>& nodes) {
+    auto start = std::chrono::high_resolution_clock::now();
+    auto graph = std::make_shared<ReferenceGraph>();
+    const size_t n = nodes.size();
+    graph->faiss_ids_.resize(n);
+
+    // 1. Symbol table: unqualified definition name -> vertices. File nodes by name and stem, for imports.
+    std::unordered_map<std::string_view, std::vector<uint32_t>> symbols;
+    std::unordered_map<std::string_view, std::vector<uint32_t>> files;
+    std::vector<uint8_t> is_type(n, 0);
+    for (uint32_t v = 0; v < n; ++v) {
+        const CodeNode& node = *nodes[v].second;
+        graph->faiss_ids_[v] = nodes[v].first;
+        if (node.type == "file") {
+            std::string_view name = file_name(node.file_path);
+            files[name].push_back(v);
+            size_t dot = name.rfind('.');
+            if (dot != std::string_view::npos && dot > 0) files[name.substr(0, dot)].push_back(v);
+            continue;
+        }
+        if (node.name.empty() || node.name == "anonymous") continue;
+        symbols[unqualified(node.name)].push_back(v);
+        is_type[v] = is_type_node(node.type);
+    }
+
+    // 2. Link: each vertex resolves its own references, nothing shared is written
+    std::vector<std::vector<std::pair<uint32_t, RefKind>>> edges(n);
+    #pragma omp parallel for schedule(dynamic, 256)
+    for (long i = 0; i < (long)n; ++i) {
+        const uint32_t v = (uint32_t)i;
+        const CodeNode& node = *nodes[v].second;
+        auto& out = edges[v];
+
+        auto resolve = [&](const auto& table, std::string_view name, RefKind kind) {
+            auto it = table.find(name);
+            if (it == table.end()) return;
+            auto fits = [&](uint32_t c) {
+                return c != v && (kind == RefKind::CALL || kind == RefKind::IMPORT || is_type[c]);
+            };
+            // Definitions in the referring file shadow the rest of the project
+            bool local = false;
+            if (kind != RefKind::IMPORT) {
+                for (uint32_t c : it->second) local |= fits(c) && nodes[c].second->file_path == node.file_path;
+            }
+            if (!local && it->second.size() > kMaxFanout) return;
+            for (uint32_t c : it->second) {
+                if (fits(c) && (!local || nodes[c].second->file_path == node.file_path)) out.emplace_back(c, kind);
+            }
+        };
+        for (const auto& ref : node.references) resolve(symbols, unqualified(ref.name), ref.kind);
+        for (const auto& dep : node.dependencies) resolve(files, file_name(dep), RefKind::IMPORT);
+
+        std::sort(out.begin(), out.end());
+        out.erase(std::unique(out.begin(), out.end()), out.end());
+    }
+
+    // 3. Pack into CSR
+    graph->offsets_.assign(n + 1, 0);
+    for (size_t v = 0; v < n; ++v) graph->offsets_[v + 1] = graph->offsets_[v] + edges[v].size();
+    graph->targets_.resize(graph->offsets_[n]);
+    graph->kinds_.resize(graph->offsets_[n]);
+    #pragma omp parallel for schedule(static)
+    for (long i = 0; i < (long)n; ++i) {
+        uint64_t at = graph->offsets_[i];
+        for (const auto& [target, kind] : edges[i]) {
+            graph->targets_[at] = target;
+            graph->kinds_[at] = kind;
+            at++;
+        }
+    }
+
+    double ms = std::chrono::duration<double, std::milli>(std::chrono::high_resolution_clock::now() - start).count();
+    spdlog::info("🔗 Reference graph linked: {} nodes, {} edges in {:.2f} ms", n, graph->edge_count(), ms);
+    return graph;
+}
+
+int64_t ReferenceGraph::vertex_of(long faiss_id) const {
+    auto it = std::lower_bound(faiss_ids_.begin(), faiss_ids_.end(), faiss_id);
+    if (it == faiss_ids_.end() || *it != faiss_id) return -1;
+    return it - faiss_ids_.begin();
+}
+
+bool ReferenceGraph::save(const std::string& file, int64_t stamp) const {
+    RefsHeader h{};
+    std::memcpy(h.magic, kRefsMagic, sizeof(kRefsMagic));
+    h.version = kRefsVersion;
+    h.vertex_count = faiss_ids_.size();
+    h.edge_count = targets_.size();
+    h.stamp = stamp;
+    std::vector<int64_t> ids(faiss_ids_.begin(), faiss_ids_.end());
+
+    std::string tmp = file + ".tmp";
+    {
+        std::ofstream out(tmp, std::ios::binary | std::ios::trunc);
+        if (!out) return false;
+        out.write(reinterpret_cast<const char*>(&h), sizeof(h));
+        out.write(reinterpret_cast<const char*>(ids.data()), ids.size() * sizeof(int64_t));
+        out.write(reinterpret_cast<const char*>(offsets_.data()), offsets_.size() * sizeof(uint64_t));
+        out.write(reinterpret_cast<const char*>(targets_.data()), targets_.size() * sizeof(uint32_t));
+        out.write(reinterpret_cast<const char*>(kinds_.data()), kinds_.size() * sizeof(RefKind));
+        if (!out) return false;
+    }
+    std::error_code ec;
+    fs::rename(tmp, file, ec);
+    if (ec) {
+        spdlog::error("🔗 Cannot replace {}: {}", file, ec.message());
+        return false;
+    }
+    return true;
+}
+
+std::shared_ptr<ReferenceGraph> ReferenceGraph::load(const std::string& file, int64_t& stamp) {
+    std::error_code ec;
+    uint64_t size = fs::file_size(file, ec);
+    std::ifstream in(file, std::ios::binary);
+    RefsHeader h{};
+    if (ec || !in || !in.read(reinterpret_cast<char*>(&h), sizeof(h))) return nullptr;
+    if (std::memcmp(h.magic, kRefsMagic, sizeof(kRefsMagic)) != 0 || h.version != kRefsVersion) return nullptr;
+
+    uint64_t n = h.vertex_count, e = h.edge_count;
+    uint64_t expected = sizeof(h) + n * sizeof(int64_t) + (n + 1) * sizeof(uint64_t) + e * (sizeof(uint32_t) + sizeof(RefKind));
+    if (n >= UINT32_MAX || e > size || expected != size) {
+        spdlog::warn("🔗 {} is truncated or corrupt: relinking", file);
+        return nullptr;
+    }
+
+    auto graph = std::make_shared<ReferenceGraph>();
+    std::vector<int64_t> ids(n);
+    graph->offsets_.resize(n + 1);
+    graph->targets_.resize(e);
+    graph->kinds_.resize(e);
+    in.read(reinterpret_cast<char*>(ids.data()), n * sizeof(int64_t));
+    in.read(reinterpret_cast<char*>(graph->offsets_.data()), (n + 1) * sizeof(uint64_t));
+    in.read(reinterpret_cast<char*>(graph->targets_.data()), e * sizeof(uint32_t));
+    in.read(reinterpret_cast<char*>(graph->kinds_.data()), e * sizeof(RefKind));
+    if (!in) return nullptr;
+    graph->faiss_ids_.assign(ids.begin(), ids.end());
+
+    // Every span and target must stay in bounds before anything walks it
+    bool valid = graph->offsets_[0] == 0 && graph->offsets_[n] == e &&
+                 std::is_sorted(graph->offsets_.begin(), graph->offsets_.end()) &&
+                 std::is_sorted(graph->faiss_ids_.begin(), graph->faiss_ids_.end()) &&
+                 std::all_of(graph->targets_.begin(), graph->targets_.end(), [&](uint32_t t) { return t < n; });
+    if (!valid) {
+        spdlog::warn("🔗 {} is truncated or corrupt: relinking", file);
+        return nullptr;
+    }
+    stamp = h.stamp;
+    return graph;
+}
+
+} // namespace code_assistance
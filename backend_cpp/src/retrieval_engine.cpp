@@ -1,11 +1,11 @@
 #include "retrieval_engine.hpp"
-#include <deque>
 #include <cmath>
 #include <algorithm>
 #include <unordered_set>
 #include <spdlog/spdlog.h>
 #include <chrono> 
 #include "SystemMonitor.hpp" // Required for telemetry
+#include "reference_graph.hpp"
 #include <sstream>
 
 namespace code_assistance {
@@ -16,17 +16,12 @@ std::vector<RetrievalResult> RetrievalEngine::retrieve(
     int max_nodes,
     bool use_graph)
 {
-    // --- TELEMETRY START ---
-    auto start = std::chrono::high_resolution_clock::now();
-
     // 1. Search (Get seeds)
-    size_t total_nodes = vector_store_->get_all_nodes().size();
-    int k = (total_nodes < 10) ? (int)total_nodes : 20; 
-
+    size_t total_nodes = vector_store_->size();
     auto seeds = vector_store_->search(query_embedding, 20);
     
-    // 2. Expand
-    int hops = (total_nodes < 10) ? 1 : 2;
+    // 2. Expand (no hops without the graph: the seeds alone are scored)
+    int hops = !use_graph ? 0 : (total_nodes < 10) ? 1 : 2;
     auto expanded = exponential_graph_expansion(seeds, 50, hops, 0.9);
     
     // 3. Score
@@ -52,7 +47,7 @@ std::vector<RetrievalResult> RetrievalEngine::retrieve(
         }
     }
 
-    if (unique_results.size() > max_nodes) {
+    if (unique_results.size() > (size_t)std::max(max_nodes, 0)) {
         unique_results.resize(max_nodes);
     }
 
@@ -108,45 +103,53 @@ std::vector<RetrievalResult> RetrievalEngine::exponential_graph_expansion(
 {
     spdlog::info("Starting graph expansion with {} seed nodes", seed_nodes.size());
 
-    std::unordered_map<std::string, RetrievalResult> visited;
-    std::deque<std::tuple<std::shared_ptr<CodeNode>, int, double>> queue;
+    // 🔗 BFS over vertex ids of the store's reference graph: no string lookups per edge
+    auto graph = vector_store_->reference_graph();
+    if (!graph) graph = std::make_shared<const ReferenceGraph>(); // Never linked: the seeds alone
+    struct Frontier { uint32_t vertex; int dist; double score; };
+
+    std::vector<RetrievalResult> results;
+    std::vector<uint8_t> seen(graph->size(), 0);
+    std::unordered_set<std::string> seed_ids;
+    std::vector<Frontier> queue;
 
     for (const auto& seed : seed_nodes) {
-        if (visited.find(seed.node->id) == visited.end()) {
-            visited[seed.node->id] = {seed.node, seed.faiss_score, 0.0, 0};
-            queue.emplace_back(seed.node, 0, seed.faiss_score);
+        if (!seed.node) continue;
+        int64_t v = graph->vertex_of(seed.faiss_id);
+        if (v >= 0 ? seen[v] : seed_ids.count(seed.node->id) > 0) continue;
+        if (v >= 0) {
+            seen[v] = 1;
+            queue.push_back({(uint32_t)v, 0, seed.faiss_score});
+        } else {
+            seed_ids.insert(seed.node->id); // Not linked (yet): still a result, just not expanded
         }
+        results.push_back({seed.node, seed.faiss_score, 0.0, 0});
     }
 
-    int scanned_count = visited.size(); 
-
-    while (!queue.empty() && visited.size() < max_nodes) {
-        auto [curr, dist, base_score] = queue.front();
-        queue.pop_front();
+    int scanned_count = results.size();
 
+    for (size_t head = 0; head < queue.size() && results.size() < (size_t)max_nodes; ++head) {
+        auto [curr, dist, base_score] = queue[head];
         if (dist >= max_hops) continue;
 
-        for (const auto& dep_name : curr->dependencies) {
-            auto candidate_node = vector_store_->get_node_by_name(dep_name);
+        int new_dist = dist + 1;
+        double new_score = base_score * std::exp(-alpha * new_dist);
+        for (uint32_t target : graph->targets(curr)) {
+            scanned_count++;
+            if (seen[target]) continue;
+            seen[target] = 1;
 
-            scanned_count++; 
+            auto candidate_node = vector_store_->get_node(graph->faiss_id(target));
+            if (!candidate_node) continue; // Removed since the graph was linked
 
-            if (candidate_node && visited.find(candidate_node->id) == visited.end()) {
-                int new_dist = dist + 1;
-                double new_score = base_score * std::exp(-alpha * new_dist);
-                
-                visited[candidate_node->id] = {candidate_node, new_score, 0.0, new_dist};
-                queue.emplace_back(candidate_node, new_dist, new_score);
-            }
+            results.push_back({candidate_node, new_score, 0.0, new_dist});
+            queue.push_back({target, new_dist, new_score});
+            if (results.size() >= (size_t)max_nodes) break;
         }
     }
 
     SystemMonitor::global_graph_nodes_scanned.store(scanned_count);
-    
-    std::vector<RetrievalResult> results;
-    for(auto const& [key, val] : visited) {
-        results.push_back(val);
-    }
+
     spdlog::info("✅ Graph expansion complete. {} nodes selected.", results.size());
     return results;
 }
@@ -0,0 +1,157 @@
+#include "sync_manifest.hpp"
+#include <xxhash.h>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <fstream>
+#include <nlohmann/json.hpp>
+#include <spdlog/spdlog.h>
+
+namespace code_assistance {
+
+using json = nlohmann::json;
+
+static constexpr int kManifestVersion = 2;
+// FAT and some network filesystems round mtimes to 2 s
+static constexpr auto kRacyWindow = std::chrono::seconds(2);
+
+static std::string to_hex(uint64_t v) {
+    char buf[17];
+    std::snprintf(buf, sizeof(buf), "%016llx", (unsigned long long)v);
+    return buf;
+}
+
+static uint64_t from_hex(const std::string& s) {
+    return s.empty() ? 0 : std::strtoull(s.c_str(), nullptr, 16);
+}
+
+uint64_t SyncManifest::hash_content(std::string_view data) {
+    // XXH3 picks its SSE2 / AVX2 / NEON path at compile time; GB/s per core, far below read cost
+    return XXH3_64bits(data.data(), data.size());
+}
+
+bool SyncManifest::load(const fs::path& file) {
+    files.clear();
+    dirs.clear();
+    filter_hash = 0;
+    scanned_at = 0;
+    if (!fs::exists(file)) return false;
+
+    json j;
+    try {
+        std::ifstream f(file);
+        j = json::parse(f);
+    } catch (const std::exception& e) {
+        spdlog::warn("⚠️ Unreadable sync manifest {}: {}", file.string(), e.what());
+        return false;
+    }
+    if (!j.is_object()) return false;
+
+    if (j.value("version", 0) != kManifestVersion) {
+        // 🔄 Legacy "size-mtime" strings: keep the stat data so files untouched since then are
+        // hashed once and kept, instead of being re-parsed and re-embedded wholesale
+        for (const auto& [path, stamp] : j.items()) {
+            if (!stamp.is_string()) continue;
+            std::string s = stamp.get<std::string>();
+            size_t dash = s.find('-');
+            if (dash == std::string::npos || dash == 0) continue;
+            ManifestFile entry;
+            entry.size = std::strtoull(s.substr(0, dash).c_str(), nullptr, 10);
+            entry.mtime = std::strtoll(s.substr(dash + 1).c_str(), nullptr, 10);
+            files[path] = entry;
+        }
+        spdlog::info("🔄 Migrating size-mtime manifest ({} files) to content hashes", files.size());
+        return true;
+    }
+
+    filter_hash = from_hex(j.value("filter", ""));
+    scanned_at = j.value("scanned_at", (int64_t)0);
+    for (const auto& [path, e] : j["files"].items()) {
+        files[path] = {from_hex(e.value("h", "")), e.value("s", (uint64_t)0), e.value("m", (int64_t)0)};
+    }
+    for (const auto& [path, e] : j["dirs"].items()) {
+        ManifestDir dir;
+        dir.mtime = e.value("m", (int64_t)0);
+        dir.merkle = from_hex(e.value("h", ""));
+        dir.files = e.value("files", std::vector<std::string>{});
+        dir.dirs = e.value("dirs", std::vector<std::string>{});
+        dirs[path] = std::move(dir);
+    }
+    return true;
+}
+
+bool SyncManifest::save(const fs::path& file) const {
+    json j;
+    j["version"] = kManifestVersion;
+    j["filter"] = to_hex(filter_hash);
+    j["scanned_at"] = scanned_at;
+    j["root"] = to_hex(root());
+
+    json& jf = j["files"] = json::object();
+    for (const auto& [path, e] : files) jf[path] = {{"h", to_hex(e.hash)}, {"s", e.size}, {"m", e.mtime}};
+    json& jd = j["dirs"] = json::object();
+    for (const auto& [path, d] : dirs) {
+        jd[path] = {{"m", d.mtime}, {"h", to_hex(d.merkle)}, {"files", d.files}, {"dirs", d.dirs}};
+    }
+
+    // Write-then-rename: a crash mid-save leaves the previous manifest intact
+    std::error_code ec;
+    fs::create_directories(file.parent_path(), ec);
+    fs::path tmp = file;
+    tmp += ".tmp";
+    {
+        std::ofstream out(tmp, std::ios::binary | std::ios::trunc);
+        if (!out) return false;
+        out << j.dump();
+        if (!out) return false;
+    }
+    fs::rename(tmp, file, ec);
+    if (ec) {
+        spdlog::error("⚠️ Failed to write sync manifest {}: {}", file.string(), ec.message());
+        return false;
+    }
+    return true;
+}
+
+uint64_t SyncManifest::merkle_of(const std::string& dir) {
+    auto it = dirs.find(dir);
+    if (it == dirs.end()) return 0;
+
+    XXH3_state_t* state = XXH3_createState();
+    XXH3_64bits_reset(state);
+    std::string prefix = dir.empty() ? "" : dir + "/";
+    for (const auto& name : it->second.files) {
+        auto f = files.find(prefix + name);
+        uint64_t h = f != files.end() ? f->second.hash : 0;
+        XXH3_64bits_update(state, name.data(), name.size() + 1); // Includes the terminator as separator
+        XXH3_64bits_update(state, &h, sizeof(h));
+    }
+    for (const auto& name : it->second.dirs) {
+        uint64_t h = merkle_of(prefix + name);
+        XXH3_64bits_update(state, "/", 1);
+        XXH3_64bits_update(state, name.data(), name.size() + 1);
+        XXH3_64bits_update(state, &h, sizeof(h));
+    }
+    uint64_t merkle = XXH3_64bits_digest(state);
+    XXH3_freeState(state);
+
+    it->second.merkle = merkle;
+    return merkle;
+}
+
+uint64_t SyncManifest::compute_merkle() {
+    return merkle_of("");
+}
+
+uint64_t SyncManifest::root() const {
+    auto it = dirs.find("");
+    return it != dirs.end() ? it->second.merkle : 0;
+}
+
+bool SyncManifest::settled(int64_t mtime) const {
+    if (scanned_at == 0) return true; // Legacy manifest: stat data was all it ever trusted
+    auto window = std::chrono::duration_cast<fs::file_time_type::duration>(kRacyWindow).count();
+    return mtime + window < scanned_at;
+}
+
+} // namespace code_assistance
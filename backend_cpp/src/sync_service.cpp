@@ -10,15 +10,23 @@
 #include <spdlog/spdlog.h>
 #include <nlohmann/json.hpp>
 #include <map>
+#include <set>
 #include <sstream> 
 #include <omp.h>
 #include <iterator>
+#include <atomic>
+#include <chrono>
+#include <thread>
+#include <mutex>
 
 #include "PrefixTrie.hpp"
 #include "code_graph.hpp"
 #include "sync_service.hpp"
+#include "node_store.hpp"
 #include "parser_elite.hpp" 
 #include "embedding_service.hpp"
+#include "utils/BoundedQueue.hpp"
+#include "utils/TreeReader.hpp"
 
 namespace code_assistance {
 
@@ -31,16 +39,6 @@ struct VisualNode {
 
 // --- UTILITIES ---
 
-uintmax_t get_directory_size(const fs::path& dir) {
-    uintmax_t size = 0;
-    for (const auto& entry : fs::recursive_directory_iterator(dir)) {
-        if (fs::is_regular_file(entry)) {
-            size += fs::file_size(entry);
-        }
-    }
-    return size;
-}
-
 bool paths_are_equal(const fs::path& p1, const fs::path& p2) {
     std::string s1 = p1.string();
     std::string s2 = p2.string();
@@ -87,6 +85,80 @@ bool is_inside(const fs::path& child, const fs::path& parent) {
     return true;
 }
 
+FilterConfig make_filter_config(
+    const std::vector<std::string>& allowed_extensions,
+    const std::vector<std::string>& ignored_paths,
+    const std::vector<std::string>& included_paths
+) {
+    FilterConfig cfg;
+    cfg.blacklist = ignored_paths;
+    cfg.whitelist = included_paths;
+    for (auto ext : allowed_extensions) {
+        if (!ext.empty() && ext[0] == '.') ext = ext.substr(1);
+        std::transform(ext.begin(), ext.end(), ext.begin(), ::tolower);
+        cfg.allowed_extensions.insert(ext);
+    }
+    return cfg;
+}
+
+std::string project_graph_dir(const std::string& project_id) {
+    std::string safe_id = project_id;
+    std::replace(safe_id.begin(), safe_id.end(), ':', '_');
+    std::replace(safe_id.begin(), safe_id.end(), '/', '_');
+    std::replace(safe_id.begin(), safe_id.end(), '\\', '_');
+    return "data/graphs/" + safe_id;
+}
+
+bool is_path_indexed(const PrefixTrie& trie, const FilterConfig& cfg, const std::string& rel_path, bool is_dir) {
+    if (rel_path.empty()) return is_dir;
+
+    auto cursor = trie.root_cursor();
+    size_t pos = 0;
+    while (true) {
+        size_t slash = rel_path.find('/', pos);
+        cursor = trie.descend(cursor, rel_path.substr(pos, slash == std::string::npos ? std::string::npos : slash - pos));
+        if ((cursor.flags & PathFlag::PF_IGNORE) && !(cursor.flags & PathFlag::PF_INCLUDE)) return false;
+        if (slash == std::string::npos) break;
+        pos = slash + 1;
+    }
+    if (is_dir) return true;
+
+    std::string ext = fs::path(rel_path).extension().string();
+    if (!ext.empty() && ext[0] == '.') ext = ext.substr(1);
+    return cfg.allowed_extensions.count(ext) > 0;
+}
+
+// CPU-heavy part of indexing one file: AST symbols where a grammar exists, plus a whole-file node.
+// Every node is a slice of `content`: the file's bytes exist once, however many symbols it has.
+static std::vector<CodeNode> parse_file_nodes(const std::string& rel_path_str, const FileBuffer::Ptr& content,
+                                              elite::ASTBooster& ast_parser) {
+    std::vector<CodeNode> raw_nodes;
+    fs::path p(rel_path_str);
+    std::string ext = p.extension().string();
+
+    if (ext == ".cpp" || ext == ".hpp" || ext == ".py" || ext == ".ts" || ext == ".js") {
+        raw_nodes = ast_parser.extract_symbols(rel_path_str, content);
+        if(raw_nodes.empty()) {
+            raw_nodes = CodeParser::extract_nodes_from_file(rel_path_str, content);
+        }
+    } else {
+        raw_nodes = CodeParser::extract_nodes_from_file(rel_path_str, content);
+    }
+
+    if (raw_nodes.empty() || raw_nodes[0].type != "file") {
+        CodeNode file_node;
+        file_node.name = p.filename().string();
+        file_node.file_path = rel_path_str;
+        file_node.id = rel_path_str;
+        file_node.source = content;
+        file_node.source_length = content->size();
+        file_node.type = "file";
+        file_node.weights["structural"] = 1.0;
+        raw_nodes.push_back(file_node);
+    }
+    return raw_nodes;
+}
+
 // --- SYNC SERVICE IMPLEMENTATION ---
 
 SyncService::SyncService(std::shared_ptr<EmbeddingService> embedding_service)
@@ -108,21 +180,57 @@ bool SyncService::should_index(const fs::path& rel_path, const FilterConfig& cfg
     return cfg.allowed_extensions.count(ext) > 0;
 }
 
-std::unordered_map<std::string, std::shared_ptr<CodeNode>> 
-SyncService::load_existing_nodes(const std::string& storage_path) {
-    std::unordered_map<std::string, std::shared_ptr<CodeNode>> map;
-    fs::path meta_path = fs::path(storage_path) / "vector_store" / "metadata.json";
+SyncService::NodesByFile SyncService::load_existing_nodes(const std::string& project_id, const std::string& storage_path) {
+    NodesByFile by_file;
+    // The project graph's vector store is what ingestion persists; <storage>/vector_store is the pre-graph layout
+    fs::path store_dir = project_graph_dir(project_id);
+    if (!fs::exists(store_dir / "nodes.bin")) store_dir = fs::path(storage_path) / "vector_store";
+
+    // 📦 Binary node store: unchanged files reuse these nodes, so embeddings are materialized.
+    // Its file index hands over each file's records as one run: files materialize in parallel.
+    node_store::Reader reader;
+    if (reader.open((store_dir / "nodes.bin").string(), node_store::Kind::CODE_NODES)) {
+        if (reader.has_file_index()) {
+            auto files = reader.files();
+            std::vector<std::vector<std::shared_ptr<CodeNode>>> groups(files.size());
+            #pragma omp parallel for schedule(dynamic, 16)
+            for (int f = 0; f < (int)files.size(); ++f) {
+                auto& nodes = groups[f];
+                auto records = reader.file_records(files[f]);
+                nodes.reserve(records.size());
+                for (uint64_t i : records) {
+                    if (i < reader.size()) nodes.push_back(std::make_shared<CodeNode>(reader.to_code_node(i, true)));
+                }
+            }
+            by_file.reserve(files.size());
+            for (size_t f = 0; f < files.size(); ++f) {
+                // Agent memory shares the graph's store but belongs to no file
+                if (!reader.str(files[f].file_path).empty()) by_file.emplace(reader.str(files[f].file_path), std::move(groups[f]));
+            }
+        } else {
+            for (size_t i = 0; i < reader.size(); ++i) {
+                auto node = std::make_shared<CodeNode>(reader.to_code_node(i, true));
+                if (!node->file_path.empty()) by_file[node->file_path].push_back(std::move(node));
+            }
+        }
+        return by_file;
+    }
+
+    fs::path meta_path = store_dir / "metadata.json";
     if (fs::exists(meta_path)) {
         try {
             std::ifstream f(meta_path);
             json j = json::parse(f);
-            for (const auto& j_node : j) {
+            const json& nodes = j.is_object() ? j["nodes"] : j;
+            std::unordered_map<std::string, std::shared_ptr<CodeNode>> by_id; // A later duplicate id wins
+            for (const auto& j_node : nodes) {
                 auto node = std::make_shared<CodeNode>(CodeNode::from_json(j_node));
-                map[node->id] = node;
+                by_id[node->id] = node;
             }
+            for (auto& [id, node] : by_id) by_file[node->file_path].push_back(std::move(node));
         } catch (...) {}
     }
-    return map;
+    return by_file;
 }
 
 void SyncService::generate_tree_file(
@@ -175,309 +283,749 @@ void SyncService::generate_tree_file(
     out.close();
 }
 
-std::string SyncService::calculate_file_hash(const fs::path& file_path) {
-    try {
-        auto size = fs::file_size(file_path);
-        auto time = fs::last_write_time(file_path).time_since_epoch().count();
-        return std::to_string(size) + "-" + std::to_string(time);
-    } catch (...) { return "err"; }
+// 🚀 IDENTITY INJECTION: Forces AI to learn the filename
+static std::string embedding_text(const CodeNode& node) {
+    return "This is a " + node.type + " named '" + node.name + "' " +
+           "defined in the file '" + node.file_path + "'.\n" +
+           "Logic Implementation:\n" + utf8_safe_substr(node.text(), 1200);
 }
 
-void SyncService::generate_embeddings_batch(std::vector<std::shared_ptr<CodeNode>>& nodes, int batch_size) {
+void SyncService::generate_embeddings_batch(std::vector<std::shared_ptr<CodeNode>>& nodes) {
     spdlog::info("Generating embeddings for {} nodes...", nodes.size());
-    for (size_t i = 0; i < nodes.size(); i += batch_size) {
-        
-        // 🚀 FIX: Declare the variable here!
-        std::vector<std::string> texts_to_embed; 
-        
-        size_t end = std::min(i + batch_size, nodes.size());
-        for (size_t j = i; j < end; ++j) {
-            // 🚀 IDENTITY INJECTION: Forces AI to learn the filename
-            std::string identity_text = 
-                "This is a " + nodes[j]->type + " named '" + nodes[j]->name + "' " +
-                "defined in the file '" + nodes[j]->file_path + "'.\n" +
-                "Logic Implementation:\n" + utf8_safe_substr(nodes[j]->content, 1200);
-                            
-            texts_to_embed.push_back(identity_text);
+    std::vector<std::string> texts_to_embed;
+    texts_to_embed.reserve(nodes.size());
+    for (const auto& node : nodes) texts_to_embed.push_back(embedding_text(*node));
+
+    try {
+        // The dispatcher cuts this into API-sized batches and runs them across the key pool
+        auto embs = embedding_service_->generate_embeddings_batch(texts_to_embed);
+        for (size_t i = 0; i < embs.size() && i < nodes.size(); ++i) nodes[i]->embedding = std::move(embs[i]);
+    } catch (const std::exception& e) {
+        spdlog::error("   - Batch embedding failed: {}", e.what());
+    }
+}
+
+fs::path SyncService::manifest_path(const std::string& project_id) const {
+    return fs::path("data") / project_id / "manifest.json";
+}
+
+// Hash of everything that shapes a directory listing: changing a filter invalidates every cached listing
+static uint64_t filter_fingerprint(const FilterConfig& cfg) {
+    std::vector<std::string> exts(cfg.allowed_extensions.begin(), cfg.allowed_extensions.end());
+    std::sort(exts.begin(), exts.end());
+    std::string key;
+    for (const auto& e : exts) key += e + '\n';
+    key += '\x1f';
+    for (const auto& b : cfg.blacklist) key += b + '\n';
+    key += '\x1f';
+    for (const auto& w : cfg.whitelist) key += w + '\n';
+    return SyncManifest::hash_content(key);
+}
+
+// ========================================================================
+// 🚰 EMBED + INGEST PIPELINE
+// parse (walk tasks) -> [parsed queue] -> embed workers -> [ingest queue] -> ingest thread -> sink
+// Both queues are bounded: a slow embedding API holds the parser back instead of piling up
+// parsed files, and a slow ingest holds back the embedders. Each stage sees whole files only.
+// There is one embed worker per request the dispatcher can keep in flight; rate limits are its job.
+// ========================================================================
+
+static constexpr size_t kParsedQueueDepth = 256;  // Files parsed ahead of the embedders
+static constexpr size_t kIngestQueueDepth = 4;    // Embedded groups waiting for the sink
+static constexpr size_t kEmbedGroup = 100;        // Nodes per group: one batchEmbedContents request
+
+struct FileUnit {
+    std::string rel_path;
+    std::vector<std::shared_ptr<CodeNode>> nodes; // May be empty: the file's old symbols still retire
+};
+
+class EmbedPipeline {
+public:
+    EmbedPipeline(EmbeddingService& service, const SyncSink& sink)
+        : service_(service), sink_(sink), parsed_(kParsedQueueDepth), embedded_(kIngestQueueDepth),
+          started_(std::chrono::steady_clock::now()) {
+        size_t workers = std::max<size_t>(1, service_.embedding_concurrency());
+        embedders_left_ = workers;
+        for (size_t i = 0; i < workers; ++i) embed_threads_.emplace_back(&EmbedPipeline::embed_loop, this);
+        if (sink_) ingest_thread_ = std::thread(&EmbedPipeline::ingest_loop, this);
+    }
+
+    // Joins on every path out of perform_sync, exceptions included
+    ~EmbedPipeline() { finish(); }
+
+    EmbedPipeline(const EmbedPipeline&) = delete;
+    EmbedPipeline& operator=(const EmbedPipeline&) = delete;
+
+    // Blocks while the embedders are kParsedQueueDepth files behind (backpressure on the walk)
+    void push(FileUnit unit) { parsed_.push(std::move(unit)); }
+
+    // No more files: drains both stages and waits for them
+    void finish() {
+        parsed_.close();
+        for (auto& t : embed_threads_) {
+            if (t.joinable()) t.join();
         }
+        if (ingest_thread_.joinable()) ingest_thread_.join();
+    }
 
-        try {
-            auto embs = embedding_service_->generate_embeddings_batch(texts_to_embed);
-            // Re-map embeddings to nodes
-            for (size_t j = 0; j < embs.size(); ++j) {
-                if (i + j < nodes.size()) nodes[i + j]->embedding = embs[j];
+    size_t embedded_nodes() const { return embedded_nodes_; }
+    size_t groups() const { return groups_; }
+    // Files that never reached the sink whole (read after finish())
+    const std::set<std::string>& failed_files() const { return failed_; }
+
+private:
+    void mark_failed(const std::string& rel_path) {
+        std::lock_guard<std::mutex> lock(failed_mutex_);
+        failed_.insert(rel_path);
+    }
+
+    void embed_loop() {
+        std::vector<FileUnit> group;
+        size_t group_nodes = 0;
+        while (auto unit = parsed_.pop()) {
+            // Never split a file across two groups (the dispatcher splits an oversized one into requests)
+            if (group_nodes > 0 && group_nodes + unit->nodes.size() > kEmbedGroup) {
+                flush(group, group_nodes);
             }
-            if (i + batch_size < nodes.size()) {
-                std::this_thread::sleep_for(std::chrono::milliseconds(2000));
+            group_nodes += unit->nodes.size();
+            group.push_back(std::move(*unit));
+
+            // Full request, or a partial one the dispatcher can send right away while the parser catches up
+            if (group_nodes >= kEmbedGroup || (parsed_.size() == 0 && !service_.embeddings_saturated())) {
+                flush(group, group_nodes);
             }
-        } catch(...) {
-            spdlog::error("   - Batch embedding failed at index {}", i);
         }
-        spdlog::info("  - Embedded batch {}/{}", (i/batch_size)+1, (nodes.size()/batch_size)+1);
+        if (!group.empty()) flush(group, group_nodes);
+        if (--embedders_left_ == 0) embedded_.close();
     }
-}
 
-std::unordered_map<std::string, std::string> SyncService::load_manifest(const std::string& project_id) {
-    fs::path p = fs::path("data") / project_id / "manifest.json";
-    if (!fs::exists(p)) return {};
-    try { std::ifstream f(p); json j; f >> j; return j; } catch(...) { return {}; }
-}
+    void flush(std::vector<FileUnit>& group, size_t& group_nodes) {
+        std::vector<std::shared_ptr<CodeNode>> nodes;
+        std::vector<std::string> texts;
+        nodes.reserve(group_nodes);
+        texts.reserve(group_nodes);
+        for (const auto& unit : group) {
+            for (const auto& node : unit.nodes) {
+                nodes.push_back(node);
+                texts.push_back(embedding_text(*node));
+            }
+        }
 
-void SyncService::save_manifest(const std::string& project_id, const std::unordered_map<std::string, std::string>& m) {
-    fs::path p = fs::path("data") / project_id / "manifest.json";
-    fs::create_directories(p.parent_path());
-    std::ofstream f(p); json j = m; f << j.dump(2);
-}
+        if (!texts.empty()) {
+            try {
+                auto embs = service_.generate_embeddings_batch(texts);
+                size_t got = 0;
+                for (size_t i = 0; i < embs.size() && i < nodes.size(); ++i) {
+                    if (!embs[i].empty()) got++;
+                    nodes[i]->embedding = std::move(embs[i]);
+                }
+                embedded_nodes_ += got;
+            } catch (const std::exception& e) {
+                spdlog::error("   - Batch embedding failed ({} nodes): {}", nodes.size(), e.what());
+            } catch (...) {
+                spdlog::error("   - Batch embedding failed ({} nodes)", nodes.size());
+            }
+        }
+        spdlog::info("  - Embedded group {} ({} files, {} nodes)", ++groups_, group.size(), nodes.size());
+
+        // A file moves on only with every node embedded; otherwise its old nodes stay until the retry
+        std::vector<FileUnit> ready;
+        ready.reserve(group.size());
+        for (auto& unit : group) {
+            bool embedded = std::all_of(unit.nodes.begin(), unit.nodes.end(),
+                                        [](const auto& node) { return !node->embedding.empty(); });
+            if (embedded) ready.push_back(std::move(unit));
+            else mark_failed(unit.rel_path);
+        }
+        if (sink_ && !ready.empty()) embedded_.push(std::move(ready));
+        group.clear();
+        group_nodes = 0;
+    }
 
-void SyncService::recursive_scan(
-    const fs::path& current_dir,
-    const fs::path& root_dir,
-    const fs::path& storage_dir,
-    const FilterConfig& cfg,
-    std::vector<fs::path>& results
-) {
-    PrefixTrie trie;
-    // Updated enum constants
-    for(const auto& p : cfg.blacklist) trie.insert(p, PathFlag::PF_IGNORE);
-    for(const auto& p : cfg.whitelist) trie.insert(p, PathFlag::PF_INCLUDE);
+    void ingest_loop() {
+        bool first = true;
+        while (auto group = embedded_.pop()) {
+            SyncResult partial;
+            for (auto& unit : *group) {
+                partial.changed_files.insert(unit.rel_path);
+                partial.nodes.insert(partial.nodes.end(), unit.nodes.begin(), unit.nodes.end());
+            }
+            partial.updated_count = (int)group->size();
+            partial.partial = true;
+            try {
+                sink_(partial);
+            } catch (const std::exception& e) {
+                spdlog::error("❌ Streaming ingest failed for {} files: {}", group->size(), e.what());
+                for (const auto& unit : *group) mark_failed(unit.rel_path);
+            } catch (...) {
+                spdlog::error("❌ Streaming ingest failed for {} files", group->size());
+                for (const auto& unit : *group) mark_failed(unit.rel_path);
+            }
+            if (first) {
+                first = false;
+                spdlog::info("⚡ First batch searchable after {}ms",
+                             std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::steady_clock::now() - started_).count());
+            }
+        }
+    }
 
-    try {
-        for (const auto& entry : fs::directory_iterator(current_dir)) {
-            const auto& path = entry.path();
-            if (fs::equivalent(path, storage_dir)) continue;
+    EmbeddingService& service_;
+    const SyncSink& sink_;
+    BoundedQueue<FileUnit> parsed_;
+    BoundedQueue<std::vector<FileUnit>> embedded_;
+    std::chrono::steady_clock::time_point started_;
+    std::atomic<size_t> embedders_left_{0};
+    std::atomic<size_t> embedded_nodes_{0};
+    std::atomic<size_t> groups_{0};
+    std::mutex failed_mutex_;
+    std::set<std::string> failed_;
+    std::vector<std::thread> embed_threads_;
+    std::thread ingest_thread_;
+};
 
-            fs::path rel_path = fs::relative(path, root_dir);
-            
-            uint8_t flag = trie.check(rel_path);
-            
-            // Updated check
+// ========================================================================
+// 🌳 PARALLEL WALK
+// Every directory and every batch of files is an OpenMP task: idle threads steal whatever is
+// pending, so one huge directory or one deep subtree never serializes the scan. Files are
+// stat-ed, hashed and (if changed) parsed as soon as their directory is listed.
+// ========================================================================
+
+static constexpr size_t kWalkFileBatch = 64;
+
+struct WalkedFile {
+    std::string rel_path;
+    ManifestFile entry;
+    bool changed = false;
+    bool loaded = false;
+    FileBuffer::Ptr content; // Shared with the file's nodes; null if never read (or unreadable)
+
+    std::string_view text() const { return content ? content->view() : std::string_view(); }
+};
+
+// Private to one OpenMP thread: no locks anywhere on the walk
+struct SyncWorkspace {
+    std::vector<std::pair<std::string, ManifestDir>> dirs;
+    std::vector<WalkedFile> files;
+    size_t listings_reused = 0;
+    int rehashed = 0;
+
+    std::vector<std::shared_ptr<CodeNode>> nodes;
+    std::vector<std::string> logs;
+    std::vector<std::string> changed_files;
+    int updated_count = 0;
+
+    // AST Parsers are NOT thread-safe. Each thread gets its own parser!
+    elite::ASTBooster local_ast_parser;
+};
+
+struct SyncWalk {
+    const TreeReader* reader;
+    const FilterConfig* cfg;
+    const PrefixTrie* trie;
+    const SyncManifest* old_manifest;
+    const SyncService::NodesByFile* existing_nodes;
+    std::vector<SyncWorkspace>* workspaces;
+    EmbedPipeline* pipeline;
+    fs::path root_dir;
+    fs::path storage_dir;
+    uint64_t storage_ino = 0;
+    bool reuse_listings = false;
+};
+
+static void process_file_batch(const SyncWalk* walk, const std::vector<std::string>& batch) {
+    auto& local = (*walk->workspaces)[omp_get_thread_num()];
+    const SyncManifest& manifest = *walk->old_manifest;
+
+    for (const auto& rel_path_str : batch) {
+        WalkedFile file;
+        file.rel_path = rel_path_str;
+        if (!walk->reader->stat_file(rel_path_str, file.entry.size, file.entry.mtime)) continue; // Vanished mid-scan: reported as removed
+
+        // Unchanged size + mtime keeps the recorded hash; anything else is read and hashed.
+        // Only a different content hash marks the file as changed, so touch / checkout / clock skew is free.
+        auto old = manifest.files.find(rel_path_str);
+        bool stat_clean = old != manifest.files.end() && old->second.size == file.entry.size &&
+                          old->second.mtime == file.entry.mtime && manifest.settled(file.entry.mtime);
+        if (stat_clean && old->second.hash != 0) {
+            file.entry.hash = old->second.hash;
+        } else {
+            file.content = walk->reader->read_file(rel_path_str);
+            file.loaded = true;
+            file.entry.hash = SyncManifest::hash_content(file.text());
+            local.rehashed++;
+
+            if (old == manifest.files.end()) file.changed = true;
+            else if (old->second.hash != 0) file.changed = file.entry.hash != old->second.hash;
+            else file.changed = !stat_clean; // Migrated entry: stat data is all we have to compare
+        }
+
+        if (file.changed) {
+            local.logs.push_back("UPDATE: " + rel_path_str);
+            local.changed_files.push_back(rel_path_str);
+
+            // CPU-Heavy parsing happens completely in parallel, embedding starts as soon as the file is parsed
+            FileUnit unit;
+            unit.rel_path = rel_path_str;
+            if (!file.content) file.content = FileBuffer::from_string({}); // Unreadable: indexed as empty
+            for (auto& n : parse_file_nodes(rel_path_str, file.content, local.local_ast_parser)) {
+                auto ptr = std::make_shared<CodeNode>(std::move(n));
+                local.nodes.push_back(ptr);
+                unit.nodes.push_back(std::move(ptr));
+            }
+            walk->pipeline->push(std::move(unit));
+            local.updated_count++;
+        } else {
+            // Unchanged: splice in the file's previous nodes (concurrent reads of a const map are safe)
+            auto reuse = walk->existing_nodes->find(rel_path_str);
+            if (reuse != walk->existing_nodes->end()) {
+                local.nodes.insert(local.nodes.end(), reuse->second.begin(), reuse->second.end());
+            }
+        }
+        local.files.push_back(std::move(file));
+    }
+}
+
+static void walk_dir(const SyncWalk* walk, const std::string& rel_dir, PrefixTrie::Cursor cursor) {
+    const SyncManifest& manifest = *walk->old_manifest;
+    std::string prefix = rel_dir.empty() ? "" : rel_dir + "/";
+
+    // 🌳 Unchanged mtime = same set of names. In-place edits do not touch a directory's mtime,
+    // so the files themselves are still stat-ed; only getdents and filtering are skipped.
+    auto old = walk->reuse_listings ? manifest.dirs.find(rel_dir) : manifest.dirs.end();
+    int64_t cached_mtime = old != manifest.dirs.end() && manifest.settled(old->second.mtime) ? old->second.mtime : INT64_MIN;
+
+    ManifestDir entry;
+    std::vector<TreeReader::Entry> listing;
+    if (!walk->reader->list(rel_dir, entry.mtime, listing, cached_mtime)) return; // Vanished since the parent was listed
+
+    auto& local = (*walk->workspaces)[omp_get_thread_num()];
+    if (entry.mtime == cached_mtime) {
+        entry.files = old->second.files;
+        entry.dirs = old->second.dirs;
+        local.listings_reused++;
+    } else {
+        for (const auto& dir_entry : listing) {
+            // The trie is matched one segment per level: no path is ever rebuilt from the root
+            uint8_t flag = walk->trie->descend(cursor, dir_entry.name).flags;
             bool is_ignored = (flag & PathFlag::PF_IGNORE);
             bool is_included = (flag & PathFlag::PF_INCLUDE);
+            if (is_ignored && !is_included) continue;
 
-            if (entry.is_directory()) {
-                if (!is_ignored || is_included) {
-                    recursive_scan(path, root_dir, storage_dir, cfg, results);
+            if (dir_entry.kind == TreeReader::Kind::DIR) {
+                if (walk->storage_ino == 0 || dir_entry.ino == 0 || dir_entry.ino == walk->storage_ino) {
+                    std::error_code ec;
+                    if (fs::equivalent(walk->root_dir / fs::path(prefix + dir_entry.name), walk->storage_dir, ec)) continue;
                 }
-            } 
-            else if (entry.is_regular_file()) {
-                if (is_ignored && !is_included) continue;
-
-                std::string ext = path.extension().string();
+                entry.dirs.push_back(dir_entry.name);
+            } else if (dir_entry.kind == TreeReader::Kind::FILE) {
+                std::string ext = fs::path(dir_entry.name).extension().string();
                 if (!ext.empty() && ext[0] == '.') ext = ext.substr(1);
-                
-                if (cfg.allowed_extensions.count(ext)) {
-                    results.push_back(path);
-                }
+                if (walk->cfg->allowed_extensions.count(ext)) entry.files.push_back(dir_entry.name);
             }
         }
-    } catch (...) {}
+        std::sort(entry.files.begin(), entry.files.end());
+        std::sort(entry.dirs.begin(), entry.dirs.end());
+    }
+
+    std::vector<std::string> subdirs = entry.dirs;
+    std::vector<std::string> files;
+    files.reserve(entry.files.size());
+    for (const auto& name : entry.files) files.push_back(prefix + name);
+    local.dirs.emplace_back(rel_dir, std::move(entry)); // Before any task switch: `local` stays this thread's
+
+    for (const auto& name : subdirs) {
+        std::string child_dir = prefix + name;
+        PrefixTrie::Cursor child = walk->trie->descend(cursor, name);
+        #pragma omp task firstprivate(walk, child_dir, child)
+        walk_dir(walk, child_dir, child);
+    }
+
+    // Hand this directory's files to the parse stage right away, in stealable batches
+    for (size_t i = 0; i < files.size(); i += kWalkFileBatch) {
+        std::vector<std::string> batch(files.begin() + i, files.begin() + std::min(files.size(), i + kWalkFileBatch));
+        #pragma omp task firstprivate(walk, batch)
+        process_file_batch(walk, batch);
+    }
 }
 
+
 SyncResult SyncService::perform_sync(
     const std::string& project_id,
     const std::string& source_dir_str,
     const std::string& storage_path_str, 
     const std::vector<std::string>& allowed_extensions,
     const std::vector<std::string>& ignored_paths,
-    const std::vector<std::string>& included_paths
+    const std::vector<std::string>& included_paths,
+    const SyncSink& sink
 ) {
     fs::path source_dir = fs::absolute(source_dir_str);
     fs::path storage_dir = fs::absolute(storage_path_str);
+
+    // An unreadable root would look like an empty tree and retire every file in the manifest
+    TreeReader reader;
+    if (!reader.open(source_dir)) {
+        spdlog::error("❌ Cannot open source directory {}", source_dir.string());
+        throw std::runtime_error("Cannot open source directory " + source_dir.string());
+    }
+
     fs::path converted_files_dir = storage_dir / "converted_files";
     fs::create_directories(converted_files_dir);
-
-    uintmax_t total_bytes = get_directory_size(source_dir);
-    spdlog::info("📊 [PROJECT STATS] Path: {}", source_dir_str);
-    spdlog::info("   - Total Folder Size: {:.2f} MB", (double)total_bytes / (1024.0 * 1024.0));
+    const int64_t scan_started = fs::file_time_type::clock::now().time_since_epoch().count();
 
     SyncResult result;
-    auto manifest = load_manifest(project_id);
-    auto existing_nodes_map = load_existing_nodes(storage_path_str);
+    SyncManifest manifest;
+    manifest.load(manifest_path(project_id));
+    auto load_start = std::chrono::high_resolution_clock::now();
+    auto existing_nodes_map = load_existing_nodes(project_id, storage_path_str);
+    spdlog::info("   - Reusable nodes of {} files loaded in {}ms", existing_nodes_map.size(),
+                 std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::high_resolution_clock::now() - load_start).count());
 
     if (manifest.empty()) {
         spdlog::warn("🧹 Fresh Sync Detected. Clearing old graph nodes...");
+        result.full_rebuild = true;
     }
 
-    FilterConfig cfg;
-    cfg.blacklist = ignored_paths;
-    cfg.whitelist = included_paths;
-    for (auto ext : allowed_extensions) {
-        if (!ext.empty() && ext[0] == '.') ext = ext.substr(1);
-        std::string clean_ext = ext;
-        std::transform(clean_ext.begin(), clean_ext.end(), clean_ext.begin(), ::tolower);
-        cfg.allowed_extensions.insert(clean_ext);
-    }
+    FilterConfig cfg = make_filter_config(allowed_extensions, ignored_paths, included_paths);
 
     spdlog::info("🔍 Mission Start: {} | Filters: [E:{} I:{} W:{}]", 
                  project_id, cfg.allowed_extensions.size(), cfg.blacklist.size(), cfg.whitelist.size());
 
-    std::vector<fs::path> files_to_process;
-    this->recursive_scan(source_dir, source_dir, storage_dir, cfg, files_to_process);
-    spdlog::info("   - Files Found: {}", files_to_process.size());
+    PrefixTrie trie;
+    for (const auto& p : cfg.blacklist) trie.insert(p, PathFlag::PF_IGNORE);
+    for (const auto& p : cfg.whitelist) trie.insert(p, PathFlag::PF_INCLUDE);
 
-    std::unordered_map<std::string, std::string> new_manifest;
-    std::vector<std::shared_ptr<CodeNode>> nodes_to_embed;
-    std::vector<std::pair<std::string, std::string>> files_to_preload;
-    std::ofstream full_context_file(storage_dir / "_full_context.txt");
-    full_context_file << "### AGGREGATED SOURCE CONTEXT\n";
+    SyncManifest new_manifest;
+    new_manifest.filter_hash = filter_fingerprint(cfg);
+    new_manifest.scanned_at = scan_started;
 
     // ========================================================================
-    // 🚀 PHASE 1: OPEN-MP LOCK-FREE PARALLEL PIPELINE
+    // 🌳 PHASE 1: WALK + STAT + CONTENT HASH + PARSE (one pass, OpenMP tasks)
+    // Parsed files stream straight into the embedder (and, with a sink, into the graph)
     // ========================================================================
-    
-    // Create an isolated workspace for every CPU thread
-    int num_threads = omp_get_max_threads();
-    struct ThreadLocalData {
-        std::vector<std::shared_ptr<CodeNode>> nodes;
-        std::vector<std::shared_ptr<CodeNode>> to_embed;
-        std::vector<std::pair<std::string, std::string>> preloads;
-        std::vector<std::string> logs;
-        std::unordered_map<std::string, std::string> manifest_updates;
-        std::string context_chunk;
-        int updated_count = 0;
-        
-        // AST Parsers are NOT thread-safe. Each thread gets its own parser!
-        code_assistance::elite::ASTBooster local_ast_parser; 
-    };
-    
-    std::vector<ThreadLocalData> thread_workspaces(num_threads);
-
-    // Run parallel loop. schedule(dynamic) is best because some files are huge, some are tiny.
-    #pragma omp parallel for schedule(dynamic)
-    for (int i = 0; i < (int)files_to_process.size(); ++i) {
-        int tid = omp_get_thread_num();
-        auto& local = thread_workspaces[tid]; // Grab thread's private workspace
-
-        const auto& file_path = files_to_process[i];
-        std::string rel_path_str = fs::relative(file_path, source_dir).generic_string();
-        std::string current_hash = calculate_file_hash(file_path);
-        
-        // Read operations are thread-safe
-        std::string old_hash = "";
-        if (manifest.count(rel_path_str)) {
-            old_hash = manifest.at(rel_path_str);
+    EmbedPipeline pipeline(*embedding_service_, sink);
+    std::vector<SyncWorkspace> thread_workspaces(omp_get_max_threads());
+
+    SyncWalk walk;
+    walk.reader = &reader;
+    walk.cfg = &cfg;
+    walk.trie = &trie;
+    walk.old_manifest = &manifest;
+    walk.existing_nodes = &existing_nodes_map;
+    walk.workspaces = &thread_workspaces;
+    walk.pipeline = &pipeline;
+    walk.root_dir = source_dir;
+    walk.storage_dir = storage_dir;
+    walk.storage_ino = TreeReader::inode_of(storage_dir);
+    walk.reuse_listings = manifest.filter_hash == new_manifest.filter_hash;
+
+    auto walk_start = std::chrono::high_resolution_clock::now();
+    #pragma omp parallel
+    #pragma omp single
+    walk_dir(&walk, "", trie.root_cursor());
+    // (Implicit barrier: every directory and file task has finished here)
+
+    std::vector<WalkedFile> files;
+    size_t listings_reused = 0;
+    for (auto& local : thread_workspaces) {
+        for (auto& [rel_dir, dir] : local.dirs) new_manifest.dirs[rel_dir] = std::move(dir);
+        files.insert(files.end(), std::make_move_iterator(local.files.begin()), std::make_move_iterator(local.files.end()));
+        listings_reused += local.listings_reused;
+        result.rehashed_count += local.rehashed;
+        local.dirs.clear();
+        local.files.clear();
+    }
+    std::sort(files.begin(), files.end(), [](const WalkedFile& a, const WalkedFile& b) { return a.rel_path < b.rel_path; });
+    spdlog::info("   - Files Found: {} ({}/{} directory listings reused) in {}ms", files.size(), listings_reused,
+                 new_manifest.dirs.size(),
+                 std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::high_resolution_clock::now() - walk_start).count());
+
+    for (const auto& file : files) new_manifest.files[file.rel_path] = file.entry;
+    result.manifest_root = new_manifest.compute_merkle();
+
+    // Files that were in the last manifest but not in this scan are gone from disk
+    for (const auto& [path, entry] : manifest.files) {
+        if (!new_manifest.files.count(path)) {
+            result.removed_files.push_back(path);
+            result.logs.push_back("DELETE: " + path);
         }
-        
-        // Parallel File I/O
-        std::ifstream file_in(file_path);
-        std::string content((std::istreambuf_iterator<char>(file_in)), std::istreambuf_iterator<char>());
-        
-        // Write to LOCAL buffers
-        local.context_chunk += "\n\n--- FILE: " + rel_path_str + " ---\n" + content + "\n";
-        local.preloads.push_back({rel_path_str, content});
-        local.manifest_updates[rel_path_str] = current_hash;
+    }
+    result.deleted_count = (int)result.removed_files.size();
 
-        bool is_changed = (current_hash != old_hash);
+    // Equal Merkle roots: no file was added, removed or edited, so the aggregate files stay as they are
+    fs::path full_context_path = storage_dir / "_full_context.txt";
+    fs::path tree_path = storage_dir / "tree.txt";
+    bool tree_changed = result.full_rebuild || result.manifest_root != manifest.root() ||
+                        !fs::exists(full_context_path) || !fs::exists(tree_path);
 
-        if (is_changed) {
-            local.logs.push_back("UPDATE: " + rel_path_str);
-            
-            std::vector<CodeNode> raw_nodes;
-            fs::path p(rel_path_str);
-            std::string ext = p.extension().string();
-
-            // CPU-Heavy parsing happens completely in parallel
-            if (ext == ".cpp" || ext == ".hpp" || ext == ".py" || ext == ".ts" || ext == ".js") {
-                raw_nodes = local.local_ast_parser.extract_symbols(rel_path_str, content);
-                if(raw_nodes.empty()) {
-                    raw_nodes = CodeParser::extract_nodes_from_file(rel_path_str, content);
-                }
-            } else {
-                raw_nodes = CodeParser::extract_nodes_from_file(rel_path_str, content);
-            }
-
-            if (raw_nodes.empty() || raw_nodes[0].type != "file") {
-                CodeNode file_node;
-                file_node.name = p.filename().string();
-                file_node.file_path = rel_path_str;
-                file_node.id = rel_path_str;
-                file_node.content = content;
-                file_node.type = "file";
-                file_node.weights["structural"] = 1.0;
-                raw_nodes.push_back(file_node);
-            }
+    uintmax_t total_bytes = 0;
+    for (const auto& file : files) total_bytes += file.entry.size;
+    spdlog::info("📊 [PROJECT STATS] Path: {}", source_dir_str);
+    spdlog::info("   - Indexed Size: {:.2f} MB | Re-hashed: {} | Root: {:016x}{}",
+                 (double)total_bytes / (1024.0 * 1024.0), result.rehashed_count, result.manifest_root,
+                 tree_changed ? "" : " (unchanged)");
 
-            for (auto& n : raw_nodes) {
-                auto ptr = std::make_shared<CodeNode>(n);
-                local.nodes.push_back(ptr);
-                local.to_embed.push_back(ptr);
-            }
-            local.updated_count++;
-            
-        } else {
-            // Concurrent maps allow safe READS by multiple threads
-            for (const auto& [id, node] : existing_nodes_map) {
-                if (node->file_path == rel_path_str) {
-                    local.nodes.push_back(node);
-                }
-            }
-        }
+    // ========================================================================
+    // 🚀 PHASE 2: CONTENT FOR THE AGGREGATES
+    // Unchanged files are only read when the aggregate context is rebuilt or ghost text lacks them.
+    // ========================================================================
+    #pragma omp parallel for schedule(dynamic)
+    for (int i = 0; i < (int)files.size(); ++i) {
+        auto& file = files[i];
+        if (file.loaded || (!tree_changed && has_file_context(file.rel_path))) continue;
+        file.content = reader.read_file(file.rel_path);
+        file.loaded = true;
     }
 
     // ========================================================================
-    // 🚀 PHASE 2: RAPID MERGE
+    // 🚀 PHASE 3: RAPID MERGE
     // ========================================================================
     
     for (auto& local : thread_workspaces) {
-        // I/O Merge
-        full_context_file << local.context_chunk;
-        
+        // Output Logs sequentially to keep console clean (before they are moved out)
+        for (const auto& log : local.logs) {
+            spdlog::info("🔼 {}", log);
+        }
+
         // Pointer Moves (Instant O(1) transferring of data)
-        files_to_preload.insert(files_to_preload.end(), 
-            std::make_move_iterator(local.preloads.begin()), std::make_move_iterator(local.preloads.end()));
-            
         result.nodes.insert(result.nodes.end(), 
             std::make_move_iterator(local.nodes.begin()), std::make_move_iterator(local.nodes.end()));
             
-        nodes_to_embed.insert(nodes_to_embed.end(), 
-            std::make_move_iterator(local.to_embed.begin()), std::make_move_iterator(local.to_embed.end()));
-            
         result.logs.insert(result.logs.end(), 
             std::make_move_iterator(local.logs.begin()), std::make_move_iterator(local.logs.end()));
         
-        // Map Merge
-        new_manifest.insert(local.manifest_updates.begin(), local.manifest_updates.end());
-        
+        result.changed_files.insert(local.changed_files.begin(), local.changed_files.end());
         result.updated_count += local.updated_count;
-        
-        // Output Logs sequentially to keep console clean
-        for (const auto& log : local.logs) {
-            spdlog::info("🔼 {}", log);
-        }
     }
 
-    full_context_file.close();
-
     // ========================================================================
-    // POST-PROCESSING
+    // POST-PROCESSING (local disk work, overlapping the embedding requests still in flight)
     // ========================================================================
 
-    spdlog::info("📦 Preloading {} file contexts for ghost text...", files_to_preload.size());
+    if (tree_changed) {
+        std::ofstream full_context_file(full_context_path);
+        full_context_file << "### AGGREGATED SOURCE CONTEXT\n";
+        for (const auto& file : files) {
+            full_context_file << "\n\n--- FILE: " << file.rel_path << " ---\n" << file.text() << "\n";
+        }
+    }
+
     auto preload_start = std::chrono::high_resolution_clock::now();
-    
-    for (const auto& [file_path, content] : files_to_preload) {
-        code_assistance::preload_file_context(file_path, content);
+    size_t preloaded = 0;
+    for (const auto& file : files) {
+        if (!file.loaded) continue;
+        if (!file.changed && has_file_context(file.rel_path)) continue;
+        code_assistance::preload_file_context(file.rel_path, file.text());
+        preloaded++;
     }
-    
     auto preload_elapsed = std::chrono::duration_cast<std::chrono::milliseconds>(
         std::chrono::high_resolution_clock::now() - preload_start
     ).count();
-    
-    spdlog::info("✅ Context preload complete in {}ms", preload_elapsed);
+    spdlog::info("✅ Preloaded {} file contexts for ghost text in {}ms", preloaded, preload_elapsed);
+
+    if (tree_changed) {
+        std::vector<fs::path> tree_files;
+        tree_files.reserve(files.size());
+        for (const auto& file : files) tree_files.push_back(source_dir / fs::path(file.rel_path));
+        generate_tree_file(source_dir, tree_files, tree_path);
+    }
+
+    // The manifest only records files once their nodes are embedded: a crash before this point
+    // re-parses them on the next sync instead of leaving them without vectors
+    auto drain_start = std::chrono::high_resolution_clock::now();
+    pipeline.finish();
+    if (result.updated_count > 0) {
+        spdlog::info("   - Embedded {} nodes in {} groups ({}ms waiting after the walk)",
+                     pipeline.embedded_nodes(), pipeline.groups(),
+                     std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::high_resolution_clock::now() - drain_start).count());
+    }
+    result.streamed = (bool)sink;
+    if (!pipeline.failed_files().empty()) {
+        const auto& failed = pipeline.failed_files();
+        for (const auto& path : failed) {
+            new_manifest.files[path] = ManifestFile{}; // No hash, no mtime: never stat-clean, so re-parsed
+            result.changed_files.erase(path);
+            result.failed_files.push_back(path);
+        }
+        // Out of the final ingest too: the graph keeps their old nodes instead of vectorless new ones
+        std::erase_if(result.nodes, [&](const auto& node) { return failed.count(node->file_path) > 0; });
+        result.manifest_root = new_manifest.compute_merkle();
+        spdlog::warn("⚠️ {} files were not indexed and will be retried on the next sync", failed.size());
+    }
+    new_manifest.save(manifest_path(project_id));
+
+    spdlog::info("✅ [SYNC COMPLETE] Generated Nodes: {} | Changed Files: {} | Removed: {}",
+                 result.nodes.size(), result.changed_files.size(), result.deleted_count);
+    return result;
+}
+
+SyncResult SyncService::sync_paths(
+    const std::string& project_id,
+    const std::string& source_dir_str,
+    const std::string& storage_path_str,
+    const std::vector<std::string>& allowed_extensions,
+    const std::vector<std::string>& ignored_paths,
+    const std::vector<std::string>& included_paths,
+    const std::vector<std::string>& rel_paths,
+    const SyncSink& sink
+) {
+    SyncManifest manifest;
+    manifest.load(manifest_path(project_id));
+    if (manifest.empty()) {
+        // Nothing to diff against yet: the first sync has to see the whole tree
+        return perform_sync(project_id, source_dir_str, storage_path_str, allowed_extensions, ignored_paths, included_paths, sink);
+    }
 
-    // Embeddings still hit the network, so they happen after the CPU parallelism
+    fs::path source_dir = fs::absolute(source_dir_str);
+    fs::path storage_dir = fs::absolute(storage_path_str);
+    std::error_code root_ec;
+    if (!fs::is_directory(source_dir, root_ec)) {
+        // Every path would stat as missing and be reported removed
+        spdlog::error("❌ Cannot open source directory {}", source_dir.string());
+        throw std::runtime_error("Cannot open source directory " + source_dir.string());
+    }
+    FilterConfig cfg = make_filter_config(allowed_extensions, ignored_paths, included_paths);
+    PrefixTrie trie;
+    for (const auto& p : cfg.blacklist) trie.insert(p, PathFlag::PF_IGNORE);
+    for (const auto& p : cfg.whitelist) trie.insert(p, PathFlag::PF_INCLUDE);
+
+    // 1. Expand directories: whatever is below them on disk, plus whatever the manifest had below them
+    std::set<std::string> candidates;
+    for (const auto& rel : rel_paths) {
+        if (rel.empty()) continue;
+        fs::path full = source_dir / fs::path(rel);
+        std::error_code ec;
+        if (fs::is_directory(full, ec)) {
+            if (is_path_indexed(trie, cfg, rel, true) && !fs::equivalent(full, storage_dir, ec)) {
+                auto it = fs::recursive_directory_iterator(full, fs::directory_options::skip_permission_denied, ec);
+                for (; !ec && it != fs::recursive_directory_iterator(); it.increment(ec)) {
+                    std::string child = rel + "/" + fs::path(it->path()).lexically_relative(full).generic_string();
+                    if (it->is_directory(ec)) {
+                        if (!is_path_indexed(trie, cfg, child, true) || fs::equivalent(it->path(), storage_dir, ec)) {
+                            it.disable_recursion_pending();
+                        }
+                    } else if (it->is_regular_file(ec)) {
+                        candidates.insert(child);
+                    }
+                }
+            }
+        } else {
+            candidates.insert(rel);
+        }
+
+        std::string prefix = rel + "/";
+        for (const auto& [path, entry] : manifest.files) {
+            if (path.compare(0, prefix.size(), prefix) == 0) candidates.insert(path);
+        }
+    }
+    std::vector<std::string> paths(candidates.begin(), candidates.end());
+
+    // 2. Stat + hash + parse (parallel); unchanged content only refreshes its stat data
+    struct Outcome {
+        bool present = false;
+        bool removed = false;
+        bool changed = false;
+        ManifestFile entry;
+        FileBuffer::Ptr content;
+        std::vector<CodeNode> nodes;
+    };
+    std::vector<Outcome> outcomes(paths.size());
+    std::vector<elite::ASTBooster> parsers(omp_get_max_threads());
+    // Saves of the same file come through here again and again: keep their trees for incremental reparsing
+    for (auto& parser : parsers) parser.set_incremental(true);
+
+    #pragma omp parallel for schedule(dynamic)
+    for (int i = 0; i < (int)paths.size(); ++i) {
+        const std::string& rel_path_str = paths[i];
+        auto& out = outcomes[i];
+        auto old = manifest.files.find(rel_path_str);
+        fs::path file_path = source_dir / fs::path(rel_path_str);
+
+        std::error_code ec;
+        if (!fs::is_regular_file(file_path, ec) || !is_path_indexed(trie, cfg, rel_path_str, false)) {
+            out.removed = old != manifest.files.end();
+            continue;
+        }
+        out.entry.size = fs::file_size(file_path, ec);
+        if (ec) { out.removed = old != manifest.files.end(); continue; }
+        out.entry.mtime = fs::last_write_time(file_path, ec).time_since_epoch().count();
+
+        out.content = FileBuffer::load(file_path.string());
+        if (!out.content) out.content = FileBuffer::from_string({});
+        out.entry.hash = SyncManifest::hash_content(out.content->view());
+        out.present = true;
+        if (old != manifest.files.end() && old->second.hash == out.entry.hash) continue;
+
+        out.changed = true;
+        out.nodes = parse_file_nodes(rel_path_str, out.content, parsers[omp_get_thread_num()]);
+    }
+
+    // 3. Merge into the result and the manifest
+    SyncResult result;
+    std::vector<std::shared_ptr<CodeNode>> nodes_to_embed;
+    for (size_t i = 0; i < paths.size(); ++i) {
+        auto& out = outcomes[i];
+        const std::string& rel_path_str = paths[i];
+        if (out.removed) {
+            manifest.files.erase(rel_path_str);
+            code_assistance::invalidate_file_context(rel_path_str);
+            elite::ASTBooster::forget_tree(rel_path_str);
+            result.removed_files.push_back(rel_path_str);
+            result.logs.push_back("DELETE: " + rel_path_str);
+            continue;
+        }
+        if (!out.present) continue;
+
+        manifest.files[rel_path_str] = out.entry;
+        if (!out.changed) continue;
+
+        for (auto& n : out.nodes) {
+            auto ptr = std::make_shared<CodeNode>(std::move(n));
+            result.nodes.push_back(ptr);
+            nodes_to_embed.push_back(ptr);
+        }
+        update_file_context(rel_path_str, out.content->view());
+        out.content.reset(); // The nodes still hold it as long as they need it
+        result.changed_files.insert(rel_path_str);
+        result.logs.push_back("UPDATE: " + rel_path_str);
+        result.updated_count++;
+    }
+    result.deleted_count = (int)result.removed_files.size();
+
+    for (const auto& log : result.logs) {
+        spdlog::info("🔼 {}", log);
+    }
     if (!nodes_to_embed.empty()) {
-        generate_embeddings_batch(nodes_to_embed, 100);
+        generate_embeddings_batch(nodes_to_embed);
+    }
+
+    // Same rule as perform_sync: a file with a node left unembedded keeps its old nodes and no hash
+    std::set<std::string> failed;
+    for (const auto& node : nodes_to_embed) {
+        if (node->embedding.empty()) failed.insert(node->file_path);
+    }
+    if (!failed.empty()) {
+        for (const auto& path : failed) {
+            manifest.files[path] = ManifestFile{};
+            result.changed_files.erase(path);
+            result.failed_files.push_back(path);
+        }
+        std::erase_if(result.nodes, [&](const auto& node) { return failed.count(node->file_path) > 0; });
+        spdlog::warn("⚠️ {} files were not indexed and will be retried on the next sync", failed.size());
     }
-    
-    generate_tree_file(source_dir, files_to_process, storage_dir / "tree.txt");
-    save_manifest(project_id, new_manifest);
 
-    spdlog::info("✅ [SYNC COMPLETE] Generated Nodes: {}", result.nodes.size());
+    // Dirs, scanned_at and the Merkle root are left alone on purpose: the stored root still describes
+    // _full_context.txt / tree.txt, so the next full sync sees the mismatch and rebuilds those,
+    // while the file hashes recorded here keep it from re-parsing or re-embedding anything.
+    if (!result.changed_files.empty() || !result.removed_files.empty()) {
+        manifest.save(manifest_path(project_id));
+    }
+
+    spdlog::info("⚡ [INCREMENTAL SYNC] {} path(s) -> Nodes: {} | Changed Files: {} | Removed: {}",
+                 paths.size(), result.nodes.size(), result.changed_files.size(), result.deleted_count);
     return result;
 }
 
-void SyncService::update_file_context(const std::string& file_path, const std::string& content) {
+void SyncService::update_file_context(const std::string& file_path, std::string_view content) {
     // Invalidate old context
     code_assistance::invalidate_file_context(file_path);
     
@@ -488,7 +1036,7 @@ void SyncService::update_file_context(const std::string& file_path, const std::s
 }
 
 std::vector<std::shared_ptr<CodeNode>> SyncService::sync_single_file(
-    const std::string& project_id,
+    [[maybe_unused]] const std::string& project_id,
     const std::string& local_root,
     const std::string& storage_path,
     const std::string& relative_path
@@ -496,8 +1044,8 @@ std::vector<std::shared_ptr<CodeNode>> SyncService::sync_single_file(
     fs::path full_path = fs::path(local_root) / relative_path;
     if (!fs::exists(full_path)) throw std::runtime_error("File not found locally");
 
-    std::ifstream file(full_path);
-    std::string content((std::istreambuf_iterator<char>(file)), std::istreambuf_iterator<char>());
+    auto content = FileBuffer::load(full_path.string());
+    if (!content) throw std::runtime_error("File not readable locally");
 
     auto raw_nodes = CodeParser::extract_nodes_from_file(relative_path, content);
     
@@ -513,7 +1061,7 @@ std::vector<std::shared_ptr<CodeNode>> SyncService::sync_single_file(
         std::string identity_text = 
             "[FILE: " + n.file_path + "] " +
             "[SYMBOL: " + n.name + "] " +
-            "Content: " + n.content;
+            "Content: " + std::string(n.text());
 
         texts_to_embed.push_back(identity_text);
     }
@@ -524,11 +1072,14 @@ std::vector<std::shared_ptr<CodeNode>> SyncService::sync_single_file(
         if (i < nodes.size()) nodes[i]->embedding = embs[i];
     }
 
+    // No pipeline downstream to copy what it keeps: these nodes own their code
+    for (auto& node : nodes) node->materialize();
+
     // Save to converted_files
     fs::path target_txt = fs::path(storage_path) / "converted_files" / (relative_path + ".txt");
     fs::create_directories(target_txt.parent_path());
     std::ofstream out(target_txt);
-    out << content;
+    out << content->view();
 
     return nodes;
 }
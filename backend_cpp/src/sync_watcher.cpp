@@ -0,0 +1,242 @@
+#include "sync_watcher.hpp"
+#include <algorithm>
+#include <spdlog/spdlog.h>
+
+#ifdef __linux__
+#include <poll.h>
+#include <sys/eventfd.h>
+#include <sys/inotify.h>
+#include <unistd.h>
+#include <cerrno>
+#include <cstring>
+#endif
+
+namespace code_assistance {
+
+ProjectWatcher::ProjectWatcher(std::string project_id, const fs::path& root_dir, const fs::path& storage_dir,
+                               FilterConfig cfg, Handler handler, WatchOptions options)
+    : project_id_(std::move(project_id)),
+      root_dir_(fs::absolute(root_dir)),
+      storage_dir_(fs::absolute(storage_dir)),
+      cfg_(std::move(cfg)),
+      handler_(std::move(handler)),
+      options_(options) {
+    for (const auto& p : cfg_.blacklist) trie_.insert(p, PathFlag::PF_IGNORE);
+    for (const auto& p : cfg_.whitelist) trie_.insert(p, PathFlag::PF_INCLUDE);
+}
+
+ProjectWatcher::~ProjectWatcher() {
+    stop();
+}
+
+#ifdef __linux__
+
+static constexpr uint32_t kWatchMask = IN_CLOSE_WRITE | IN_CREATE | IN_DELETE | IN_MOVED_FROM | IN_MOVED_TO |
+                                       IN_DELETE_SELF | IN_ONLYDIR | IN_EXCL_UNLINK;
+
+bool ProjectWatcher::start() {
+    if (running_) return true;
+    std::error_code ec;
+    if (!fs::is_directory(root_dir_, ec)) {
+        spdlog::warn("👁️ Watch skipped for '{}': {} is not a directory", project_id_, root_dir_.string());
+        return false;
+    }
+
+    inotify_fd_ = inotify_init1(IN_NONBLOCK | IN_CLOEXEC);
+    wake_fd_ = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+    if (inotify_fd_ < 0 || wake_fd_ < 0) {
+        spdlog::error("👁️ inotify unavailable for '{}': {}", project_id_, std::strerror(errno));
+        stop();
+        return false;
+    }
+
+    auto t_start = std::chrono::steady_clock::now();
+    add_watch_tree("");
+    if (!dir_to_wd_.count("")) {
+        stop();
+        return false;
+    }
+    spdlog::info("👁️ Watching '{}' ({} directories) in {:.1f} ms", project_id_, watch_count_.load(),
+                 std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - t_start).count());
+
+    running_ = true;
+    thread_ = std::thread(&ProjectWatcher::run, this);
+    return true;
+}
+
+void ProjectWatcher::stop() {
+    if (running_.exchange(false) && wake_fd_ >= 0) {
+        uint64_t one = 1;
+        (void)!write(wake_fd_, &one, sizeof(one));
+    }
+    if (thread_.joinable()) thread_.join();
+    if (inotify_fd_ >= 0) close(inotify_fd_); // Drops every watch with it
+    if (wake_fd_ >= 0) close(wake_fd_);
+    inotify_fd_ = wake_fd_ = -1;
+    wd_to_dir_.clear();
+    dir_to_wd_.clear();
+    watch_count_ = 0;
+}
+
+void ProjectWatcher::add_watch_tree(const std::string& rel_dir) {
+    fs::path dir = rel_dir.empty() ? root_dir_ : root_dir_ / fs::path(rel_dir);
+    std::error_code ec;
+    if (!rel_dir.empty() && (!is_path_indexed(trie_, cfg_, rel_dir, true) || fs::equivalent(dir, storage_dir_, ec))) {
+        return;
+    }
+
+    int wd = inotify_add_watch(inotify_fd_, dir.c_str(), kWatchMask);
+    if (wd < 0) {
+        if (errno == ENOSPC) {
+            spdlog::warn("👁️ fs.inotify.max_user_watches reached at {} - the rest of '{}' needs /sync/run",
+                         dir.string(), project_id_);
+        }
+        return;
+    }
+    // Re-adding an existing directory returns its old descriptor
+    if (wd_to_dir_.emplace(wd, rel_dir).second) watch_count_++;
+    dir_to_wd_[rel_dir] = wd;
+
+    std::string prefix = rel_dir.empty() ? "" : rel_dir + "/";
+    for (auto it = fs::directory_iterator(dir, fs::directory_options::skip_permission_denied, ec);
+         !ec && it != fs::directory_iterator(); it.increment(ec)) {
+        if (it->is_directory(ec) && !it->is_symlink(ec)) add_watch_tree(prefix + it->path().filename().string());
+    }
+}
+
+void ProjectWatcher::remove_watch_tree(const std::string& rel_dir) {
+    std::string prefix = rel_dir + "/";
+    for (auto it = dir_to_wd_.begin(); it != dir_to_wd_.end();) {
+        if (it->first == rel_dir || it->first.compare(0, prefix.size(), prefix) == 0) {
+            inotify_rm_watch(inotify_fd_, it->second);
+            if (wd_to_dir_.erase(it->second)) watch_count_--;
+            it = dir_to_wd_.erase(it);
+        } else {
+            ++it;
+        }
+    }
+}
+
+void ProjectWatcher::mark(const std::string& rel_path) {
+    auto now = std::chrono::steady_clock::now();
+    if (pending_.empty() && !overflow_) first_event_ = now;
+    last_event_ = now;
+    pending_.insert(rel_path);
+}
+
+void ProjectWatcher::drain_events() {
+    alignas(struct inotify_event) char buf[64 * 1024];
+    while (true) {
+        ssize_t len = read(inotify_fd_, buf, sizeof(buf));
+        if (len <= 0) return; // EAGAIN: drained
+
+        for (char* ptr = buf; ptr < buf + len;) {
+            auto* ev = reinterpret_cast<struct inotify_event*>(ptr);
+            ptr += sizeof(struct inotify_event) + ev->len;
+
+            if (ev->mask & IN_Q_OVERFLOW) {
+                if (pending_.empty() && !overflow_) first_event_ = std::chrono::steady_clock::now();
+                last_event_ = std::chrono::steady_clock::now();
+                overflow_ = true;
+                continue;
+            }
+
+            auto dir_it = wd_to_dir_.find(ev->wd);
+            if (dir_it == wd_to_dir_.end()) continue; // Already removed
+            std::string rel_dir = dir_it->second;
+
+            if (ev->mask & IN_IGNORED) {
+                // The kernel dropped this watch (directory deleted or unmounted)
+                dir_to_wd_.erase(rel_dir);
+                wd_to_dir_.erase(dir_it);
+                watch_count_--;
+                continue;
+            }
+            if (ev->mask & IN_DELETE_SELF) {
+                if (rel_dir.empty()) spdlog::warn("👁️ Root of '{}' was deleted", project_id_);
+                continue;
+            }
+            if (ev->len == 0) continue;
+
+            std::string rel_path = (rel_dir.empty() ? "" : rel_dir + "/") + ev->name;
+            if (ev->mask & IN_ISDIR) {
+                if (ev->mask & (IN_CREATE | IN_MOVED_TO)) {
+                    // Files may land before the watch does: the handler expands the directory itself
+                    add_watch_tree(rel_path);
+                    if (is_path_indexed(trie_, cfg_, rel_path, true)) mark(rel_path);
+                } else if (ev->mask & (IN_DELETE | IN_MOVED_FROM)) {
+                    remove_watch_tree(rel_path);
+                    if (is_path_indexed(trie_, cfg_, rel_path, true)) mark(rel_path);
+                }
+                continue;
+            }
+
+            // Editor temp files, swap files and other extensions never reach the handler
+            if (is_path_indexed(trie_, cfg_, rel_path, false)) mark(rel_path);
+        }
+    }
+}
+
+void ProjectWatcher::run() {
+    pollfd fds[2] = {{inotify_fd_, POLLIN, 0}, {wake_fd_, POLLIN, 0}};
+
+    while (running_) {
+        int timeout_ms = -1;
+        if (!pending_.empty() || overflow_) {
+            auto due = std::min(last_event_ + options_.debounce, first_event_ + options_.max_delay);
+            auto wait = std::chrono::duration_cast<std::chrono::milliseconds>(due - std::chrono::steady_clock::now());
+            timeout_ms = (int)std::max<int64_t>(0, wait.count());
+        }
+
+        fds[0].revents = fds[1].revents = 0;
+        int ready = poll(fds, 2, timeout_ms);
+        if (ready < 0 && errno != EINTR) {
+            spdlog::error("👁️ Watch loop for '{}' failed: {}", project_id_, std::strerror(errno));
+            break;
+        }
+        if (!running_ || (fds[1].revents & POLLIN)) break;
+        if (fds[0].revents & POLLIN) drain_events();
+        if (pending_.empty() && !overflow_) continue;
+
+        // A steady stream of events keeps pushing last_event_, but never past first_event_ + max_delay
+        auto now = std::chrono::steady_clock::now();
+        if (now < last_event_ + options_.debounce && now < first_event_ + options_.max_delay) continue;
+
+        // ⏱️ Quiet (or overdue): hand over one coalesced batch
+        std::vector<std::string> batch(pending_.begin(), pending_.end());
+        std::sort(batch.begin(), batch.end());
+        bool overflow = overflow_;
+        pending_.clear();
+        overflow_ = false;
+
+        if (overflow) {
+            spdlog::warn("👁️ inotify queue overflowed for '{}' - falling back to a full sync", project_id_);
+            add_watch_tree(""); // Directories created while events were being dropped
+        }
+        try {
+            handler_(batch, overflow);
+        } catch (const std::exception& e) {
+            spdlog::error("👁️ Watch handler for '{}' failed: {}", project_id_, e.what());
+        } catch (...) {
+            spdlog::error("👁️ Watch handler for '{}' failed", project_id_);
+        }
+    }
+}
+
+#else
+
+bool ProjectWatcher::start() {
+    spdlog::info("👁️ Watch mode needs inotify (Linux); '{}' syncs on /sync/run and /sync/file only", project_id_);
+    return false;
+}
+
+void ProjectWatcher::stop() {}
+void ProjectWatcher::run() {}
+void ProjectWatcher::drain_events() {}
+void ProjectWatcher::add_watch_tree(const std::string&) {}
+void ProjectWatcher::remove_watch_tree(const std::string&) {}
+void ProjectWatcher::mark(const std::string&) {}
+
+#endif
+
+} // namespace code_assistance
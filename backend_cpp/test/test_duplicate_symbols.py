@@ -0,0 +1,86 @@
+import requests
+import base64
+import os
+import tempfile
+import time
+from termcolor import colored
+
+REST_URL = "http://127.0.0.1:5002"
+TARGET_PATH = os.path.join(tempfile.gettempdir(), "synapse_duplicate_symbols").replace("\\", "/")
+PROJECT_ID = base64.b64encode(TARGET_PATH.encode('utf-8')).decode('utf-8')
+
+# Same-named symbols in one file: every one of them must reach the graph, not just the last
+FILES = {
+    "shapes.py": (
+        "class Circle:\n"
+        "    def __init__(self, r):\n"
+        "        self.r = r  # CIRCLE-INIT\n"
+        "\n"
+        "class Square:\n"
+        "    def __init__(self, side):\n"
+        "        self.side = side  # SQUARE-INIT\n"
+    ),
+    "area.cpp": (
+        "int area(int side) {\n"
+        "    return side * side; // AREA-SQUARE\n"
+        "}\n"
+        "\n"
+        "int area(int w, int h) {\n"
+        "    return w * h; // AREA-RECT\n"
+        "}\n"
+    ),
+}
+
+EXPECTED = {
+    "shapes.py": ("__init__", ["CIRCLE-INIT", "SQUARE-INIT"]),
+    "area.cpp": ("area", ["AREA-SQUARE", "AREA-RECT"]),
+}
+
+def write_project():
+    os.makedirs(TARGET_PATH, exist_ok=True)
+    for name, text in FILES.items():
+        with open(os.path.join(TARGET_PATH, name), "w") as f:
+            f.write(text)
+
+def candidates_for(path, symbol):
+    res = requests.post(f"{REST_URL}/retrieve-context-candidates", json={
+        "project_id": PROJECT_ID,
+        "prompt": f"definition of {symbol}",
+        "path_prefix": path
+    }, timeout=30)
+    res.raise_for_status()
+    return [c for c in res.json().get("candidates", []) if c.get("name") == symbol]
+
+def run_duplicate_symbol_test():
+    print(colored("🏗️  WRITING FILES WITH SAME-NAMED SYMBOLS...", "white"))
+    write_project()
+
+    requests.post(f"{REST_URL}/sync/register/{PROJECT_ID}", json={
+        "local_path": TARGET_PATH,
+        "allowed_extensions": ["py", "cpp"],
+        "watch": False
+    }, timeout=10).raise_for_status()
+    print("🔄 Synchronizing Engine...")
+    requests.post(f"{REST_URL}/sync/run/{PROJECT_ID}", json={}, timeout=10).raise_for_status()
+
+    failures = 0
+    for path, (symbol, markers) in EXPECTED.items():
+        found = []
+        for _ in range(30): # The sync runs in the background
+            found = candidates_for(path, symbol)
+            if len(found) >= len(markers): break
+            time.sleep(1)
+
+        missing = [m for m in markers if not any(m in c.get("content", "") for c in found)]
+        if missing:
+            failures += 1
+            print(colored(f"❌ {path}: {len(found)} '{symbol}' nodes, missing {missing}", "red"))
+        else:
+            print(colored(f"✅ {path}: all {len(markers)} '{symbol}' definitions indexed", "green"))
+
+    if failures == 0:
+        print(colored("\n🏆 SUCCESS: No symbol overwrote a same-named sibling.", "green", attrs=["bold"]))
+    return failures == 0
+
+if __name__ == "__main__":
+    exit(0 if run_duplicate_symbol_test() else 1)